@@ -7,11 +7,16 @@
 
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 
 #include <ConfigOperations.h>
 
 #include <DBConnectionInterface.h>
+#include <DBEntryCache.h>
+#include <DBStats.h>
+#include <DBUrlIndex.h>
+#include <DBWorkload.h>
 
 namespace black_library {
 
@@ -27,28 +32,48 @@ public:
     // front-end
     std::vector<DBEntry> GetStagingEntryList();
     std::vector<DBEntry> GetBlackEntryList();
+    std::vector<DBEntry> GetStagingEntryList(entry_column_mask_t columns);
+    std::vector<DBEntry> GetBlackEntryList(entry_column_mask_t columns);
     std::vector<DBMd5Sum> GetChecksumList();
     std::vector<DBErrorEntry> GetErrorEntryList();
+    std::vector<DBEntry> GetStagingEntryPage(const std::string &after_uuid, size_t limit);
+    std::vector<DBEntry> GetBlackEntryPage(const std::string &after_uuid, size_t limit);
+    std::vector<DBMd5Sum> GetChecksumPage(const std::string &after_uuid, size_t after_index_num, size_t limit);
+    std::vector<DBErrorEntry> GetErrorEntryPage(const std::string &after_uuid, size_t limit);
+    int ForEachStagingEntry(const entry_callback_t &callback);
+    int ForEachBlackEntry(const entry_callback_t &callback);
+    int ForEachStagingEntryView(entry_column_mask_t columns, const entry_view_callback_t &callback);
+    int ForEachBlackEntryView(entry_column_mask_t columns, const entry_view_callback_t &callback);
 
     // back-end
+    std::vector<int> CreateStagingEntries(const std::vector<DBEntry> &entries);
+    std::vector<int> UpdateStagingEntries(const std::vector<DBEntry> &entries);
     int CreateStagingEntry(const DBEntry &entry);
     DBEntry ReadStagingEntry(const std::string &uuid);
+    DBEntry ReadStagingEntry(const std::string &uuid, entry_column_mask_t columns);
     int UpdateStagingEntry(const DBEntry &entry);
     int DeleteStagingEntry(const std::string &uuid);
 
+    std::vector<int> CreateBlackEntries(const std::vector<DBEntry> &entries);
+    std::vector<int> UpdateBlackEntries(const std::vector<DBEntry> &entries);
     int CreateBlackEntry(const DBEntry &entry);
     DBEntry ReadBlackEntry(const std::string &uuid);
+    DBEntry ReadBlackEntry(const std::string &uuid, entry_column_mask_t columns);
     int UpdateBlackEntry(const DBEntry &entry);
     int DeleteBlackEntry(const std::string &uuid);
 
     int CreateMd5Sum(const DBMd5Sum &md5);
     DBMd5Sum ReadMd5Sum(const std::string &uuid, size_t index_num);
     int UpdateMd5Sum(const DBMd5Sum &md5);
+    int UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s);
     int DeleteMd5Sum(const std::string &uuid, size_t index_num);
 
     int CreateRefresh(const DBRefresh &refresh);
     DBRefresh ReadRefresh(const std::string &uuid);
     int DeleteRefresh(const std::string &uuid);
+    std::vector<DBRefresh> ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit);
+    int CompleteRefresh(const std::string &uuid, const std::string &worker_id);
+    int ReleaseRefresh(const std::string &uuid, const std::string &worker_id);
 
     int CreateErrorEntry(const DBErrorEntry &entry);
     int DeleteErrorEntry(const std::string &uuid, size_t progress_num);
@@ -69,17 +94,37 @@ public:
     DBStringResult GetBlackEntryUUIDFromUrl(const std::string &url);
     DBStringResult GetBlackEntryUrlFromUUID(const std::string &uuid);
 
+    std::vector<DBMd5Sum> GetMd5SumsForUUID(const std::string &uuid);
+    int GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s);
+    DBMd5SumDiff DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh);
+
     uint16_t GetVersionFromMd5(const std::string &uuid, size_t index_num);
 
     DBRefresh GetRefreshFromMinDate();
+    std::vector<DBRefresh> GetDueRefreshes(time_t now, size_t limit);
+
+    DBStatsSnapshot GetStats();
+    DBEntryCacheStats GetEntryCacheStats();
+    DBUrlIndexStats GetStagingUrlIndexStats();
+    DBUrlIndexStats GetBlackUrlIndexStats();
 
     bool IsReady();
 
 private:
+    int BuildUrlIndex(entry_table_rep_t entry_type, DBUrlIndex &url_index);
+    void RemoveUrlIndex(std::unique_ptr<DBUrlIndex> &url_index, const DBStringResult &old_url);
+    void UpdateUrlIndex(std::unique_ptr<DBUrlIndex> &url_index, const DBStringResult &old_url, const std::string &new_url);
+    std::shared_lock<std::shared_mutex> LockShared();
+    std::unique_lock<std::shared_mutex> LockExclusive();
     std::string GetUUID();
 
+    DBStats stats_;
+    std::unique_ptr<DBWorkloadRecorder> workload_recorder_;
     std::unique_ptr<DBConnectionInterface> database_connection_interface_;
-    std::mutex mutex_;
+    std::unique_ptr<DBEntryCache> entry_cache_;
+    std::unique_ptr<DBUrlIndex> staging_url_index_;
+    std::unique_ptr<DBUrlIndex> black_url_index_;
+    std::shared_mutex mutex_;
 };
 
 } // namespace db
@@ -5,8 +5,11 @@
 #ifndef __BLACK_LIBRARY_CORE_DB_BLACKLIBRARYDBDATATYPES_H__
 #define __BLACK_LIBRARY_CORE_DB_BLACKLIBRARYDBDATATYPES_H__
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <vector>
 
 namespace black_library {
 
@@ -15,6 +18,11 @@ namespace core {
 namespace db {
 
 static constexpr const char DefaultDBPath[] = "/mnt/black-library/db/catalog.db";
+static constexpr const size_t DefaultDBReadPoolSize = 4;
+static constexpr const size_t DefaultDBEntryCacheSize = 1024;
+static constexpr const bool DefaultDBUrlIndex = true;
+static constexpr const size_t DefaultDBSlowQueryThresholdMs = 100;
+static constexpr const bool DefaultDBWorkloadBinary = true;
 
 enum class DBPermissions : uint8_t {
     NoPermission = 0,
@@ -117,6 +125,55 @@ inline std::ostream& operator<< (std::ostream &out, const DBEntry &entry)
     return out;
 }
 
+// text fields point into SQLite's column buffers and are only valid inside the callback that received the view
+struct DBEntryView {
+    std::string_view uuid;
+    std::string_view title;
+    std::string_view author;
+    std::string_view nickname;
+    std::string_view source;
+    std::string_view url;
+    std::string_view last_url;
+    std::string_view series;
+    uint16_t series_length = 1;
+    uint16_t version = 1;
+    std::string_view media_path;
+    time_t birth_date = 0;
+    time_t check_date = 0;
+    time_t update_date = 0;
+    UID_rep_t user_contributed = 6;
+
+    void MaterializeInto(DBEntry &entry) const
+    {
+        entry.uuid.assign(uuid.data(), uuid.size());
+        entry.title.assign(title.data(), title.size());
+        entry.author.assign(author.data(), author.size());
+        entry.nickname.assign(nickname.data(), nickname.size());
+        entry.source.assign(source.data(), source.size());
+        entry.url.assign(url.data(), url.size());
+        entry.last_url.assign(last_url.data(), last_url.size());
+        entry.series.assign(series.data(), series.size());
+        entry.series_length = series_length;
+        entry.version = version;
+        entry.media_path.assign(media_path.data(), media_path.size());
+        entry.birth_date = birth_date;
+        entry.check_date = check_date;
+        entry.update_date = update_date;
+        entry.user_contributed = user_contributed;
+    }
+
+    DBEntry Materialize() const
+    {
+        DBEntry entry;
+        MaterializeInto(entry);
+        return entry;
+    }
+};
+
+// return false to stop the scan early
+typedef std::function<bool(const DBEntry &entry)> entry_callback_t;
+typedef std::function<bool(const DBEntryView &view)> entry_view_callback_t;
+
 enum class DBEntryColumnID : uint8_t
 {
     uuid,
@@ -138,6 +195,15 @@ enum class DBEntryColumnID : uint8_t
     _NUM_DB_ENTRY_COLUMN_ID
 };
 
+typedef uint32_t entry_column_mask_t;
+
+constexpr entry_column_mask_t EntryColumnMask(DBEntryColumnID column_id)
+{
+    return entry_column_mask_t(1) << static_cast<uint8_t>(column_id);
+}
+
+static constexpr const entry_column_mask_t AllEntryColumns = EntryColumnMask(DBEntryColumnID::_NUM_DB_ENTRY_COLUMN_ID) - 1;
+
 struct DBMd5Sum {
     std::string uuid;
     size_t index_num;
@@ -155,6 +221,13 @@ inline std::ostream& operator<< (std::ostream &out, const DBMd5Sum &sum)
     return out;
 }
 
+struct DBMd5SumDiff {
+    std::vector<size_t> new_indices;
+    std::vector<size_t> changed_indices;
+    std::vector<size_t> vanished_indices;
+    int error = 0;
+};
+
 enum class DBMd5SumColumnID : uint8_t
 {
     uuid,
@@ -23,22 +23,37 @@ public:
     virtual ~DBConnectionInterface() {}
 
     virtual std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type) const = 0;
+    virtual std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type, entry_column_mask_t columns) const = 0;
+    virtual int ForEachEntry(entry_table_rep_t entry_type, const entry_callback_t &callback) const = 0;
+    virtual int ForEachEntry(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_callback_t &callback) const = 0;
+    virtual int ForEachEntryView(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_view_callback_t &callback) const = 0;
     virtual std::vector<DBMd5Sum> ListChecksums() const = 0;
     virtual std::vector<DBErrorEntry> ListErrorEntries() const = 0;
+    virtual int ListEntriesPage(entry_table_rep_t entry_type, const std::string &after_uuid, size_t limit, std::vector<DBEntry> &entries) const = 0;
+    virtual int ListChecksumsPage(const std::string &after_uuid, size_t after_index_num, size_t limit, std::vector<DBMd5Sum> &checksums) const = 0;
+    virtual int ListErrorEntriesPage(const std::string &after_uuid, size_t limit, std::vector<DBErrorEntry> &entries) const = 0;
+
+    virtual std::vector<int> CreateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const = 0;
+    virtual std::vector<int> UpdateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const = 0;
 
     virtual int CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const = 0;
     virtual DBEntry ReadEntry(const std::string &uuid, entry_table_rep_t entry_type) const = 0;
+    virtual DBEntry ReadEntry(const std::string &uuid, entry_table_rep_t entry_type, entry_column_mask_t columns) const = 0;
     virtual int UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const = 0;
     virtual int DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type) const = 0;
 
     virtual int CreateMd5Sum(const DBMd5Sum &md5) const = 0;
     virtual DBMd5Sum ReadMd5Sum(const std::string &uuid, size_t index_num) const = 0;
     virtual int UpdateMd5Sum(const DBMd5Sum &md5) const = 0;
+    virtual int UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s) const = 0;
     virtual int DeleteMd5Sum(const std::string &uuid, size_t index_num) const = 0;
 
     virtual int CreateRefresh(const DBRefresh &refresh) const = 0;
     virtual DBRefresh ReadRefresh(const std::string &uuid) const = 0;
     virtual int DeleteRefresh(const std::string &uuid) const = 0;
+    virtual int ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit, std::vector<DBRefresh> &refreshes) const = 0;
+    virtual int CompleteRefresh(const std::string &uuid, const std::string &worker_id) const = 0;
+    virtual int ReleaseRefresh(const std::string &uuid, const std::string &worker_id) const = 0;
 
     virtual int CreateErrorEntry(const DBErrorEntry &entry) const = 0;
     virtual int DeleteErrorEntry(const std::string &uuid, size_t progress_num) const = 0;
@@ -53,9 +68,14 @@ public:
     virtual DBStringResult GetEntryUUIDFromUrl(const std::string &url, entry_table_rep_t entry_type) const = 0;
     virtual DBStringResult GetEntryUrlFromUUID(const std::string &uuid, entry_table_rep_t entry_type) const = 0;
 
+    virtual int GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s) const = 0;
+    virtual DBMd5SumDiff DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh) const = 0;
+
     virtual uint16_t GetVersionFromMd5(const std::string &uuid, size_t index_num) const = 0;
 
+    // both skip refreshes under an unexpired lease, only ClaimRefreshes keeps two workers off the same row
     virtual DBRefresh GetRefreshFromMinDate() const = 0;
+    virtual int GetDueRefreshes(time_t now, size_t limit, std::vector<DBRefresh> &refreshes) const = 0;
 
     virtual bool IsReady() const = 0;
 
@@ -0,0 +1,68 @@
+/**
+ * DBEntryCache.h
+ */
+
+#ifndef __BLACK_LIBRARY_CORE_DB_DBENTRYCACHE_H__
+#define __BLACK_LIBRARY_CORE_DB_DBENTRYCACHE_H__
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <BlackLibraryDBDataTypes.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+struct DBEntryCacheStats {
+    size_t capacity = 0;
+    size_t size = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+// bounded LRU of entries keyed by UUID and entry table, a capacity of 0 disables it
+class DBEntryCache
+{
+public:
+    explicit DBEntryCache(size_t capacity);
+
+    bool Get(const std::string &uuid, entry_table_rep_t entry_type, DBEntry &entry);
+    void Put(const DBEntry &entry, entry_table_rep_t entry_type);
+    void Invalidate(const std::string &uuid, entry_table_rep_t entry_type);
+    void Clear();
+
+    DBEntryCacheStats GetStats() const;
+
+private:
+    typedef std::pair<entry_table_rep_t, std::string> cache_key_t;
+    typedef std::list<std::pair<cache_key_t, DBEntry>> lru_list_t;
+
+    struct CacheKeyHash {
+        size_t operator()(const cache_key_t &key) const
+        {
+            return std::hash<std::string>()(key.second) ^ key.first;
+        }
+    };
+
+    const size_t capacity_;
+    lru_list_t lru_;
+    std::unordered_map<cache_key_t, lru_list_t::iterator, CacheKeyHash> index_;
+    mutable std::mutex mutex_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+};
+
+} // namespace db
+} // namespace core
+} // namespace black_library
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * DBStats.h
+ */
+
+#ifndef __BLACK_LIBRARY_CORE_DB_DBSTATS_H__
+#define __BLACK_LIBRARY_CORE_DB_DBSTATS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ConfigOperations.h>
+
+#include <BlackLibraryDBDataTypes.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+// one per DBConnectionInterface method, overloads share an id
+typedef enum {
+    LIST_ENTRIES_OPERATION,
+    FOR_EACH_ENTRY_OPERATION,
+    FOR_EACH_ENTRY_VIEW_OPERATION,
+    LIST_CHECKSUMS_OPERATION,
+    LIST_ERROR_ENTRIES_OPERATION,
+    LIST_ENTRIES_PAGE_OPERATION,
+    LIST_CHECKSUMS_PAGE_OPERATION,
+    LIST_ERROR_ENTRIES_PAGE_OPERATION,
+
+    CREATE_ENTRIES_OPERATION,
+    UPDATE_ENTRIES_OPERATION,
+
+    CREATE_ENTRY_OPERATION,
+    READ_ENTRY_OPERATION,
+    UPDATE_ENTRY_OPERATION,
+    DELETE_ENTRY_OPERATION,
+
+    CREATE_MD5_SUM_OPERATION,
+    READ_MD5_SUM_OPERATION,
+    UPDATE_MD5_SUM_OPERATION,
+    UPSERT_MD5_SUMS_OPERATION,
+    DELETE_MD5_SUM_OPERATION,
+
+    CREATE_REFRESH_OPERATION,
+    READ_REFRESH_OPERATION,
+    DELETE_REFRESH_OPERATION,
+    CLAIM_REFRESHES_OPERATION,
+    COMPLETE_REFRESH_OPERATION,
+    RELEASE_REFRESH_OPERATION,
+
+    CREATE_ERROR_ENTRY_OPERATION,
+    DELETE_ERROR_ENTRY_OPERATION,
+
+    DOES_ENTRY_URL_EXIST_OPERATION,
+    DOES_ENTRY_UUID_EXIST_OPERATION,
+    DOES_MD5_SUM_EXIST_OPERATION,
+    DOES_REFRESH_EXIST_OPERATION,
+    DOES_MIN_REFRESH_EXIST_OPERATION,
+    DOES_ERROR_ENTRY_EXIST_OPERATION,
+
+    GET_ENTRY_UUID_FROM_URL_OPERATION,
+    GET_ENTRY_URL_FROM_UUID_OPERATION,
+
+    GET_MD5_SUMS_FOR_UUID_OPERATION,
+    DIFF_MD5_SUMS_OPERATION,
+    GET_VERSION_FROM_MD5_OPERATION,
+
+    GET_REFRESH_FROM_MIN_DATE_OPERATION,
+    GET_DUE_REFRESHES_OPERATION,
+
+    _NUM_DB_OPERATIONS
+} db_operation_id_t;
+
+struct DBLatencyStats {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    double mean_us = 0;
+    double p50_us = 0;
+    double p90_us = 0;
+    double p99_us = 0;
+};
+
+struct DBOperationStats {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    DBLatencyStats latency;
+};
+
+struct DBStatsSnapshot {
+    std::vector<DBOperationStats> operations;
+    DBLatencyStats shared_lock_wait;
+    DBLatencyStats exclusive_lock_wait;
+
+    njson ToJson() const;
+};
+
+// log-linear buckets, four per power of two, so percentiles are within 25% of the recorded value.
+// Record is wait-free, a snapshot taken during recording may be off by the in-flight samples
+class DBLatencyHistogram
+{
+public:
+    DBLatencyHistogram();
+
+    void Record(uint64_t latency_ns);
+    DBLatencyStats GetStats() const;
+
+private:
+    static constexpr size_t SubBucketBits = 2;
+    static constexpr size_t NumBuckets = (64 + 1) << SubBucketBits;
+
+    static size_t BucketIndex(uint64_t latency_ns);
+    static uint64_t BucketUpperBound(size_t bucket_index);
+
+    std::array<std::atomic<uint64_t>, NumBuckets> buckets_;
+    std::atomic<uint64_t> total_ns_;
+    std::atomic<uint64_t> max_ns_;
+};
+
+// counters for every connection operation plus the facade lock waits, safe to record from any thread
+class DBStats
+{
+public:
+    DBStats();
+
+    void RecordOperation(db_operation_id_t operation_id, uint64_t latency_ns, bool error);
+    void RecordSharedLockWait(uint64_t wait_ns);
+    void RecordExclusiveLockWait(uint64_t wait_ns);
+
+    DBStatsSnapshot GetStats() const;
+
+    static const char *OperationName(db_operation_id_t operation_id);
+
+private:
+    struct OperationCounters {
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> errors{ 0 };
+        DBLatencyHistogram latency;
+    };
+
+    std::array<OperationCounters, _NUM_DB_OPERATIONS> operations_;
+    DBLatencyHistogram shared_lock_wait_;
+    DBLatencyHistogram exclusive_lock_wait_;
+};
+
+// records the elapsed time of one operation when it goes out of scope
+class DBOperationTimer
+{
+public:
+    DBOperationTimer(DBStats &stats, db_operation_id_t operation_id) :
+        stats_(stats),
+        operation_id_(operation_id),
+        start_(std::chrono::steady_clock::now()),
+        error_(false)
+    {
+    }
+
+    ~DBOperationTimer()
+    {
+        const uint64_t latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        stats_.RecordOperation(operation_id_, latency_ns, error_);
+    }
+
+    DBOperationTimer(const DBOperationTimer &) = delete;
+    DBOperationTimer &operator=(const DBOperationTimer &) = delete;
+
+    // passes the result through, marking the operation failed when the result reports an error
+    int Result(int res)
+    {
+        error_ = res != 0;
+        return res;
+    }
+
+    DBBoolResult Result(DBBoolResult res)
+    {
+        error_ = res.error != 0;
+        return res;
+    }
+
+    DBStringResult Result(DBStringResult res)
+    {
+        error_ = res.error != 0;
+        return res;
+    }
+
+    // entry and refresh reads report a failure or a missing row with an empty UUID
+    DBEntry Result(DBEntry res)
+    {
+        error_ = res.uuid.empty();
+        return res;
+    }
+
+    DBRefresh Result(DBRefresh res)
+    {
+        error_ = res.uuid.empty();
+        return res;
+    }
+
+    DBMd5SumDiff Result(DBMd5SumDiff res)
+    {
+        error_ = res.error != 0;
+        return res;
+    }
+
+    std::vector<int> Result(std::vector<int> res)
+    {
+        for (const auto &r : res)
+        {
+            error_ = error_ || r != 0;
+        }
+        return res;
+    }
+
+    template <typename T>
+    T Result(T &&res)
+    {
+        return std::forward<T>(res);
+    }
+
+private:
+    DBStats &stats_;
+    const db_operation_id_t operation_id_;
+    const std::chrono::steady_clock::time_point start_;
+    bool error_;
+};
+
+} // namespace db
+} // namespace core
+} // namespace black_library
+
+#endif
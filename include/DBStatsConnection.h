@@ -0,0 +1,91 @@
+/**
+ * DBStatsConnection.h
+ */
+
+#ifndef __BLACK_LIBRARY_CORE_DB_DBSTATSCONNECTION_H__
+#define __BLACK_LIBRARY_CORE_DB_DBSTATSCONNECTION_H__
+
+#include <memory>
+
+#include <DBConnectionInterface.h>
+#include <DBStats.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+// forwards every call to the wrapped connection, recording calls, errors and latency in stats
+class DBStatsConnection : public DBConnectionInterface
+{
+public:
+    DBStatsConnection(std::unique_ptr<DBConnectionInterface> connection, DBStats &stats);
+    ~DBStatsConnection();
+
+    std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type) const override;
+    std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type, entry_column_mask_t columns) const override;
+    int ForEachEntry(entry_table_rep_t entry_type, const entry_callback_t &callback) const override;
+    int ForEachEntry(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_callback_t &callback) const override;
+    int ForEachEntryView(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_view_callback_t &callback) const override;
+    std::vector<DBMd5Sum> ListChecksums() const override;
+    std::vector<DBErrorEntry> ListErrorEntries() const override;
+    int ListEntriesPage(entry_table_rep_t entry_type, const std::string &after_uuid, size_t limit, std::vector<DBEntry> &entries) const override;
+    int ListChecksumsPage(const std::string &after_uuid, size_t after_index_num, size_t limit, std::vector<DBMd5Sum> &checksums) const override;
+    int ListErrorEntriesPage(const std::string &after_uuid, size_t limit, std::vector<DBErrorEntry> &entries) const override;
+
+    std::vector<int> CreateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const override;
+    std::vector<int> UpdateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const override;
+
+    int CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const override;
+    DBEntry ReadEntry(const std::string &uuid, entry_table_rep_t entry_type) const override;
+    DBEntry ReadEntry(const std::string &uuid, entry_table_rep_t entry_type, entry_column_mask_t columns) const override;
+    int UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const override;
+    int DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type) const override;
+
+    int CreateMd5Sum(const DBMd5Sum &md5) const override;
+    DBMd5Sum ReadMd5Sum(const std::string &uuid, size_t index_num) const override;
+    int UpdateMd5Sum(const DBMd5Sum &md5) const override;
+    int UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s) const override;
+    int DeleteMd5Sum(const std::string &uuid, size_t index_num) const override;
+
+    int CreateRefresh(const DBRefresh &refresh) const override;
+    DBRefresh ReadRefresh(const std::string &uuid) const override;
+    int DeleteRefresh(const std::string &uuid) const override;
+    int ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit, std::vector<DBRefresh> &refreshes) const override;
+    int CompleteRefresh(const std::string &uuid, const std::string &worker_id) const override;
+    int ReleaseRefresh(const std::string &uuid, const std::string &worker_id) const override;
+
+    int CreateErrorEntry(const DBErrorEntry &entry) const override;
+    int DeleteErrorEntry(const std::string &uuid, size_t progress_num) const override;
+
+    DBBoolResult DoesEntryUrlExist(const std::string &url, entry_table_rep_t entry_type) const override;
+    DBBoolResult DoesEntryUUIDExist(const std::string &uuid, entry_table_rep_t entry_type) const override;
+    DBBoolResult DoesMd5SumExist(const std::string &uuid, size_t index_num) const override;
+    DBBoolResult DoesRefreshExist(const std::string &uuid) const override;
+    DBBoolResult DoesMinRefreshExist() const override;
+    DBBoolResult DoesErrorEntryExist(const std::string &uuid, size_t progress_num) const override;
+
+    DBStringResult GetEntryUUIDFromUrl(const std::string &url, entry_table_rep_t entry_type) const override;
+    DBStringResult GetEntryUrlFromUUID(const std::string &uuid, entry_table_rep_t entry_type) const override;
+
+    int GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s) const override;
+    DBMd5SumDiff DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh) const override;
+
+    uint16_t GetVersionFromMd5(const std::string &uuid, size_t index_num) const override;
+
+    DBRefresh GetRefreshFromMinDate() const override;
+    int GetDueRefreshes(time_t now, size_t limit, std::vector<DBRefresh> &refreshes) const override;
+
+    bool IsReady() const override;
+
+private:
+    std::unique_ptr<DBConnectionInterface> connection_;
+    DBStats &stats_;
+};
+
+} // namespace db
+} // namespace core
+} // namespace black_library
+
+#endif
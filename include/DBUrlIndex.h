@@ -0,0 +1,71 @@
+/**
+ * DBUrlIndex.h
+ */
+
+#ifndef __BLACK_LIBRARY_CORE_DB_DBURLINDEX_H__
+#define __BLACK_LIBRARY_CORE_DB_DBURLINDEX_H__
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <BlackLibraryDBDataTypes.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+struct DBUrlIndexStats {
+    size_t urls = 0;
+    size_t bloom_bits = 0;
+    size_t bloom_hashes = 0;
+    size_t memory_bytes = 0;
+    uint64_t lookups = 0;
+    uint64_t bloom_negatives = 0;
+    uint64_t bloom_false_positives = 0;
+    uint64_t hits = 0;
+};
+
+// in-process set of the urls in one entry table, a bloom filter answers definite misses and
+// a hash index of url counts settles the rest. Contains may run concurrently, Add, Remove and
+// Clear must be serialized against every other call by the owner
+class DBUrlIndex
+{
+public:
+    explicit DBUrlIndex(size_t expected_urls = 0);
+
+    void Add(const std::string &url);
+    void Remove(const std::string &url);
+    bool Contains(const std::string &url) const;
+    bool MayContain(const std::string &url) const;
+    void Clear();
+
+    size_t Size() const;
+    DBUrlIndexStats GetStats() const;
+
+private:
+    void Rebuild(size_t capacity);
+    void SetBloomBits(uint64_t hash);
+    bool TestBloomBits(uint64_t hash) const;
+    static uint64_t HashUrl(const std::string &url);
+
+    std::vector<uint64_t> bloom_;
+    size_t bloom_bits_;
+    size_t capacity_;
+    size_t stale_urls_;
+    std::unordered_map<std::string, uint32_t> urls_;
+    size_t url_bytes_;
+    mutable std::atomic<uint64_t> lookups_;
+    mutable std::atomic<uint64_t> bloom_negatives_;
+    mutable std::atomic<uint64_t> bloom_false_positives_;
+    mutable std::atomic<uint64_t> hits_;
+};
+
+} // namespace db
+} // namespace core
+} // namespace black_library
+
+#endif
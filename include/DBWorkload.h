@@ -0,0 +1,96 @@
+/**
+ * DBWorkload.h
+ */
+
+#ifndef __BLACK_LIBRARY_CORE_DB_DBWORKLOAD_H__
+#define __BLACK_LIBRARY_CORE_DB_DBWORKLOAD_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <ConfigOperations.h>
+
+#include <DBConnectionInterface.h>
+#include <DBStats.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+class BlackLibraryDB;
+
+typedef enum {
+    DB_WORKLOAD_JSON_FORMAT,
+    DB_WORKLOAD_BINARY_FORMAT,
+
+    _NUM_DB_WORKLOAD_FORMATS
+} db_workload_format_t;
+
+// one recorded BlackLibraryDB call, args holds the call parameters in connection interface order
+// with the entry type standing in for the staging or black method
+struct DBWorkloadRecord {
+    db_operation_id_t operation;
+    // since the recorder was opened
+    uint64_t offset_ns = 0;
+    // recorder assigned index of the calling thread
+    uint32_t thread = 0;
+    njson args;
+};
+
+// appends calls to a trace file, safe to record from any thread.
+// calls are stamped and queued under the lock so the trace is in offset order, a writer thread
+// encodes and writes them. json traces are one array per line, binary traces are length prefixed msgpack records
+class DBWorkloadRecorder
+{
+public:
+    DBWorkloadRecorder();
+    ~DBWorkloadRecorder();
+
+    int Open(const std::string &path, db_workload_format_t format);
+    void Record(db_operation_id_t operation, njson args);
+    int Close();
+
+    uint64_t GetRecordCount();
+
+private:
+    void WriteRecords();
+
+    std::ofstream out_;
+    std::vector<DBWorkloadRecord> pending_;
+    std::unordered_map<std::thread::id, uint32_t> threads_;
+    std::chrono::steady_clock::time_point start_;
+    std::thread writer_;
+    std::condition_variable pending_cv_;
+    std::mutex mutex_;
+    uint64_t record_count_;
+    db_workload_format_t format_;
+    bool open_;
+};
+
+// rows are recorded as arrays in the column order of SQLiteColumns.h
+njson WorkloadRowToJson(const DBEntry &entry);
+njson WorkloadRowToJson(const DBMd5Sum &md5);
+njson WorkloadRowToJson(const DBRefresh &refresh);
+njson WorkloadRowToJson(const DBErrorEntry &entry);
+njson WorkloadRowToJson(const std::vector<DBEntry> &entries);
+njson WorkloadRowToJson(const std::vector<DBMd5Sum> &md5s);
+
+// reads either format, the format is told apart by the binary header
+int ReadDBWorkload(const std::string &path, std::vector<DBWorkloadRecord> &records);
+
+// issues the recorded call through the facade, returns -1 when the call reports an error or its args do not decode
+int ReplayDBWorkloadRecord(BlackLibraryDB &db, const DBWorkloadRecord &record);
+
+} // namespace db
+} // namespace core
+} // namespace black_library
+
+#endif
@@ -0,0 +1,300 @@
+/**
+ * SQLiteColumns.h
+ */
+
+#ifndef __BLACK_LIBRARY_CORE_DB_SQLITECOLUMNS_H__
+#define __BLACK_LIBRARY_CORE_DB_SQLITECOLUMNS_H__
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <sqlite3.h>
+
+#include <BlackLibraryDBDataTypes.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+// one column of a table, the position in its descriptor table is the bind position and the select position
+template <typename Row, typename Field>
+struct SQLiteColumn {
+    const char *name;
+    Field Row::*member;
+};
+
+template <typename Row, typename Field>
+constexpr SQLiteColumn<Row, Field> MakeSQLiteColumn(const char *name, Field Row::*member)
+{
+    return SQLiteColumn<Row, Field>{ name, member };
+}
+
+// in table order, the order of DBEntryColumnID
+static constexpr auto EntryColumns = std::make_tuple(
+    MakeSQLiteColumn("UUID", &DBEntry::uuid),
+    MakeSQLiteColumn("title", &DBEntry::title),
+    MakeSQLiteColumn("author", &DBEntry::author),
+    MakeSQLiteColumn("nickname", &DBEntry::nickname),
+    MakeSQLiteColumn("source", &DBEntry::source),
+    MakeSQLiteColumn("url", &DBEntry::url),
+    MakeSQLiteColumn("last_url", &DBEntry::last_url),
+    MakeSQLiteColumn("series", &DBEntry::series),
+    MakeSQLiteColumn("series_length", &DBEntry::series_length),
+    MakeSQLiteColumn("version", &DBEntry::version),
+    MakeSQLiteColumn("media_path", &DBEntry::media_path),
+    MakeSQLiteColumn("birth_date", &DBEntry::birth_date),
+    MakeSQLiteColumn("check_date", &DBEntry::check_date),
+    MakeSQLiteColumn("update_date", &DBEntry::update_date),
+    MakeSQLiteColumn("user_contributed", &DBEntry::user_contributed)
+);
+
+static constexpr auto EntryViewColumns = std::make_tuple(
+    MakeSQLiteColumn("UUID", &DBEntryView::uuid),
+    MakeSQLiteColumn("title", &DBEntryView::title),
+    MakeSQLiteColumn("author", &DBEntryView::author),
+    MakeSQLiteColumn("nickname", &DBEntryView::nickname),
+    MakeSQLiteColumn("source", &DBEntryView::source),
+    MakeSQLiteColumn("url", &DBEntryView::url),
+    MakeSQLiteColumn("last_url", &DBEntryView::last_url),
+    MakeSQLiteColumn("series", &DBEntryView::series),
+    MakeSQLiteColumn("series_length", &DBEntryView::series_length),
+    MakeSQLiteColumn("version", &DBEntryView::version),
+    MakeSQLiteColumn("media_path", &DBEntryView::media_path),
+    MakeSQLiteColumn("birth_date", &DBEntryView::birth_date),
+    MakeSQLiteColumn("check_date", &DBEntryView::check_date),
+    MakeSQLiteColumn("update_date", &DBEntryView::update_date),
+    MakeSQLiteColumn("user_contributed", &DBEntryView::user_contributed)
+);
+
+static constexpr auto Md5SumColumns = std::make_tuple(
+    MakeSQLiteColumn("UUID", &DBMd5Sum::uuid),
+    MakeSQLiteColumn("index_num", &DBMd5Sum::index_num),
+    MakeSQLiteColumn("md5_sum", &DBMd5Sum::md5_sum),
+    MakeSQLiteColumn("version_num", &DBMd5Sum::version_num)
+);
+
+static constexpr auto RefreshColumns = std::make_tuple(
+    MakeSQLiteColumn("UUID", &DBRefresh::uuid),
+    MakeSQLiteColumn("refresh_date", &DBRefresh::refresh_date)
+);
+
+static constexpr auto ErrorEntryColumns = std::make_tuple(
+    MakeSQLiteColumn("UUID", &DBErrorEntry::uuid),
+    MakeSQLiteColumn("progress_num", &DBErrorEntry::progress_num)
+);
+
+template <typename Columns>
+constexpr size_t SQLiteColumnCount(const Columns &)
+{
+    return std::tuple_size<Columns>::value;
+}
+
+template <typename Columns, size_t... I>
+constexpr std::array<const char *, sizeof...(I)> SQLiteColumnNames(const Columns &columns, std::index_sequence<I...>)
+{
+    return { { std::get<I>(columns).name... } };
+}
+
+template <typename Columns>
+constexpr std::array<const char *, std::tuple_size<Columns>::value> SQLiteColumnNames(const Columns &columns)
+{
+    return SQLiteColumnNames(columns, std::make_index_sequence<std::tuple_size<Columns>::value>());
+}
+
+constexpr bool SQLiteColumnNameEqual(const char *lhs, const char *rhs)
+{
+    while (*lhs && *lhs == *rhs)
+    {
+        ++lhs;
+        ++rhs;
+    }
+
+    return *lhs == *rhs;
+}
+
+template <typename LhsColumns, typename RhsColumns, size_t... I>
+constexpr bool SQLiteColumnNamesMatch(const LhsColumns &lhs, const RhsColumns &rhs, std::index_sequence<I...>)
+{
+    return (SQLiteColumnNameEqual(std::get<I>(lhs).name, std::get<I>(rhs).name) && ...);
+}
+
+template <typename LhsColumns, typename RhsColumns>
+constexpr bool SQLiteColumnNamesMatch(const LhsColumns &lhs, const RhsColumns &rhs)
+{
+    return std::tuple_size<LhsColumns>::value == std::tuple_size<RhsColumns>::value &&
+        SQLiteColumnNamesMatch(lhs, rhs, std::make_index_sequence<std::tuple_size<LhsColumns>::value>());
+}
+
+static_assert(SQLiteColumnCount(EntryColumns) == static_cast<size_t>(DBEntryColumnID::_NUM_DB_ENTRY_COLUMN_ID), "EntryColumns must match DBEntryColumnID");
+static_assert(SQLiteColumnCount(Md5SumColumns) == static_cast<size_t>(DBMd5SumColumnID::_NUM_DB_MD5SUM_COLUMN_ID), "Md5SumColumns must match DBMd5SumColumnID");
+static_assert(SQLiteColumnNamesMatch(EntryColumns, EntryViewColumns), "EntryViewColumns must match EntryColumns");
+
+// text is bound SQLITE_STATIC, the row must outlive the step
+inline int BindSQLiteValue(sqlite3_stmt *stmt, int position, const std::string &value)
+{
+    return sqlite3_bind_text(stmt, position, value.c_str(), value.length(), SQLITE_STATIC);
+}
+
+template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline int BindSQLiteValue(sqlite3_stmt *stmt, int position, const T &value)
+{
+    return sqlite3_bind_int64(stmt, position, static_cast<sqlite3_int64>(value));
+}
+
+// NULL text reads back as empty
+inline void ReadSQLiteValue(sqlite3_stmt *stmt, int column_index, std::string &value)
+{
+    const unsigned char *text = sqlite3_column_text(stmt, column_index);
+    if (!text)
+    {
+        value.clear();
+        return;
+    }
+
+    value.assign(reinterpret_cast<const char *>(text), sqlite3_column_bytes(stmt, column_index));
+}
+
+// the view is valid until the statement steps or resets
+inline void ReadSQLiteValue(sqlite3_stmt *stmt, int column_index, std::string_view &value)
+{
+    const unsigned char *text = sqlite3_column_text(stmt, column_index);
+    if (!text)
+    {
+        value = std::string_view();
+        return;
+    }
+
+    value = std::string_view(reinterpret_cast<const char *>(text), sqlite3_column_bytes(stmt, column_index));
+}
+
+template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline void ReadSQLiteValue(sqlite3_stmt *stmt, int column_index, T &value)
+{
+    value = static_cast<T>(sqlite3_column_int64(stmt, column_index));
+}
+
+// binds every column of the row at its position, returns the first failing sqlite result
+template <typename Row, typename Columns, size_t... I>
+inline int BindSQLiteRow(sqlite3_stmt *stmt, const Row &row, const Columns &columns, std::index_sequence<I...>)
+{
+    int ret = SQLITE_OK;
+    ((ret = ret == SQLITE_OK ? BindSQLiteValue(stmt, static_cast<int>(I) + 1, row.*(std::get<I>(columns).member)) : ret), ...);
+
+    return ret;
+}
+
+template <typename Row, typename Columns>
+inline int BindSQLiteRow(sqlite3_stmt *stmt, const Row &row, const Columns &columns)
+{
+    return BindSQLiteRow(stmt, row, columns, std::make_index_sequence<std::tuple_size<Columns>::value>());
+}
+
+template <typename Row, typename Columns, size_t... I>
+inline void ReadSQLiteRow(sqlite3_stmt *stmt, Row &row, const Columns &columns, std::index_sequence<I...>)
+{
+    (ReadSQLiteValue(stmt, static_cast<int>(I), row.*(std::get<I>(columns).member)), ...);
+}
+
+// the statement must select the columns in descriptor order
+template <typename Row, typename Columns>
+inline void ReadSQLiteRow(sqlite3_stmt *stmt, Row &row, const Columns &columns)
+{
+    ReadSQLiteRow(stmt, row, columns, std::make_index_sequence<std::tuple_size<Columns>::value>());
+}
+
+template <typename Row, typename Columns, size_t... I>
+inline void ReadSQLiteRowColumns(sqlite3_stmt *stmt, uint32_t column_mask, Row &row, const Columns &columns, std::index_sequence<I...>)
+{
+    int column_index = 0;
+    ((column_mask & (uint32_t(1) << I) ? ReadSQLiteValue(stmt, column_index++, row.*(std::get<I>(columns).member)) : void()), ...);
+}
+
+// for statements that only select the masked columns, in descriptor order
+template <typename Row, typename Columns>
+inline void ReadSQLiteRowColumns(sqlite3_stmt *stmt, uint32_t column_mask, Row &row, const Columns &columns)
+{
+    ReadSQLiteRowColumns(stmt, column_mask, row, columns, std::make_index_sequence<std::tuple_size<Columns>::value>());
+}
+
+// SELECT <masked columns> FROM <table> <tail>
+template <typename Columns>
+std::string SelectSQLiteRowSQL(const Columns &columns, const std::string &table_name, const std::string &tail = "",
+    uint32_t column_mask = ~uint32_t(0))
+{
+    const auto names = SQLiteColumnNames(columns);
+
+    std::string sql = "SELECT ";
+    bool first_column = true;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (!(column_mask & (uint32_t(1) << i)))
+            continue;
+
+        if (!first_column)
+            sql += ", ";
+        sql += names[i];
+        first_column = false;
+    }
+    sql += " FROM " + table_name;
+    if (!tail.empty())
+        sql += " " + tail;
+
+    return sql;
+}
+
+// INSERT INTO <table>(<columns>) VALUES (?1, ...) <tail>
+template <typename Columns>
+std::string InsertSQLiteRowSQL(const Columns &columns, const std::string &table_name, const std::string &tail = "")
+{
+    const auto names = SQLiteColumnNames(columns);
+
+    std::string column_list;
+    std::string value_list;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (i > 0)
+        {
+            column_list += ", ";
+            value_list += ", ";
+        }
+        column_list += names[i];
+        value_list += "?" + std::to_string(i + 1);
+    }
+
+    std::string sql = "INSERT INTO " + table_name + "(" + column_list + ") VALUES (" + value_list + ")";
+    if (!tail.empty())
+        sql += " " + tail;
+
+    return sql;
+}
+
+// UPDATE <table> SET <other columns> WHERE <first key_count columns>, binds like the insert
+template <typename Columns>
+std::string UpdateSQLiteRowSQL(const Columns &columns, const std::string &table_name, size_t key_count = 1)
+{
+    const auto names = SQLiteColumnNames(columns);
+
+    std::string set_list;
+    std::string where_list;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::string &list = i < key_count ? where_list : set_list;
+        if (!list.empty())
+            list += i < key_count ? " AND " : ", ";
+        list += std::string(names[i]) + " = ?" + std::to_string(i + 1);
+    }
+
+    return "UPDATE " + table_name + " SET " + set_list + " WHERE " + where_list;
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
+
+#endif
@@ -5,46 +5,132 @@
 #ifndef __BLACK_LIBRARY_CORE_DB_SQLITEDB_H__
 #define __BLACK_LIBRARY_CORE_DB_SQLITEDB_H__
 
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include <sqlite3.h>
 
 #include <DBConnectionInterface.h>
 
+namespace spdlog {
+class logger;
+}
+
 namespace black_library {
 
 namespace core {
 
 namespace db {
 
+typedef enum {
+    UID_PARAMETER,
+    UUID_PARAMETER,
+    AUTHOR_PARAMETER,
+    BIRTH_DATE_PARAMETER,
+    CHECK_DATE_PARAMETER,
+    INDEX_NUM_PARAMETER,
+    LAST_URL_PARAMETER,
+    LEASE_EXPIRES_PARAMETER,
+    LEASE_OWNER_PARAMETER,
+    LIMIT_PARAMETER,
+    MD5_SUM_PARAMETER,
+    MEDIA_PATH_PARAMETER,
+    MEDIA_SUBTYPE_PARAMETER,
+    MEDIA_TYPE_PARAMETER,
+    MEDIA_TYPE_NAME_PARAMETER,
+    NAME_PARAMETER,
+    NICKNAME_PARAMETER,
+    NOW_PARAMETER,
+    PERMISSION_LEVEL_PARAMETER,
+    PROGRESS_NUM_PARAMETER,
+    REFRESH_DATE_PARAMETER,
+    SERIES_PARAMETER,
+    SERIES_LENGTH_PARAMETER,
+    SOURCE_PARAMETER,
+    TITLE_PARAMETER,
+    UPDATE_DATE_PARAMETER,
+    URL_PARAMETER,
+    USER_CONTRIBUTED_PARAMETER,
+    VERSION_PARAMETER,
+    VERSION_NUM_PARAMETER,
+
+    _NUM_SQLITE_PARAMETERS
+} sqlite_parameter_id_t;
+
+// bind index of each parameter in one statement, 0 when the statement does not use it
+typedef std::array<int, _NUM_SQLITE_PARAMETERS> sqlite_parameter_indices_t;
+
+struct SQLiteConnection {
+    sqlite3 *database_conn = nullptr;
+    std::vector<sqlite3_stmt *> prepared_statements;
+    // resolved when a statement is prepared, indexed by statement id like prepared_statements.
+    // projected statements keep the where clause of the statement they project and share its indices
+    std::vector<sqlite_parameter_indices_t> parameter_indices;
+    // prepared on first use per column mask, only touched by the thread holding the connection
+    mutable std::unordered_map<uint64_t, sqlite3_stmt *> projected_statements;
+};
+
+// EXPLAIN QUERY PLAN of one prepared statement, one detail line per plan row
+struct SQLiteQueryPlan {
+    std::string statement_name;
+    std::string sql;
+    std::vector<std::string> details;
+};
+
+struct SQLiteMigration {
+    int version;
+    const char *description;
+    std::vector<const char *> statements;
+};
+
 class SQLiteDB : public DBConnectionInterface
 {
 public:
-    explicit SQLiteDB(const std::string &database_url);
+    explicit SQLiteDB(const std::string &database_url, size_t read_pool_size = DefaultDBReadPoolSize,
+        size_t slow_query_threshold_ms = DefaultDBSlowQueryThresholdMs);
     ~SQLiteDB();
 
-    std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type) const;
-    std::vector<DBMd5Sum> ListChecksums() const;
-    std::vector<DBErrorEntry> ListErrorEntries() const;
+    std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type) const override;
+    std::vector<DBEntry> ListEntries(entry_table_rep_t entry_type, entry_column_mask_t columns) const override;
+    int ForEachEntry(entry_table_rep_t entry_type, const entry_callback_t &callback) const override;
+    int ForEachEntry(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_callback_t &callback) const override;
+    int ForEachEntryView(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_view_callback_t &callback) const override;
+    std::vector<DBMd5Sum> ListChecksums() const override;
+    std::vector<DBErrorEntry> ListErrorEntries() const override;
+    int ListEntriesPage(entry_table_rep_t entry_type, const std::string &after_uuid, size_t limit, std::vector<DBEntry> &entries) const override;
+    int ListChecksumsPage(const std::string &after_uuid, size_t after_index_num, size_t limit, std::vector<DBMd5Sum> &checksums) const override;
+    int ListErrorEntriesPage(const std::string &after_uuid, size_t limit, std::vector<DBErrorEntry> &entries) const override;
 
     int CreateUser(const DBUser &user) const;
     int CreateMediaType(const std::string &media_type_name) const;
     int CreateMediaSubtype(const std::string &media_subtype_name, const std::string &media_type_name) const;
     int CreateSource(const DBSource &source) const;
 
+    std::vector<int> CreateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const override;
+    std::vector<int> UpdateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const override;
+
     int CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const override;
     DBEntry ReadEntry(const std::string &uuid, entry_table_rep_t entry_type) const override;
+    DBEntry ReadEntry(const std::string &uuid, entry_table_rep_t entry_type, entry_column_mask_t columns) const override;
     int UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const override;
     int DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type) const override;
 
     int CreateMd5Sum(const DBMd5Sum &md5) const override;
     DBMd5Sum ReadMd5Sum(const std::string &uuid, size_t index_num) const override;
     int UpdateMd5Sum(const DBMd5Sum &md5) const override;
+    int UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s) const override;
     int DeleteMd5Sum(const std::string &uuid, size_t index_num) const override;
 
     int CreateRefresh(const DBRefresh &refresh) const override;
     DBRefresh ReadRefresh(const std::string &uuid) const override;
     int DeleteRefresh(const std::string &uuid) const override;
+    int ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit, std::vector<DBRefresh> &refreshes) const override;
+    int CompleteRefresh(const std::string &uuid, const std::string &worker_id) const override;
+    int ReleaseRefresh(const std::string &uuid, const std::string &worker_id) const override;
 
     int CreateErrorEntry(const DBErrorEntry &entry) const override;
     int DeleteErrorEntry(const std::string &uuid, size_t progress_num) const override;
@@ -59,37 +145,76 @@ public:
     DBStringResult GetEntryUUIDFromUrl(const std::string &url, entry_table_rep_t entry_type) const override;
     DBStringResult GetEntryUrlFromUUID(const std::string &uuid, entry_table_rep_t entry_type) const override;
 
+    int GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s) const override;
+    DBMd5SumDiff DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh) const override;
+
     uint16_t GetVersionFromMd5(const std::string &uuid, size_t index_num) const override;
 
     DBRefresh GetRefreshFromMinDate() const override;
+    int GetDueRefreshes(time_t now, size_t limit, std::vector<DBRefresh> &refreshes) const override;
+
+    // plans every prepared statement as the write connection would run it, for regression tests
+    int ExplainPreparedStatements(std::vector<SQLiteQueryPlan> &plans) const;
 
     bool IsReady() const;
 
 private:
-    int GenerateTables();
+    class ReadConnectionLease;
+    class WriteConnectionLease;
+
+    int RunMigrations();
 
     int SetupDefaultTypeTables();
     int SetupDefaultEntryTypeTable();
     int SetupDefaultSubtypeTable();
     int SetupDefaultSourceTable();
 
-    int PrepareStatements();
+    int PrepareStatements(SQLiteConnection &connection);
     int SetupDefaultBlackLibraryUsers();
 
-    int BeginTransaction() const;
+    int BeginReadTransaction(const SQLiteConnection &connection) const;
+    int BeginTransaction(const SQLiteConnection &connection) const;
     int CheckInitialized() const;
-    int EndTransaction() const;
+    int CloseConnection(SQLiteConnection &connection);
+    int EnableSlowQueryLog(SQLiteConnection &connection);
+    int EndTransaction(const SQLiteConnection &connection) const;
     int GenerateTable(const std::string &sql);
-    int PrepareStatement(const std::string &statement, int statement_id);
+    int GenerateTempTables(SQLiteConnection &connection);
+    int GetSchemaVersion(int &schema_version);
+    sqlite3_stmt *GetProjectedStatement(const SQLiteConnection &connection, entry_table_rep_t entry_type, entry_column_mask_t columns, bool by_uuid) const;
+    int OpenReadConnections(const std::string &database_url, size_t read_pool_size);
+    int PrepareStatement(SQLiteConnection &connection, const std::string &statement, int statement_id);
     int ResetStatement(sqlite3_stmt *smt) const;
-
-    int BindInt(sqlite3_stmt* stmt, const std::string &parameter_name, const int &bind_int) const;
-    int BindText(sqlite3_stmt* stmt, const std::string &parameter_name, const std::string &bind_text) const;
+    void ResolveParameterIndices(SQLiteConnection &connection, int statement_id);
+    int RollbackTransaction(const SQLiteConnection &connection) const;
+    int RollbackTransaction(sqlite3 *database_conn) const;
+    int RunMigration(const SQLiteMigration &migration);
+    int SetupWriteConnection();
+    int StepTransactionStatement(const SQLiteConnection &connection, int statement_id, const char *statement) const;
+    std::vector<int> StepEntries(const std::vector<DBEntry> &entries, int statement_id) const;
+
+    template <typename Row, typename Columns>
+    int BindRow(sqlite3_stmt* stmt, const Row &row, const Columns &columns) const;
+    void ReadEntryColumns(sqlite3_stmt* stmt, entry_column_mask_t columns, DBEntry &entry) const;
+    void ReadEntryViewColumns(sqlite3_stmt* stmt, entry_column_mask_t columns, DBEntryView &view) const;
+    int BindInt(sqlite3_stmt* stmt, int parameter_index, const int &bind_int) const;
+    int BindInt64(sqlite3_stmt* stmt, int parameter_index, const sqlite3_int64 &bind_int) const;
+    int BindText(sqlite3_stmt* stmt, int parameter_index, const std::string &bind_text) const;
 
     int LogTraceStatement(sqlite3_stmt* stmt) const;
-
-    sqlite3 *database_conn_;
-    std::vector<sqlite3_stmt *> prepared_statements_;
+    void LogSlowQuery(sqlite3_stmt* stmt, uint64_t elapsed_ns) const;
+    static int ProfileCallback(unsigned int trace_type, void *context, void *p, void *x);
+
+    SQLiteConnection write_connection_;
+    std::vector<std::unique_ptr<SQLiteConnection>> read_connections_;
+    mutable std::vector<const SQLiteConnection *> idle_read_connections_;
+    mutable std::mutex read_pool_mutex_;
+    mutable std::condition_variable read_pool_cv_;
+    mutable std::mutex write_mutex_;
+    // looked up once, a missing db logger leaves trace and debug output off
+    std::shared_ptr<spdlog::logger> logger_;
+    // 0 leaves the profile callback unregistered
+    const uint64_t slow_query_threshold_ns_;
     bool initialized_;
 };
 
@@ -2,10 +2,14 @@
  * BlackLibraryDB.cc
  */
 
+#include <chrono>
 #include <iostream>
 
 #include <LogOperations.h>
 
+#include <DBEntryCache.h>
+#include <DBStatsConnection.h>
+#include <DBUrlIndex.h>
 #include <SQLiteDB.h>
 
 #include <BlackLibraryDB.h>
@@ -19,7 +23,12 @@ namespace db {
 namespace BlackLibraryCommon = black_library::core::common;
 
 BlackLibraryDB::BlackLibraryDB(const njson &config) :
+    stats_(),
+    workload_recorder_(nullptr),
     database_connection_interface_(nullptr),
+    entry_cache_(nullptr),
+    staging_url_index_(nullptr),
+    black_url_index_(nullptr),
     mutex_()
 {
     njson nconfig = BlackLibraryCommon::LoadConfig(config);
@@ -42,9 +51,74 @@ BlackLibraryDB::BlackLibraryDB(const njson &config) :
         logger_level = nconfig["db_debug_log"];
     }
 
+    size_t read_pool_size = DefaultDBReadPoolSize;
+    if (nconfig.contains("db_read_pool_size"))
+    {
+        read_pool_size = nconfig["db_read_pool_size"];
+    }
+
+    size_t entry_cache_size = DefaultDBEntryCacheSize;
+    if (nconfig.contains("db_entry_cache_size"))
+    {
+        entry_cache_size = nconfig["db_entry_cache_size"];
+    }
+
+    bool url_index = DefaultDBUrlIndex;
+    if (nconfig.contains("db_url_index"))
+    {
+        url_index = nconfig["db_url_index"];
+    }
+
+    size_t slow_query_threshold_ms = DefaultDBSlowQueryThresholdMs;
+    if (nconfig.contains("db_slow_query_ms"))
+    {
+        slow_query_threshold_ms = nconfig["db_slow_query_ms"];
+    }
+
+    std::string workload_path = "";
+    if (nconfig.contains("db_workload_path"))
+    {
+        workload_path = nconfig["db_workload_path"];
+    }
+
+    bool workload_binary = DefaultDBWorkloadBinary;
+    if (nconfig.contains("db_workload_binary"))
+    {
+        workload_binary = nconfig["db_workload_binary"];
+    }
+
     BlackLibraryCommon::InitRotatingLogger("db", logger_path, logger_level);
 
-    database_connection_interface_ = std::make_unique<SQLiteDB>(database_url);
+    std::unique_ptr<DBConnectionInterface> connection = std::make_unique<SQLiteDB>(database_url, read_pool_size, slow_query_threshold_ms);
+
+    database_connection_interface_ = std::make_unique<DBStatsConnection>(std::move(connection), stats_);
+    entry_cache_ = std::make_unique<DBEntryCache>(entry_cache_size);
+
+    if (url_index && database_connection_interface_->IsReady())
+    {
+        staging_url_index_ = std::make_unique<DBUrlIndex>();
+        black_url_index_ = std::make_unique<DBUrlIndex>();
+
+        // without a complete index the url checks fall back to the database
+        if (BuildUrlIndex(STAGING_ENTRY, *staging_url_index_) || BuildUrlIndex(BLACK_ENTRY, *black_url_index_))
+        {
+            BlackLibraryCommon::LogError("db", "Failed to build url index");
+            staging_url_index_.reset();
+            black_url_index_.reset();
+        }
+    }
+
+    // records the calls made on this object once it is set up, replaying them through a BlackLibraryDB
+    // brings back the locking, entry cache and url index work they caused
+    if (!workload_path.empty())
+    {
+        workload_recorder_ = std::make_unique<DBWorkloadRecorder>();
+        if (workload_recorder_->Open(workload_path, workload_binary ? DB_WORKLOAD_BINARY_FORMAT : DB_WORKLOAD_JSON_FORMAT))
+        {
+            BlackLibraryCommon::LogError("db", "Failed to start workload recording, continuing without it");
+            workload_recorder_.reset();
+        }
+    }
 }
 
 BlackLibraryDB::~BlackLibraryDB()
@@ -53,7 +127,10 @@ BlackLibraryDB::~BlackLibraryDB()
 
 std::vector<DBEntry> BlackLibraryDB::GetStagingEntryList()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ENTRIES_OPERATION, njson::array({ STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     auto entry_list = database_connection_interface_->ListEntries(STAGING_ENTRY);
 
@@ -62,16 +139,47 @@ std::vector<DBEntry> BlackLibraryDB::GetStagingEntryList()
 
 std::vector<DBEntry> BlackLibraryDB::GetBlackEntryList()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ENTRIES_OPERATION, njson::array({ BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     auto entry_list = database_connection_interface_->ListEntries(BLACK_ENTRY);
 
     return entry_list;
 }
 
+// UUID is always returned along with the requested columns
+std::vector<DBEntry> BlackLibraryDB::GetStagingEntryList(entry_column_mask_t columns)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ENTRIES_OPERATION, njson::array({ STAGING_ENTRY, columns }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    auto entry_list = database_connection_interface_->ListEntries(STAGING_ENTRY, columns);
+
+    return entry_list;
+}
+
+std::vector<DBEntry> BlackLibraryDB::GetBlackEntryList(entry_column_mask_t columns)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ENTRIES_OPERATION, njson::array({ BLACK_ENTRY, columns }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    auto entry_list = database_connection_interface_->ListEntries(BLACK_ENTRY, columns);
+
+    return entry_list;
+}
+
 std::vector<DBMd5Sum> BlackLibraryDB::GetChecksumList()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_CHECKSUMS_OPERATION, njson::array());
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     auto checksum_list = database_connection_interface_->ListChecksums();
 
@@ -80,16 +188,207 @@ std::vector<DBMd5Sum> BlackLibraryDB::GetChecksumList()
 
 std::vector<DBErrorEntry> BlackLibraryDB::GetErrorEntryList()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ERROR_ENTRIES_OPERATION, njson::array());
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     auto entry_list = database_connection_interface_->ListErrorEntries();
 
     return entry_list;
 }
 
+// pages are keyed on the last UUID of the previous page, an empty UUID starts at the first page
+std::vector<DBEntry> BlackLibraryDB::GetStagingEntryPage(const std::string &after_uuid, size_t limit)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ENTRIES_PAGE_OPERATION, njson::array({ STAGING_ENTRY, after_uuid, limit }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    std::vector<DBEntry> entry_page;
+
+    if (database_connection_interface_->ListEntriesPage(STAGING_ENTRY, after_uuid, limit, entry_page))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get staging entry page after UUID: {}", after_uuid);
+    }
+
+    return entry_page;
+}
+
+std::vector<DBEntry> BlackLibraryDB::GetBlackEntryPage(const std::string &after_uuid, size_t limit)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ENTRIES_PAGE_OPERATION, njson::array({ BLACK_ENTRY, after_uuid, limit }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    std::vector<DBEntry> entry_page;
+
+    if (database_connection_interface_->ListEntriesPage(BLACK_ENTRY, after_uuid, limit, entry_page))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get black entry page after UUID: {}", after_uuid);
+    }
+
+    return entry_page;
+}
+
+std::vector<DBMd5Sum> BlackLibraryDB::GetChecksumPage(const std::string &after_uuid, size_t after_index_num, size_t limit)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_CHECKSUMS_PAGE_OPERATION, njson::array({ after_uuid, after_index_num, limit }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    std::vector<DBMd5Sum> checksum_page;
+
+    if (database_connection_interface_->ListChecksumsPage(after_uuid, after_index_num, limit, checksum_page))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get checksum page after UUID: {} index_num: {}", after_uuid, after_index_num);
+    }
+
+    return checksum_page;
+}
+
+std::vector<DBErrorEntry> BlackLibraryDB::GetErrorEntryPage(const std::string &after_uuid, size_t limit)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(LIST_ERROR_ENTRIES_PAGE_OPERATION, njson::array({ after_uuid, limit }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    std::vector<DBErrorEntry> entry_page;
+
+    if (database_connection_interface_->ListErrorEntriesPage(after_uuid, limit, entry_page))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get error entry page after UUID: {}", after_uuid);
+    }
+
+    return entry_page;
+}
+
+// the callback runs under the shared lock, it must not call back into BlackLibraryDB
+int BlackLibraryDB::ForEachStagingEntry(const entry_callback_t &callback)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(FOR_EACH_ENTRY_OPERATION, njson::array({ STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (database_connection_interface_->ForEachEntry(STAGING_ENTRY, callback))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to scan staging entries");
+        return -1;
+    }
+
+    return 0;
+}
+
+int BlackLibraryDB::ForEachBlackEntry(const entry_callback_t &callback)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(FOR_EACH_ENTRY_OPERATION, njson::array({ BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (database_connection_interface_->ForEachEntry(BLACK_ENTRY, callback))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to scan black entries");
+        return -1;
+    }
+
+    return 0;
+}
+
+// views are only valid inside the callback, call Materialize() to keep an entry
+int BlackLibraryDB::ForEachStagingEntryView(entry_column_mask_t columns, const entry_view_callback_t &callback)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(FOR_EACH_ENTRY_VIEW_OPERATION, njson::array({ STAGING_ENTRY, columns }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (database_connection_interface_->ForEachEntryView(STAGING_ENTRY, columns, callback))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to scan staging entry views");
+        return -1;
+    }
+
+    return 0;
+}
+
+int BlackLibraryDB::ForEachBlackEntryView(entry_column_mask_t columns, const entry_view_callback_t &callback)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(FOR_EACH_ENTRY_VIEW_OPERATION, njson::array({ BLACK_ENTRY, columns }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (database_connection_interface_->ForEachEntryView(BLACK_ENTRY, columns, callback))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to scan black entry views");
+        return -1;
+    }
+
+    return 0;
+}
+
+std::vector<int> BlackLibraryDB::CreateStagingEntries(const std::vector<DBEntry> &entries)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_ENTRIES_OPERATION, njson::array({ WorkloadRowToJson(entries), STAGING_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    std::vector<int> results = database_connection_interface_->CreateEntries(entries, STAGING_ENTRY);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (results[i])
+            BlackLibraryCommon::LogError("db", "Failed to create staging entry with UUID: {}", entries[i].uuid);
+        else if (staging_url_index_)
+            staging_url_index_->Add(entries[i].url);
+    }
+
+    return results;
+}
+
+std::vector<int> BlackLibraryDB::UpdateStagingEntries(const std::vector<DBEntry> &entries)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(UPDATE_ENTRIES_OPERATION, njson::array({ WorkloadRowToJson(entries), STAGING_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    std::vector<DBStringResult> old_urls;
+    if (staging_url_index_)
+    {
+        for (const auto &entry : entries)
+            old_urls.emplace_back(database_connection_interface_->GetEntryUrlFromUUID(entry.uuid, STAGING_ENTRY));
+    }
+
+    std::vector<int> results = database_connection_interface_->UpdateEntries(entries, STAGING_ENTRY);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        entry_cache_->Invalidate(entries[i].uuid, STAGING_ENTRY);
+        if (results[i])
+        {
+            BlackLibraryCommon::LogError("db", "Failed to update staging entry with UUID: {}", entries[i].uuid);
+        }
+        else if (staging_url_index_)
+        {
+            UpdateUrlIndex(staging_url_index_, old_urls[i], entries[i].url);
+        }
+    }
+
+    return results;
+}
+
 int BlackLibraryDB::CreateStagingEntry(const DBEntry &entry)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_ENTRY_OPERATION, njson::array({ WorkloadRowToJson(entry), STAGING_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (entry.uuid.empty() || database_connection_interface_->CreateEntry(entry, STAGING_ENTRY))
     {
@@ -97,12 +396,18 @@ int BlackLibraryDB::CreateStagingEntry(const DBEntry &entry)
         return -1;
     }
 
+    if (staging_url_index_)
+        staging_url_index_->Add(entry.url);
+
     return 0;
 }
 
 DBEntry BlackLibraryDB::ReadStagingEntry(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(READ_ENTRY_OPERATION, njson::array({ uuid, STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBEntry entry;
 
@@ -111,6 +416,9 @@ DBEntry BlackLibraryDB::ReadStagingEntry(const std::string &uuid)
         BlackLibraryCommon::LogError("db", "Failed to read staging entry with empty UUID");
         return entry;
     }
+    if (entry_cache_->Get(uuid, STAGING_ENTRY, entry))
+        return entry;
+
     entry = database_connection_interface_->ReadEntry(uuid, STAGING_ENTRY);
     if (entry.uuid.empty())
     {
@@ -118,12 +426,48 @@ DBEntry BlackLibraryDB::ReadStagingEntry(const std::string &uuid)
         return entry;
     }
 
+    // writers hold the exclusive lock, so nothing can change the entry between the read and the put
+    entry_cache_->Put(entry, STAGING_ENTRY);
+
+    return entry;
+}
+
+DBEntry BlackLibraryDB::ReadStagingEntry(const std::string &uuid, entry_column_mask_t columns)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(READ_ENTRY_OPERATION, njson::array({ uuid, STAGING_ENTRY, columns }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    DBEntry entry;
+
+    if (uuid.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to read staging entry with empty UUID");
+        return entry;
+    }
+    entry = database_connection_interface_->ReadEntry(uuid, STAGING_ENTRY, columns);
+    if (entry.uuid.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to read staging entry with UUID: {}", uuid);
+        return entry;
+    }
+
     return entry;
 }
 
 int BlackLibraryDB::UpdateStagingEntry(const DBEntry &entry)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(UPDATE_ENTRY_OPERATION, njson::array({ WorkloadRowToJson(entry), STAGING_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    entry_cache_->Invalidate(entry.uuid, STAGING_ENTRY);
+
+    DBStringResult old_url;
+    if (staging_url_index_ && !entry.uuid.empty())
+        old_url = database_connection_interface_->GetEntryUrlFromUUID(entry.uuid, STAGING_ENTRY);
 
     if (entry.uuid.empty() || database_connection_interface_->UpdateEntry(entry, STAGING_ENTRY))
     {
@@ -131,30 +475,99 @@ int BlackLibraryDB::UpdateStagingEntry(const DBEntry &entry)
         return -1;
     }
 
+    if (staging_url_index_)
+        UpdateUrlIndex(staging_url_index_, old_url, entry.url);
+
     return 0;
 }
 
 int BlackLibraryDB::DeleteStagingEntry(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DELETE_ENTRY_OPERATION, njson::array({ uuid, STAGING_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    entry_cache_->Invalidate(uuid, STAGING_ENTRY);
 
     if (uuid.empty())
     {
         BlackLibraryCommon::LogError("db", "Failed to delete staging entry with empty UUID");
         return -1;
     }
+
+    DBStringResult old_url;
+    if (staging_url_index_)
+        old_url = database_connection_interface_->GetEntryUrlFromUUID(uuid, STAGING_ENTRY);
+
     if (database_connection_interface_->DeleteEntry(uuid, STAGING_ENTRY))
     {
         BlackLibraryCommon::LogError("db", "Failed to delete staging entry with UUID: {}", uuid);
         return -1;
     }
 
+    if (staging_url_index_)
+        RemoveUrlIndex(staging_url_index_, old_url);
+
     return 0;
 }
 
+std::vector<int> BlackLibraryDB::CreateBlackEntries(const std::vector<DBEntry> &entries)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_ENTRIES_OPERATION, njson::array({ WorkloadRowToJson(entries), BLACK_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    std::vector<int> results = database_connection_interface_->CreateEntries(entries, BLACK_ENTRY);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (results[i])
+            BlackLibraryCommon::LogError("db", "Failed to create black entry with UUID: {}", entries[i].uuid);
+        else if (black_url_index_)
+            black_url_index_->Add(entries[i].url);
+    }
+
+    return results;
+}
+
+std::vector<int> BlackLibraryDB::UpdateBlackEntries(const std::vector<DBEntry> &entries)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(UPDATE_ENTRIES_OPERATION, njson::array({ WorkloadRowToJson(entries), BLACK_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    std::vector<DBStringResult> old_urls;
+    if (black_url_index_)
+    {
+        for (const auto &entry : entries)
+            old_urls.emplace_back(database_connection_interface_->GetEntryUrlFromUUID(entry.uuid, BLACK_ENTRY));
+    }
+
+    std::vector<int> results = database_connection_interface_->UpdateEntries(entries, BLACK_ENTRY);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        entry_cache_->Invalidate(entries[i].uuid, BLACK_ENTRY);
+        if (results[i])
+        {
+            BlackLibraryCommon::LogError("db", "Failed to update black entry with UUID: {}", entries[i].uuid);
+        }
+        else if (black_url_index_)
+        {
+            UpdateUrlIndex(black_url_index_, old_urls[i], entries[i].url);
+        }
+    }
+
+    return results;
+}
+
 int BlackLibraryDB::CreateBlackEntry(const DBEntry &entry)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_ENTRY_OPERATION, njson::array({ WorkloadRowToJson(entry), BLACK_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (entry.uuid.empty() || database_connection_interface_->CreateEntry(entry, BLACK_ENTRY))
     {
@@ -162,12 +575,18 @@ int BlackLibraryDB::CreateBlackEntry(const DBEntry &entry)
         return -1;
     }
 
+    if (black_url_index_)
+        black_url_index_->Add(entry.url);
+
     return 0;
 }
 
 DBEntry BlackLibraryDB::ReadBlackEntry(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(READ_ENTRY_OPERATION, njson::array({ uuid, BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBEntry entry;
 
@@ -176,6 +595,9 @@ DBEntry BlackLibraryDB::ReadBlackEntry(const std::string &uuid)
         BlackLibraryCommon::LogError("db", "Failed to read black entry with empty UUID");
         return entry;
     }
+    if (entry_cache_->Get(uuid, BLACK_ENTRY, entry))
+        return entry;
+
     entry = database_connection_interface_->ReadEntry(uuid, BLACK_ENTRY);
     if (entry.uuid.empty())
     {
@@ -183,12 +605,48 @@ DBEntry BlackLibraryDB::ReadBlackEntry(const std::string &uuid)
         return entry;
     }
 
+    // writers hold the exclusive lock, so nothing can change the entry between the read and the put
+    entry_cache_->Put(entry, BLACK_ENTRY);
+
+    return entry;
+}
+
+DBEntry BlackLibraryDB::ReadBlackEntry(const std::string &uuid, entry_column_mask_t columns)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(READ_ENTRY_OPERATION, njson::array({ uuid, BLACK_ENTRY, columns }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    DBEntry entry;
+
+    if (uuid.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to read black entry with empty UUID");
+        return entry;
+    }
+    entry = database_connection_interface_->ReadEntry(uuid, BLACK_ENTRY, columns);
+    if (entry.uuid.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to read black entry with UUID: {}", uuid);
+        return entry;
+    }
+
     return entry;
 }
 
 int BlackLibraryDB::UpdateBlackEntry(const DBEntry &entry)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(UPDATE_ENTRY_OPERATION, njson::array({ WorkloadRowToJson(entry), BLACK_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    entry_cache_->Invalidate(entry.uuid, BLACK_ENTRY);
+
+    DBStringResult old_url;
+    if (black_url_index_ && !entry.uuid.empty())
+        old_url = database_connection_interface_->GetEntryUrlFromUUID(entry.uuid, BLACK_ENTRY);
 
     if (entry.uuid.empty() || database_connection_interface_->UpdateEntry(entry, BLACK_ENTRY))
     {
@@ -196,30 +654,49 @@ int BlackLibraryDB::UpdateBlackEntry(const DBEntry &entry)
         return -1;
     }
 
+    if (black_url_index_)
+        UpdateUrlIndex(black_url_index_, old_url, entry.url);
+
     return 0;
 }
 
 int BlackLibraryDB::DeleteBlackEntry(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DELETE_ENTRY_OPERATION, njson::array({ uuid, BLACK_ENTRY }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    entry_cache_->Invalidate(uuid, BLACK_ENTRY);
 
     if (uuid.empty())
     {
         BlackLibraryCommon::LogError("db", "Failed to delete black entry with empty UUID");
         return -1;
     }
+
+    DBStringResult old_url;
+    if (black_url_index_)
+        old_url = database_connection_interface_->GetEntryUrlFromUUID(uuid, BLACK_ENTRY);
+
     if (database_connection_interface_->DeleteEntry(uuid, BLACK_ENTRY))
     {
         BlackLibraryCommon::LogError("db", "Failed to delete black entry with UUID: {}", uuid);
         return -1;
     }
 
+    if (black_url_index_)
+        RemoveUrlIndex(black_url_index_, old_url);
+
     return 0;
 }
 
 int BlackLibraryDB::CreateMd5Sum(const DBMd5Sum &md5)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_MD5_SUM_OPERATION, njson::array({ WorkloadRowToJson(md5) }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (md5.uuid.empty() || database_connection_interface_->CreateMd5Sum(md5))
     {
@@ -232,7 +709,10 @@ int BlackLibraryDB::CreateMd5Sum(const DBMd5Sum &md5)
 
 DBMd5Sum BlackLibraryDB::ReadMd5Sum(const std::string &uuid, size_t index_num)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(READ_MD5_SUM_OPERATION, njson::array({ uuid, index_num }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBMd5Sum md5;
 
@@ -251,9 +731,67 @@ DBMd5Sum BlackLibraryDB::ReadMd5Sum(const std::string &uuid, size_t index_num)
     return md5;
 }
 
+std::vector<DBMd5Sum> BlackLibraryDB::GetMd5SumsForUUID(const std::string &uuid)
+{
+    std::vector<DBMd5Sum> md5s;
+
+    GetMd5SumsForUUID(uuid, md5s);
+
+    return md5s;
+}
+
+int BlackLibraryDB::GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_MD5_SUMS_FOR_UUID_OPERATION, njson::array({ uuid }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (uuid.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get MD5 checksums with empty UUID");
+        return -1;
+    }
+    if (database_connection_interface_->GetMd5SumsForUUID(uuid, md5s))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get MD5 checksums with UUID: {}", uuid);
+        return -1;
+    }
+
+    return 0;
+}
+
+DBMd5SumDiff BlackLibraryDB::DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(DIFF_MD5_SUMS_OPERATION, njson::array({ uuid, fresh }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    DBMd5SumDiff diff;
+
+    if (uuid.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to diff MD5 checksums with empty UUID");
+        diff.error = -1;
+        return diff;
+    }
+    diff = database_connection_interface_->DiffMd5Sums(uuid, fresh);
+    if (diff.error)
+    {
+        BlackLibraryCommon::LogError("db", "Failed to diff MD5 checksums with UUID: {}", uuid);
+        return diff;
+    }
+
+    return diff;
+}
+
 uint16_t BlackLibraryDB::GetVersionFromMd5(const std::string &uuid, size_t index_num)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_VERSION_FROM_MD5_OPERATION, njson::array({ uuid, index_num }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     uint16_t version_num = 0;
 
@@ -269,7 +807,10 @@ uint16_t BlackLibraryDB::GetVersionFromMd5(const std::string &uuid, size_t index
 
 int BlackLibraryDB::UpdateMd5Sum(const DBMd5Sum &md5)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(UPDATE_MD5_SUM_OPERATION, njson::array({ WorkloadRowToJson(md5) }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (md5.uuid.empty() || database_connection_interface_->UpdateMd5Sum(md5))
     {
@@ -280,9 +821,28 @@ int BlackLibraryDB::UpdateMd5Sum(const DBMd5Sum &md5)
     return 0;
 }
 
+int BlackLibraryDB::UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(UPSERT_MD5_SUMS_OPERATION, njson::array({ uuid, WorkloadRowToJson(md5s) }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
+    if (uuid.empty() || database_connection_interface_->UpsertMd5Sums(uuid, md5s))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to upsert {} MD5 checksums with UUID: {}", md5s.size(), uuid);
+        return -1;
+    }
+
+    return 0;
+}
+
 int BlackLibraryDB::DeleteMd5Sum(const std::string &uuid, size_t index_num)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DELETE_MD5_SUM_OPERATION, njson::array({ uuid, index_num }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (uuid.empty())
     {
@@ -300,6 +860,11 @@ int BlackLibraryDB::DeleteMd5Sum(const std::string &uuid, size_t index_num)
 
 int BlackLibraryDB::CreateRefresh(const DBRefresh &refresh)
 {
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_REFRESH_OPERATION, njson::array({ WorkloadRowToJson(refresh) }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
+
     if (refresh.uuid.empty() || database_connection_interface_->CreateRefresh(refresh))
     {
         BlackLibraryCommon::LogError("db", "Failed to create refresh with UUID: {} refresh_date: {}", refresh.uuid, refresh.refresh_date);
@@ -311,7 +876,10 @@ int BlackLibraryDB::CreateRefresh(const DBRefresh &refresh)
 
 DBRefresh BlackLibraryDB::ReadRefresh(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(READ_REFRESH_OPERATION, njson::array({ uuid }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBRefresh refresh;
 
@@ -332,7 +900,10 @@ DBRefresh BlackLibraryDB::ReadRefresh(const std::string &uuid)
 
 int BlackLibraryDB::DeleteRefresh(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DELETE_REFRESH_OPERATION, njson::array({ uuid }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (uuid.empty())
     {
@@ -348,9 +919,77 @@ int BlackLibraryDB::DeleteRefresh(const std::string &uuid)
     return 0;
 }
 
+// claims are atomic inside SQLiteDB, so workers share the facade lock instead of queuing on it
+std::vector<DBRefresh> BlackLibraryDB::ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(CLAIM_REFRESHES_OPERATION, njson::array({ worker_id, lease_seconds, limit }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    std::vector<DBRefresh> refreshes;
+
+    if (worker_id.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to claim refreshes with empty worker id");
+        return refreshes;
+    }
+    if (database_connection_interface_->ClaimRefreshes(worker_id, lease_seconds, limit, refreshes))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to claim refreshes for worker: {}", worker_id);
+    }
+
+    return refreshes;
+}
+
+int BlackLibraryDB::CompleteRefresh(const std::string &uuid, const std::string &worker_id)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(COMPLETE_REFRESH_OPERATION, njson::array({ uuid, worker_id }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (uuid.empty() || worker_id.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to complete refresh with empty UUID or worker id");
+        return -1;
+    }
+    if (database_connection_interface_->CompleteRefresh(uuid, worker_id))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to complete refresh with UUID: {} worker: {}", uuid, worker_id);
+        return -1;
+    }
+
+    return 0;
+}
+
+int BlackLibraryDB::ReleaseRefresh(const std::string &uuid, const std::string &worker_id)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(RELEASE_REFRESH_OPERATION, njson::array({ uuid, worker_id }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (uuid.empty() || worker_id.empty())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to release refresh with empty UUID or worker id");
+        return -1;
+    }
+    if (database_connection_interface_->ReleaseRefresh(uuid, worker_id))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to release refresh with UUID: {} worker: {}", uuid, worker_id);
+        return -1;
+    }
+
+    return 0;
+}
+
 int BlackLibraryDB::CreateErrorEntry(const DBErrorEntry &entry)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(CREATE_ERROR_ENTRY_OPERATION, njson::array({ WorkloadRowToJson(entry) }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (entry.uuid.empty() || database_connection_interface_->CreateErrorEntry(entry))
     {
@@ -363,7 +1002,10 @@ int BlackLibraryDB::CreateErrorEntry(const DBErrorEntry &entry)
 
 int BlackLibraryDB::DeleteErrorEntry(const std::string &uuid, size_t progress_num)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DELETE_ERROR_ENTRY_OPERATION, njson::array({ uuid, progress_num }));
+
+    const std::unique_lock<std::shared_mutex> lock = LockExclusive();
 
     if (uuid.empty())
     {
@@ -382,7 +1024,13 @@ int BlackLibraryDB::DeleteErrorEntry(const std::string &uuid, size_t progress_nu
 
 bool BlackLibraryDB::DoesStagingEntryUrlExist(const std::string &url)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_ENTRY_URL_EXIST_OPERATION, njson::array({ url, STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (staging_url_index_)
+        return staging_url_index_->Contains(url);
 
     DBBoolResult check = database_connection_interface_->DoesEntryUrlExist(url, STAGING_ENTRY);
     
@@ -397,7 +1045,13 @@ bool BlackLibraryDB::DoesStagingEntryUrlExist(const std::string &url)
 
 bool BlackLibraryDB::DoesBlackEntryUrlExist(const std::string &url)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_ENTRY_URL_EXIST_OPERATION, njson::array({ url, BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (black_url_index_)
+        return black_url_index_->Contains(url);
 
     DBBoolResult check = database_connection_interface_->DoesEntryUrlExist(url, BLACK_ENTRY);
     
@@ -412,7 +1066,10 @@ bool BlackLibraryDB::DoesBlackEntryUrlExist(const std::string &url)
 
 bool BlackLibraryDB::DoesStagingEntryUUIDExist(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_ENTRY_UUID_EXIST_OPERATION, njson::array({ uuid, STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBBoolResult check = database_connection_interface_->DoesEntryUUIDExist(uuid, STAGING_ENTRY);
     
@@ -427,7 +1084,10 @@ bool BlackLibraryDB::DoesStagingEntryUUIDExist(const std::string &uuid)
 
 bool BlackLibraryDB::DoesBlackEntryUUIDExist(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_ENTRY_UUID_EXIST_OPERATION, njson::array({ uuid, BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBBoolResult check = database_connection_interface_->DoesEntryUUIDExist(uuid, BLACK_ENTRY);
     
@@ -442,7 +1102,10 @@ bool BlackLibraryDB::DoesBlackEntryUUIDExist(const std::string &uuid)
 
 bool BlackLibraryDB::DoesMd5SumExist(const std::string &uuid, size_t index_num)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_MD5_SUM_EXIST_OPERATION, njson::array({ uuid, index_num }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBBoolResult check = database_connection_interface_->DoesMd5SumExist(uuid, index_num);
     
@@ -457,7 +1120,10 @@ bool BlackLibraryDB::DoesMd5SumExist(const std::string &uuid, size_t index_num)
 
 bool BlackLibraryDB::DoesRefreshExist(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_REFRESH_EXIST_OPERATION, njson::array({ uuid }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBBoolResult check = database_connection_interface_->DoesRefreshExist(uuid);
     
@@ -472,7 +1138,10 @@ bool BlackLibraryDB::DoesRefreshExist(const std::string &uuid)
 
 bool BlackLibraryDB::DoesMinRefreshExist()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_MIN_REFRESH_EXIST_OPERATION, njson::array());
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBBoolResult check = database_connection_interface_->DoesMinRefreshExist();
     
@@ -487,7 +1156,10 @@ bool BlackLibraryDB::DoesMinRefreshExist()
 
 bool BlackLibraryDB::DoesErrorEntryExist(const std::string &uuid, size_t progress_num)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(DOES_ERROR_ENTRY_EXIST_OPERATION, njson::array({ uuid, progress_num }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     DBBoolResult check = database_connection_interface_->DoesErrorEntryExist(uuid, progress_num);
     
@@ -502,7 +1174,17 @@ bool BlackLibraryDB::DoesErrorEntryExist(const std::string &uuid, size_t progres
 
 DBStringResult BlackLibraryDB::GetStagingEntryUUIDFromUrl(const std::string &url)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_ENTRY_UUID_FROM_URL_OPERATION, njson::array({ url, STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (staging_url_index_ && !staging_url_index_->MayContain(url))
+    {
+        DBStringResult res;
+        res.does_not_exist = true;
+        return res;
+    }
 
     DBStringResult res = database_connection_interface_->GetEntryUUIDFromUrl(url, STAGING_ENTRY);
     if (res.error)
@@ -513,14 +1195,35 @@ DBStringResult BlackLibraryDB::GetStagingEntryUUIDFromUrl(const std::string &url
 
 DBStringResult BlackLibraryDB::GetStagingEntryUrlFromUUID(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_ENTRY_URL_FROM_UUID_OPERATION, njson::array({ uuid, STAGING_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    DBEntry entry;
+    if (entry_cache_->Get(uuid, STAGING_ENTRY, entry))
+    {
+        DBStringResult res;
+        res.result = entry.url;
+        return res;
+    }
 
     return database_connection_interface_->GetEntryUrlFromUUID(uuid, STAGING_ENTRY);
 }
 
 DBStringResult BlackLibraryDB::GetBlackEntryUUIDFromUrl(const std::string &url)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_ENTRY_UUID_FROM_URL_OPERATION, njson::array({ url, BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (black_url_index_ && !black_url_index_->MayContain(url))
+    {
+        DBStringResult res;
+        res.does_not_exist = true;
+        return res;
+    }
 
     DBStringResult res = database_connection_interface_->GetEntryUUIDFromUrl(url, BLACK_ENTRY);
     if (res.error)
@@ -531,21 +1234,164 @@ DBStringResult BlackLibraryDB::GetBlackEntryUUIDFromUrl(const std::string &url)
 
 DBStringResult BlackLibraryDB::GetBlackEntryUrlFromUUID(const std::string &uuid)
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_ENTRY_URL_FROM_UUID_OPERATION, njson::array({ uuid, BLACK_ENTRY }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    DBEntry entry;
+    if (entry_cache_->Get(uuid, BLACK_ENTRY, entry))
+    {
+        DBStringResult res;
+        res.result = entry.url;
+        return res;
+    }
 
     return database_connection_interface_->GetEntryUrlFromUUID(uuid, BLACK_ENTRY);
 }
 
 DBRefresh BlackLibraryDB::GetRefreshFromMinDate()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_REFRESH_FROM_MIN_DATE_OPERATION, njson::array());
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     return database_connection_interface_->GetRefreshFromMinDate();
 }
 
+std::vector<DBRefresh> BlackLibraryDB::GetDueRefreshes(time_t now, size_t limit)
+{
+    if (workload_recorder_)
+        workload_recorder_->Record(GET_DUE_REFRESHES_OPERATION, njson::array({ now, limit }));
+
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    std::vector<DBRefresh> refreshes;
+
+    if (database_connection_interface_->GetDueRefreshes(now, limit, refreshes))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to get refreshes due by: {}", now);
+    }
+
+    return refreshes;
+}
+
+DBEntryCacheStats BlackLibraryDB::GetEntryCacheStats()
+{
+    return entry_cache_->GetStats();
+}
+
+// lock free, the counters are read without waiting on the facade lock
+DBStatsSnapshot BlackLibraryDB::GetStats()
+{
+    return stats_.GetStats();
+}
+
+DBUrlIndexStats BlackLibraryDB::GetStagingUrlIndexStats()
+{
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (!staging_url_index_)
+        return DBUrlIndexStats();
+
+    return staging_url_index_->GetStats();
+}
+
+DBUrlIndexStats BlackLibraryDB::GetBlackUrlIndexStats()
+{
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
+
+    if (!black_url_index_)
+        return DBUrlIndexStats();
+
+    return black_url_index_->GetStats();
+}
+
+// uncontended acquisitions are recorded as zero wait without reading the clock
+std::shared_lock<std::shared_mutex> BlackLibraryDB::LockShared()
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_, std::try_to_lock);
+    if (lock.owns_lock())
+    {
+        stats_.RecordSharedLockWait(0);
+        return lock;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    stats_.RecordSharedLockWait(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    return lock;
+}
+
+std::unique_lock<std::shared_mutex> BlackLibraryDB::LockExclusive()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_, std::try_to_lock);
+    if (lock.owns_lock())
+    {
+        stats_.RecordExclusiveLockWait(0);
+        return lock;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    stats_.RecordExclusiveLockWait(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    return lock;
+}
+
+int BlackLibraryDB::BuildUrlIndex(entry_table_rep_t entry_type, DBUrlIndex &url_index)
+{
+    url_index.Clear();
+
+    int res = database_connection_interface_->ForEachEntryView(entry_type, EntryColumnMask(DBEntryColumnID::url),
+        [&url_index](const DBEntryView &view)
+        {
+            url_index.Add(std::string(view.url));
+            return true;
+        });
+
+    if (res)
+        return -1;
+
+    BlackLibraryCommon::LogDebug("db", "Built url index for entry type {} with {} urls", entry_type, url_index.Size());
+
+    return 0;
+}
+
+// an update that matched no row changed nothing, an old url that could not be read leaves the index
+// unable to drop it so the url checks fall back to the database
+void BlackLibraryDB::RemoveUrlIndex(std::unique_ptr<DBUrlIndex> &url_index, const DBStringResult &old_url)
+{
+    if (old_url.does_not_exist)
+        return;
+
+    // without the old url the index can not be kept in sync, url checks fall back to the database
+    if (old_url.error)
+    {
+        BlackLibraryCommon::LogError("db", "Failed to read old url, dropping url index");
+        url_index.reset();
+        return;
+    }
+
+    url_index->Remove(old_url.result);
+}
+
+void BlackLibraryDB::UpdateUrlIndex(std::unique_ptr<DBUrlIndex> &url_index, const DBStringResult &old_url, const std::string &new_url)
+{
+    if (old_url.does_not_exist)
+        return;
+
+    RemoveUrlIndex(url_index, old_url);
+
+    if (url_index)
+        url_index->Add(new_url);
+}
+
 bool BlackLibraryDB::IsReady()
 {
-    const std::lock_guard<std::mutex> lock(mutex_);
+    const std::shared_lock<std::shared_mutex> lock = LockShared();
 
     return database_connection_interface_->IsReady();
 }
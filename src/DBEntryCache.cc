@@ -0,0 +1,116 @@
+/**
+ * DBEntryCache.cc
+ */
+
+#include <DBEntryCache.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+DBEntryCache::DBEntryCache(size_t capacity) :
+    capacity_(capacity),
+    lru_(),
+    index_(),
+    mutex_(),
+    hits_(0),
+    misses_(0),
+    evictions_(0)
+{
+    index_.reserve(capacity_);
+}
+
+bool DBEntryCache::Get(const std::string &uuid, entry_table_rep_t entry_type, DBEntry &entry)
+{
+    if (capacity_ == 0)
+        return false;
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto it = index_.find(cache_key_t(entry_type, uuid));
+    if (it == index_.end())
+    {
+        ++misses_;
+        return false;
+    }
+
+    // move the hit to the front, the back is evicted first
+    lru_.splice(lru_.begin(), lru_, it->second);
+    entry = it->second->second;
+    ++hits_;
+
+    return true;
+}
+
+void DBEntryCache::Put(const DBEntry &entry, entry_table_rep_t entry_type)
+{
+    if (capacity_ == 0 || entry.uuid.empty())
+        return;
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    cache_key_t key(entry_type, entry.uuid);
+
+    const auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        it->second->second = entry;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    if (lru_.size() >= capacity_)
+    {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+        ++evictions_;
+    }
+
+    lru_.emplace_front(key, entry);
+    index_.emplace(std::move(key), lru_.begin());
+}
+
+void DBEntryCache::Invalidate(const std::string &uuid, entry_table_rep_t entry_type)
+{
+    if (capacity_ == 0)
+        return;
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto it = index_.find(cache_key_t(entry_type, uuid));
+    if (it == index_.end())
+        return;
+
+    lru_.erase(it->second);
+    index_.erase(it);
+}
+
+void DBEntryCache::Clear()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    lru_.clear();
+    index_.clear();
+}
+
+DBEntryCacheStats DBEntryCache::GetStats() const
+{
+    DBEntryCacheStats stats;
+
+    stats.capacity = capacity_;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    stats.size = lru_.size();
+
+    return stats;
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
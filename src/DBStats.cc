@@ -0,0 +1,218 @@
+/**
+ * DBStats.cc
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include <DBStats.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+// indexed by db_operation_id_t
+static constexpr const char *OperationNames[] = { "list_entries", "for_each_entry", "for_each_entry_view", "list_checksums",
+    "list_error_entries", "list_entries_page", "list_checksums_page", "list_error_entries_page", "create_entries", "update_entries",
+    "create_entry", "read_entry", "update_entry", "delete_entry", "create_md5_sum", "read_md5_sum", "update_md5_sum", "upsert_md5_sums",
+    "delete_md5_sum", "create_refresh", "read_refresh", "delete_refresh", "claim_refreshes", "complete_refresh", "release_refresh",
+    "create_error_entry", "delete_error_entry", "does_entry_url_exist", "does_entry_uuid_exist", "does_md5_sum_exist",
+    "does_refresh_exist", "does_min_refresh_exist", "does_error_entry_exist", "get_entry_uuid_from_url", "get_entry_url_from_uuid",
+    "get_md5_sums_for_uuid", "diff_md5_sums", "get_version_from_md5", "get_refresh_from_min_date", "get_due_refreshes" };
+static_assert(sizeof(OperationNames) / sizeof(OperationNames[0]) == _NUM_DB_OPERATIONS, "OperationNames must match db_operation_id_t");
+
+static njson LatencyStatsToJson(const DBLatencyStats &stats)
+{
+    njson j;
+
+    j["count"] = stats.count;
+    j["total_ns"] = stats.total_ns;
+    j["max_ns"] = stats.max_ns;
+    j["mean_us"] = stats.mean_us;
+    j["p50_us"] = stats.p50_us;
+    j["p90_us"] = stats.p90_us;
+    j["p99_us"] = stats.p99_us;
+
+    return j;
+}
+
+njson DBStatsSnapshot::ToJson() const
+{
+    njson j;
+
+    j["operations"] = njson::object();
+    for (const auto &operation : operations)
+    {
+        njson op;
+        op["calls"] = operation.calls;
+        op["errors"] = operation.errors;
+        op["latency"] = LatencyStatsToJson(operation.latency);
+        j["operations"][operation.name] = op;
+    }
+
+    j["lock_wait"]["shared"] = LatencyStatsToJson(shared_lock_wait);
+    j["lock_wait"]["exclusive"] = LatencyStatsToJson(exclusive_lock_wait);
+
+    return j;
+}
+
+DBLatencyHistogram::DBLatencyHistogram() :
+    buckets_(),
+    total_ns_(0),
+    max_ns_(0)
+{
+    for (auto &bucket : buckets_)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void DBLatencyHistogram::Record(uint64_t latency_ns)
+{
+    buckets_[BucketIndex(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
+
+    uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+    while (latency_ns > max_ns && !max_ns_.compare_exchange_weak(max_ns, latency_ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+DBLatencyStats DBLatencyHistogram::GetStats() const
+{
+    DBLatencyStats stats;
+
+    std::array<uint64_t, NumBuckets> buckets;
+    uint64_t count = 0;
+    for (size_t i = 0; i < NumBuckets; ++i)
+    {
+        buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        count += buckets[i];
+    }
+
+    stats.count = count;
+    stats.total_ns = total_ns_.load(std::memory_order_relaxed);
+    stats.max_ns = max_ns_.load(std::memory_order_relaxed);
+
+    if (count == 0)
+        return stats;
+
+    stats.mean_us = stats.total_ns / 1000.0 / count;
+
+    // percentiles report the upper bound of the bucket they land in, capped at the largest sample
+    const uint64_t p50_rank = (count * 50 + 99) / 100;
+    const uint64_t p90_rank = (count * 90 + 99) / 100;
+    const uint64_t p99_rank = (count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NumBuckets; ++i)
+    {
+        if (buckets[i] == 0)
+            continue;
+
+        const uint64_t prev_seen = seen;
+        seen += buckets[i];
+
+        const double upper_us = std::min(BucketUpperBound(i), stats.max_ns) / 1000.0;
+        if (prev_seen < p50_rank && seen >= p50_rank)
+            stats.p50_us = upper_us;
+        if (prev_seen < p90_rank && seen >= p90_rank)
+            stats.p90_us = upper_us;
+        if (prev_seen < p99_rank && seen >= p99_rank)
+            stats.p99_us = upper_us;
+    }
+
+    return stats;
+}
+
+// values below 2^SubBucketBits get a bucket each, above that every power of two is split into
+// 2^SubBucketBits buckets by the bits following the leading one
+size_t DBLatencyHistogram::BucketIndex(uint64_t latency_ns)
+{
+    if (latency_ns < (uint64_t(1) << SubBucketBits))
+        return latency_ns;
+
+    const size_t msb = 63 - __builtin_clzll(latency_ns);
+    const size_t shift = msb - SubBucketBits;
+    const size_t sub_bucket = (latency_ns >> shift) & ((size_t(1) << SubBucketBits) - 1);
+
+    return ((shift + 1) << SubBucketBits) + sub_bucket;
+}
+
+uint64_t DBLatencyHistogram::BucketUpperBound(size_t bucket_index)
+{
+    if (bucket_index < (size_t(1) << SubBucketBits))
+        return bucket_index;
+
+    const size_t shift = (bucket_index >> SubBucketBits) - 1;
+    const uint64_t sub_bucket = bucket_index & ((size_t(1) << SubBucketBits) - 1);
+
+    if (shift + SubBucketBits + 1 >= 64)
+        return std::numeric_limits<uint64_t>::max();
+
+    return (((uint64_t(1) << SubBucketBits) + sub_bucket + 1) << shift) - 1;
+}
+
+DBStats::DBStats() :
+    operations_(),
+    shared_lock_wait_(),
+    exclusive_lock_wait_()
+{
+}
+
+void DBStats::RecordOperation(db_operation_id_t operation_id, uint64_t latency_ns, bool error)
+{
+    OperationCounters &counters = operations_[operation_id];
+
+    counters.calls.fetch_add(1, std::memory_order_relaxed);
+    if (error)
+        counters.errors.fetch_add(1, std::memory_order_relaxed);
+    counters.latency.Record(latency_ns);
+}
+
+void DBStats::RecordSharedLockWait(uint64_t wait_ns)
+{
+    shared_lock_wait_.Record(wait_ns);
+}
+
+void DBStats::RecordExclusiveLockWait(uint64_t wait_ns)
+{
+    exclusive_lock_wait_.Record(wait_ns);
+}
+
+DBStatsSnapshot DBStats::GetStats() const
+{
+    DBStatsSnapshot snapshot;
+
+    snapshot.operations.reserve(_NUM_DB_OPERATIONS);
+    for (size_t i = 0; i < _NUM_DB_OPERATIONS; ++i)
+    {
+        const OperationCounters &counters = operations_[i];
+
+        DBOperationStats operation;
+        operation.name = OperationName(static_cast<db_operation_id_t>(i));
+        operation.calls = counters.calls.load(std::memory_order_relaxed);
+        operation.errors = counters.errors.load(std::memory_order_relaxed);
+        operation.latency = counters.latency.GetStats();
+
+        snapshot.operations.emplace_back(operation);
+    }
+
+    snapshot.shared_lock_wait = shared_lock_wait_.GetStats();
+    snapshot.exclusive_lock_wait = exclusive_lock_wait_.GetStats();
+
+    return snapshot;
+}
+
+const char *DBStats::OperationName(db_operation_id_t operation_id)
+{
+    if (operation_id >= _NUM_DB_OPERATIONS)
+        return "unknown";
+
+    return OperationNames[operation_id];
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -0,0 +1,331 @@
+/**
+ * DBStatsConnection.cc
+ */
+
+#include <DBStatsConnection.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+DBStatsConnection::DBStatsConnection(std::unique_ptr<DBConnectionInterface> connection, DBStats &stats) :
+    connection_(std::move(connection)),
+    stats_(stats)
+{
+}
+
+DBStatsConnection::~DBStatsConnection()
+{
+}
+
+std::vector<DBEntry> DBStatsConnection::ListEntries(entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, LIST_ENTRIES_OPERATION);
+
+    return timer.Result(connection_->ListEntries(entry_type));
+}
+
+std::vector<DBEntry> DBStatsConnection::ListEntries(entry_table_rep_t entry_type, entry_column_mask_t columns) const
+{
+    DBOperationTimer timer(stats_, LIST_ENTRIES_OPERATION);
+
+    return timer.Result(connection_->ListEntries(entry_type, columns));
+}
+
+int DBStatsConnection::ForEachEntry(entry_table_rep_t entry_type, const entry_callback_t &callback) const
+{
+    DBOperationTimer timer(stats_, FOR_EACH_ENTRY_OPERATION);
+
+    return timer.Result(connection_->ForEachEntry(entry_type, callback));
+}
+
+int DBStatsConnection::ForEachEntry(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_callback_t &callback) const
+{
+    DBOperationTimer timer(stats_, FOR_EACH_ENTRY_OPERATION);
+
+    return timer.Result(connection_->ForEachEntry(entry_type, columns, callback));
+}
+
+int DBStatsConnection::ForEachEntryView(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_view_callback_t &callback) const
+{
+    DBOperationTimer timer(stats_, FOR_EACH_ENTRY_VIEW_OPERATION);
+
+    return timer.Result(connection_->ForEachEntryView(entry_type, columns, callback));
+}
+
+std::vector<DBMd5Sum> DBStatsConnection::ListChecksums() const
+{
+    DBOperationTimer timer(stats_, LIST_CHECKSUMS_OPERATION);
+
+    return timer.Result(connection_->ListChecksums());
+}
+
+std::vector<DBErrorEntry> DBStatsConnection::ListErrorEntries() const
+{
+    DBOperationTimer timer(stats_, LIST_ERROR_ENTRIES_OPERATION);
+
+    return timer.Result(connection_->ListErrorEntries());
+}
+
+int DBStatsConnection::ListEntriesPage(entry_table_rep_t entry_type, const std::string &after_uuid, size_t limit, std::vector<DBEntry> &entries) const
+{
+    DBOperationTimer timer(stats_, LIST_ENTRIES_PAGE_OPERATION);
+
+    return timer.Result(connection_->ListEntriesPage(entry_type, after_uuid, limit, entries));
+}
+
+int DBStatsConnection::ListChecksumsPage(const std::string &after_uuid, size_t after_index_num, size_t limit, std::vector<DBMd5Sum> &checksums) const
+{
+    DBOperationTimer timer(stats_, LIST_CHECKSUMS_PAGE_OPERATION);
+
+    return timer.Result(connection_->ListChecksumsPage(after_uuid, after_index_num, limit, checksums));
+}
+
+int DBStatsConnection::ListErrorEntriesPage(const std::string &after_uuid, size_t limit, std::vector<DBErrorEntry> &entries) const
+{
+    DBOperationTimer timer(stats_, LIST_ERROR_ENTRIES_PAGE_OPERATION);
+
+    return timer.Result(connection_->ListErrorEntriesPage(after_uuid, limit, entries));
+}
+
+std::vector<int> DBStatsConnection::CreateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, CREATE_ENTRIES_OPERATION);
+
+    return timer.Result(connection_->CreateEntries(entries, entry_type));
+}
+
+std::vector<int> DBStatsConnection::UpdateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, UPDATE_ENTRIES_OPERATION);
+
+    return timer.Result(connection_->UpdateEntries(entries, entry_type));
+}
+
+int DBStatsConnection::CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, CREATE_ENTRY_OPERATION);
+
+    return timer.Result(connection_->CreateEntry(entry, entry_type));
+}
+
+DBEntry DBStatsConnection::ReadEntry(const std::string &uuid, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, READ_ENTRY_OPERATION);
+
+    return timer.Result(connection_->ReadEntry(uuid, entry_type));
+}
+
+DBEntry DBStatsConnection::ReadEntry(const std::string &uuid, entry_table_rep_t entry_type, entry_column_mask_t columns) const
+{
+    DBOperationTimer timer(stats_, READ_ENTRY_OPERATION);
+
+    return timer.Result(connection_->ReadEntry(uuid, entry_type, columns));
+}
+
+int DBStatsConnection::UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, UPDATE_ENTRY_OPERATION);
+
+    return timer.Result(connection_->UpdateEntry(entry, entry_type));
+}
+
+int DBStatsConnection::DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, DELETE_ENTRY_OPERATION);
+
+    return timer.Result(connection_->DeleteEntry(uuid, entry_type));
+}
+
+int DBStatsConnection::CreateMd5Sum(const DBMd5Sum &md5) const
+{
+    DBOperationTimer timer(stats_, CREATE_MD5_SUM_OPERATION);
+
+    return timer.Result(connection_->CreateMd5Sum(md5));
+}
+
+DBMd5Sum DBStatsConnection::ReadMd5Sum(const std::string &uuid, size_t index_num) const
+{
+    DBOperationTimer timer(stats_, READ_MD5_SUM_OPERATION);
+
+    return timer.Result(connection_->ReadMd5Sum(uuid, index_num));
+}
+
+int DBStatsConnection::UpdateMd5Sum(const DBMd5Sum &md5) const
+{
+    DBOperationTimer timer(stats_, UPDATE_MD5_SUM_OPERATION);
+
+    return timer.Result(connection_->UpdateMd5Sum(md5));
+}
+
+int DBStatsConnection::UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s) const
+{
+    DBOperationTimer timer(stats_, UPSERT_MD5_SUMS_OPERATION);
+
+    return timer.Result(connection_->UpsertMd5Sums(uuid, md5s));
+}
+
+int DBStatsConnection::DeleteMd5Sum(const std::string &uuid, size_t index_num) const
+{
+    DBOperationTimer timer(stats_, DELETE_MD5_SUM_OPERATION);
+
+    return timer.Result(connection_->DeleteMd5Sum(uuid, index_num));
+}
+
+int DBStatsConnection::CreateRefresh(const DBRefresh &refresh) const
+{
+    DBOperationTimer timer(stats_, CREATE_REFRESH_OPERATION);
+
+    return timer.Result(connection_->CreateRefresh(refresh));
+}
+
+DBRefresh DBStatsConnection::ReadRefresh(const std::string &uuid) const
+{
+    DBOperationTimer timer(stats_, READ_REFRESH_OPERATION);
+
+    return timer.Result(connection_->ReadRefresh(uuid));
+}
+
+int DBStatsConnection::DeleteRefresh(const std::string &uuid) const
+{
+    DBOperationTimer timer(stats_, DELETE_REFRESH_OPERATION);
+
+    return timer.Result(connection_->DeleteRefresh(uuid));
+}
+
+int DBStatsConnection::ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit, std::vector<DBRefresh> &refreshes) const
+{
+    DBOperationTimer timer(stats_, CLAIM_REFRESHES_OPERATION);
+
+    return timer.Result(connection_->ClaimRefreshes(worker_id, lease_seconds, limit, refreshes));
+}
+
+int DBStatsConnection::CompleteRefresh(const std::string &uuid, const std::string &worker_id) const
+{
+    DBOperationTimer timer(stats_, COMPLETE_REFRESH_OPERATION);
+
+    return timer.Result(connection_->CompleteRefresh(uuid, worker_id));
+}
+
+int DBStatsConnection::ReleaseRefresh(const std::string &uuid, const std::string &worker_id) const
+{
+    DBOperationTimer timer(stats_, RELEASE_REFRESH_OPERATION);
+
+    return timer.Result(connection_->ReleaseRefresh(uuid, worker_id));
+}
+
+int DBStatsConnection::CreateErrorEntry(const DBErrorEntry &entry) const
+{
+    DBOperationTimer timer(stats_, CREATE_ERROR_ENTRY_OPERATION);
+
+    return timer.Result(connection_->CreateErrorEntry(entry));
+}
+
+int DBStatsConnection::DeleteErrorEntry(const std::string &uuid, size_t progress_num) const
+{
+    DBOperationTimer timer(stats_, DELETE_ERROR_ENTRY_OPERATION);
+
+    return timer.Result(connection_->DeleteErrorEntry(uuid, progress_num));
+}
+
+DBBoolResult DBStatsConnection::DoesEntryUrlExist(const std::string &url, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, DOES_ENTRY_URL_EXIST_OPERATION);
+
+    return timer.Result(connection_->DoesEntryUrlExist(url, entry_type));
+}
+
+DBBoolResult DBStatsConnection::DoesEntryUUIDExist(const std::string &uuid, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, DOES_ENTRY_UUID_EXIST_OPERATION);
+
+    return timer.Result(connection_->DoesEntryUUIDExist(uuid, entry_type));
+}
+
+DBBoolResult DBStatsConnection::DoesMd5SumExist(const std::string &uuid, size_t index_num) const
+{
+    DBOperationTimer timer(stats_, DOES_MD5_SUM_EXIST_OPERATION);
+
+    return timer.Result(connection_->DoesMd5SumExist(uuid, index_num));
+}
+
+DBBoolResult DBStatsConnection::DoesRefreshExist(const std::string &uuid) const
+{
+    DBOperationTimer timer(stats_, DOES_REFRESH_EXIST_OPERATION);
+
+    return timer.Result(connection_->DoesRefreshExist(uuid));
+}
+
+DBBoolResult DBStatsConnection::DoesMinRefreshExist() const
+{
+    DBOperationTimer timer(stats_, DOES_MIN_REFRESH_EXIST_OPERATION);
+
+    return timer.Result(connection_->DoesMinRefreshExist());
+}
+
+DBBoolResult DBStatsConnection::DoesErrorEntryExist(const std::string &uuid, size_t progress_num) const
+{
+    DBOperationTimer timer(stats_, DOES_ERROR_ENTRY_EXIST_OPERATION);
+
+    return timer.Result(connection_->DoesErrorEntryExist(uuid, progress_num));
+}
+
+DBStringResult DBStatsConnection::GetEntryUUIDFromUrl(const std::string &url, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, GET_ENTRY_UUID_FROM_URL_OPERATION);
+
+    return timer.Result(connection_->GetEntryUUIDFromUrl(url, entry_type));
+}
+
+DBStringResult DBStatsConnection::GetEntryUrlFromUUID(const std::string &uuid, entry_table_rep_t entry_type) const
+{
+    DBOperationTimer timer(stats_, GET_ENTRY_URL_FROM_UUID_OPERATION);
+
+    return timer.Result(connection_->GetEntryUrlFromUUID(uuid, entry_type));
+}
+
+int DBStatsConnection::GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s) const
+{
+    DBOperationTimer timer(stats_, GET_MD5_SUMS_FOR_UUID_OPERATION);
+
+    return timer.Result(connection_->GetMd5SumsForUUID(uuid, md5s));
+}
+
+DBMd5SumDiff DBStatsConnection::DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh) const
+{
+    DBOperationTimer timer(stats_, DIFF_MD5_SUMS_OPERATION);
+
+    return timer.Result(connection_->DiffMd5Sums(uuid, fresh));
+}
+
+uint16_t DBStatsConnection::GetVersionFromMd5(const std::string &uuid, size_t index_num) const
+{
+    DBOperationTimer timer(stats_, GET_VERSION_FROM_MD5_OPERATION);
+
+    return timer.Result(connection_->GetVersionFromMd5(uuid, index_num));
+}
+
+DBRefresh DBStatsConnection::GetRefreshFromMinDate() const
+{
+    DBOperationTimer timer(stats_, GET_REFRESH_FROM_MIN_DATE_OPERATION);
+
+    return timer.Result(connection_->GetRefreshFromMinDate());
+}
+
+int DBStatsConnection::GetDueRefreshes(time_t now, size_t limit, std::vector<DBRefresh> &refreshes) const
+{
+    DBOperationTimer timer(stats_, GET_DUE_REFRESHES_OPERATION);
+
+    return timer.Result(connection_->GetDueRefreshes(now, limit, refreshes));
+}
+
+bool DBStatsConnection::IsReady() const
+{
+    return connection_->IsReady();
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -0,0 +1,198 @@
+/**
+ * DBUrlIndex.cc
+ */
+
+#include <DBUrlIndex.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+// 10 bits and 7 probes per url keeps the false positive rate near 1% at capacity
+static constexpr const size_t UrlIndexBitsPerUrl = 10;
+static constexpr const size_t UrlIndexNumHashes = 7;
+static constexpr const size_t UrlIndexMinCapacity = 1024;
+
+DBUrlIndex::DBUrlIndex(size_t expected_urls) :
+    bloom_(),
+    bloom_bits_(0),
+    capacity_(0),
+    stale_urls_(0),
+    urls_(),
+    url_bytes_(0),
+    lookups_(0),
+    bloom_negatives_(0),
+    bloom_false_positives_(0),
+    hits_(0)
+{
+    Rebuild(expected_urls);
+}
+
+void DBUrlIndex::Add(const std::string &url)
+{
+    auto res = urls_.emplace(url, 0);
+    ++res.first->second;
+
+    if (!res.second)
+        return;
+
+    url_bytes_ += url.size();
+
+    if (urls_.size() > capacity_)
+    {
+        Rebuild(capacity_ * 2);
+        return;
+    }
+
+    SetBloomBits(HashUrl(url));
+}
+
+// bloom bits can not be cleared, a removed url stays a false positive until enough of them
+// pile up to warrant a rebuild
+void DBUrlIndex::Remove(const std::string &url)
+{
+    const auto it = urls_.find(url);
+    if (it == urls_.end())
+        return;
+
+    if (--it->second > 0)
+        return;
+
+    url_bytes_ -= it->first.size();
+    urls_.erase(it);
+
+    if (++stale_urls_ > capacity_ / 2)
+        Rebuild(capacity_);
+}
+
+bool DBUrlIndex::Contains(const std::string &url) const
+{
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!TestBloomBits(HashUrl(url)))
+    {
+        bloom_negatives_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (urls_.find(url) == urls_.end())
+    {
+        bloom_false_positives_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    hits_.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+// false means the url is definitely absent, true means it might be present
+bool DBUrlIndex::MayContain(const std::string &url) const
+{
+    return TestBloomBits(HashUrl(url));
+}
+
+void DBUrlIndex::Clear()
+{
+    urls_.clear();
+    url_bytes_ = 0;
+    Rebuild(0);
+}
+
+size_t DBUrlIndex::Size() const
+{
+    return urls_.size();
+}
+
+DBUrlIndexStats DBUrlIndex::GetStats() const
+{
+    DBUrlIndexStats stats;
+
+    stats.urls = urls_.size();
+    stats.bloom_bits = bloom_bits_;
+    stats.bloom_hashes = UrlIndexNumHashes;
+    stats.lookups = lookups_;
+    stats.bloom_negatives = bloom_negatives_;
+    stats.bloom_false_positives = bloom_false_positives_;
+    stats.hits = hits_;
+
+    // estimate, each hash node holds the key, the count, a next pointer and a cached hash
+    const size_t node_bytes = sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void *);
+    stats.memory_bytes = bloom_.capacity() * sizeof(uint64_t) +
+        urls_.bucket_count() * sizeof(void *) +
+        urls_.size() * node_bytes +
+        url_bytes_;
+
+    return stats;
+}
+
+void DBUrlIndex::Rebuild(size_t capacity)
+{
+    capacity_ = capacity < UrlIndexMinCapacity ? UrlIndexMinCapacity : capacity;
+    while (capacity_ < urls_.size())
+        capacity_ *= 2;
+
+    bloom_bits_ = capacity_ * UrlIndexBitsPerUrl;
+    bloom_.assign((bloom_bits_ + 63) / 64, 0);
+    stale_urls_ = 0;
+    urls_.reserve(capacity_);
+
+    for (const auto &url : urls_)
+    {
+        SetBloomBits(HashUrl(url.first));
+    }
+}
+
+// Kirsch-Mitzenmacher, the probes are derived from the two halves of a single 64 bit hash
+void DBUrlIndex::SetBloomBits(uint64_t hash)
+{
+    const uint64_t h1 = hash & 0xffffffff;
+    const uint64_t h2 = (hash >> 32) | 1;
+
+    for (size_t i = 0; i < UrlIndexNumHashes; ++i)
+    {
+        const size_t bit = (h1 + i * h2) % bloom_bits_;
+        bloom_[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool DBUrlIndex::TestBloomBits(uint64_t hash) const
+{
+    const uint64_t h1 = hash & 0xffffffff;
+    const uint64_t h2 = (hash >> 32) | 1;
+
+    for (size_t i = 0; i < UrlIndexNumHashes; ++i)
+    {
+        const size_t bit = (h1 + i * h2) % bloom_bits_;
+        if (!(bloom_[bit / 64] & (uint64_t(1) << (bit % 64))))
+            return false;
+    }
+
+    return true;
+}
+
+// 64 bit FNV-1a with a murmur finalizer so both halves are well mixed
+uint64_t DBUrlIndex::HashUrl(const std::string &url)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (const unsigned char c : url)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -0,0 +1,695 @@
+/**
+ * DBWorkload.cc
+ */
+
+#include <tuple>
+
+#include <LogOperations.h>
+
+#include <SQLiteColumns.h>
+
+#include <BlackLibraryDB.h>
+#include <DBWorkload.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+namespace BlackLibraryCommon = black_library::core::common;
+
+static constexpr const char WorkloadBinaryMagic[] = "BLDBWKL";
+static constexpr const size_t WorkloadBinaryMagicSize = sizeof(WorkloadBinaryMagic);
+static constexpr const char WorkloadJsonFormatName[] = "black_library_db_workload";
+// version 2 records BlackLibraryDB calls, version 1 recorded the connection underneath it
+static constexpr const uint8_t WorkloadVersion = 2;
+static constexpr const uint32_t WorkloadMaxRecordSize = 64 * 1024 * 1024;
+
+template <typename Row, typename Columns>
+static njson RowToJson(const Row &row, const Columns &columns)
+{
+    njson j = njson::array();
+
+    std::apply([&j, &row](const auto &... column) {
+        (j.push_back(row.*(column.member)), ...);
+    }, columns);
+
+    return j;
+}
+
+template <typename Row, typename Columns>
+static Row RowFromJson(const njson &j, const Columns &columns)
+{
+    Row row{};
+    size_t i = 0;
+
+    std::apply([&j, &row, &i](const auto &... column) {
+        (j.at(i++).get_to(row.*(column.member)), ...);
+    }, columns);
+
+    return row;
+}
+
+template <typename Row, typename Columns>
+static std::vector<Row> RowsFromJson(const njson &j, const Columns &columns)
+{
+    std::vector<Row> rows;
+
+    rows.reserve(j.size());
+    for (const auto &row : j)
+    {
+        rows.emplace_back(RowFromJson<Row>(row, columns));
+    }
+
+    return rows;
+}
+
+njson WorkloadRowToJson(const DBEntry &entry)
+{
+    return RowToJson(entry, EntryColumns);
+}
+
+njson WorkloadRowToJson(const DBMd5Sum &md5)
+{
+    return RowToJson(md5, Md5SumColumns);
+}
+
+njson WorkloadRowToJson(const DBRefresh &refresh)
+{
+    return RowToJson(refresh, RefreshColumns);
+}
+
+njson WorkloadRowToJson(const DBErrorEntry &entry)
+{
+    return RowToJson(entry, ErrorEntryColumns);
+}
+
+njson WorkloadRowToJson(const std::vector<DBEntry> &entries)
+{
+    njson j = njson::array();
+
+    for (const auto &entry : entries)
+    {
+        j.push_back(WorkloadRowToJson(entry));
+    }
+
+    return j;
+}
+
+njson WorkloadRowToJson(const std::vector<DBMd5Sum> &md5s)
+{
+    njson j = njson::array();
+
+    for (const auto &md5 : md5s)
+    {
+        j.push_back(WorkloadRowToJson(md5));
+    }
+
+    return j;
+}
+
+DBWorkloadRecorder::DBWorkloadRecorder() :
+    out_(),
+    pending_(),
+    threads_(),
+    start_(std::chrono::steady_clock::now()),
+    writer_(),
+    pending_cv_(),
+    mutex_(),
+    record_count_(0),
+    format_(DB_WORKLOAD_BINARY_FORMAT),
+    open_(false)
+{
+}
+
+DBWorkloadRecorder::~DBWorkloadRecorder()
+{
+    Close();
+}
+
+int DBWorkloadRecorder::Open(const std::string &path, db_workload_format_t format)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    if (open_ || writer_.joinable())
+    {
+        BlackLibraryCommon::LogError("db", "Workload recorder already open");
+        return -1;
+    }
+
+    out_.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out_.is_open())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to open workload trace: {}", path);
+        return -1;
+    }
+
+    format_ = format;
+    pending_.clear();
+    threads_.clear();
+    record_count_ = 0;
+
+    if (format_ == DB_WORKLOAD_BINARY_FORMAT)
+    {
+        out_.write(WorkloadBinaryMagic, WorkloadBinaryMagicSize - 1);
+        out_.put(static_cast<char>(WorkloadVersion));
+    }
+    else
+    {
+        njson header;
+        header["format"] = WorkloadJsonFormatName;
+        header["version"] = WorkloadVersion;
+        out_ << header.dump() << '\n';
+    }
+
+    start_ = std::chrono::steady_clock::now();
+    open_ = true;
+    writer_ = std::thread(&DBWorkloadRecorder::WriteRecords, this);
+
+    BlackLibraryCommon::LogInfo("db", "Recording workload to: {}", path);
+
+    return 0;
+}
+
+void DBWorkloadRecorder::Record(db_operation_id_t operation, njson args)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!open_)
+        return;
+
+    DBWorkloadRecord record;
+    record.operation = operation;
+    record.offset_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    record.thread = threads_.emplace(std::this_thread::get_id(), static_cast<uint32_t>(threads_.size())).first->second;
+    record.args = std::move(args);
+
+    pending_.emplace_back(std::move(record));
+    ++record_count_;
+
+    const bool wake_writer = pending_.size() == 1;
+    lock.unlock();
+
+    if (wake_writer)
+        pending_cv_.notify_one();
+}
+
+// encodes outside the lock so recording threads only wait for the queue
+void DBWorkloadRecorder::WriteRecords()
+{
+    std::vector<DBWorkloadRecord> records;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pending_cv_.wait(lock, [this] { return !pending_.empty() || !open_; });
+
+            if (pending_.empty())
+                return;
+
+            records.swap(pending_);
+        }
+
+        for (auto &record : records)
+        {
+            const njson j = njson::array({ record.operation, record.offset_ns, record.thread, std::move(record.args) });
+
+            if (format_ == DB_WORKLOAD_BINARY_FORMAT)
+            {
+                const std::vector<uint8_t> bytes = njson::to_msgpack(j);
+                const uint32_t size = bytes.size();
+                const char size_bytes[] = { static_cast<char>(size), static_cast<char>(size >> 8), static_cast<char>(size >> 16), static_cast<char>(size >> 24) };
+
+                out_.write(size_bytes, sizeof(size_bytes));
+                out_.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+            }
+            else
+            {
+                out_ << j.dump() << '\n';
+            }
+        }
+
+        records.clear();
+    }
+}
+
+int DBWorkloadRecorder::Close()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!open_)
+            return 0;
+
+        open_ = false;
+    }
+
+    // the writer drains what was queued before it exits
+    pending_cv_.notify_one();
+    writer_.join();
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    out_.close();
+
+    if (out_.fail())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to write workload trace after {} records", record_count_);
+        return -1;
+    }
+
+    BlackLibraryCommon::LogInfo("db", "Recorded {} workload records", record_count_);
+
+    return 0;
+}
+
+uint64_t DBWorkloadRecorder::GetRecordCount()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    return record_count_;
+}
+
+static int ParseWorkloadRecord(const njson &j, DBWorkloadRecord &record)
+{
+    if (!j.is_array() || j.size() != 4)
+        return -1;
+
+    const uint64_t operation = j[0].get<uint64_t>();
+    if (operation >= _NUM_DB_OPERATIONS)
+        return -1;
+
+    record.operation = static_cast<db_operation_id_t>(operation);
+    record.offset_ns = j[1].get<uint64_t>();
+    record.thread = j[2].get<uint32_t>();
+    record.args = j[3];
+
+    return 0;
+}
+
+static int ReadBinaryWorkload(std::ifstream &in, std::vector<DBWorkloadRecord> &records)
+{
+    char size_bytes[4];
+    std::vector<uint8_t> bytes;
+
+    while (in.read(size_bytes, sizeof(size_bytes)))
+    {
+        const uint32_t size = static_cast<uint8_t>(size_bytes[0]) | static_cast<uint8_t>(size_bytes[1]) << 8 |
+            static_cast<uint8_t>(size_bytes[2]) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(size_bytes[3])) << 24;
+        if (size > WorkloadMaxRecordSize)
+        {
+            BlackLibraryCommon::LogError("db", "Workload record {} too large: {}", records.size(), size);
+            return -1;
+        }
+
+        bytes.resize(size);
+        if (!in.read(reinterpret_cast<char *>(bytes.data()), size))
+        {
+            BlackLibraryCommon::LogError("db", "Workload record {} truncated", records.size());
+            return -1;
+        }
+
+        DBWorkloadRecord record;
+        if (ParseWorkloadRecord(njson::from_msgpack(bytes), record))
+        {
+            BlackLibraryCommon::LogError("db", "Workload record {} malformed", records.size());
+            return -1;
+        }
+        records.emplace_back(std::move(record));
+    }
+
+    // a partial length means the recorder was cut off mid record
+    if (in.gcount() != 0)
+    {
+        BlackLibraryCommon::LogError("db", "Workload record {} truncated", records.size());
+        return -1;
+    }
+
+    return 0;
+}
+
+static int ReadJsonWorkload(std::ifstream &in, std::vector<DBWorkloadRecord> &records)
+{
+    std::string line;
+
+    if (!std::getline(in, line))
+    {
+        BlackLibraryCommon::LogError("db", "Workload trace is empty");
+        return -1;
+    }
+
+    const njson header = njson::parse(line);
+    if (!header.is_object() || header.value("format", "") != WorkloadJsonFormatName || header.value("version", 0) != WorkloadVersion)
+    {
+        BlackLibraryCommon::LogError("db", "Workload trace header not recognized: {}", line);
+        return -1;
+    }
+
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+
+        DBWorkloadRecord record;
+        if (ParseWorkloadRecord(njson::parse(line), record))
+        {
+            BlackLibraryCommon::LogError("db", "Workload record {} malformed", records.size());
+            return -1;
+        }
+        records.emplace_back(std::move(record));
+    }
+
+    return 0;
+}
+
+int ReadDBWorkload(const std::string &path, std::vector<DBWorkloadRecord> &records)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to open workload trace: {}", path);
+        return -1;
+    }
+
+    records.clear();
+
+    char magic[WorkloadBinaryMagicSize] = {};
+    in.read(magic, WorkloadBinaryMagicSize);
+
+    try
+    {
+        if (in.gcount() == WorkloadBinaryMagicSize && std::string(magic, WorkloadBinaryMagicSize - 1) == WorkloadBinaryMagic)
+        {
+            if (static_cast<uint8_t>(magic[WorkloadBinaryMagicSize - 1]) != WorkloadVersion)
+            {
+                BlackLibraryCommon::LogError("db", "Workload trace version {} not supported", static_cast<uint8_t>(magic[WorkloadBinaryMagicSize - 1]));
+                return -1;
+            }
+
+            return ReadBinaryWorkload(in, records);
+        }
+
+        in.clear();
+        in.seekg(0);
+
+        return ReadJsonWorkload(in, records);
+    }
+    catch (const njson::exception &ex)
+    {
+        BlackLibraryCommon::LogError("db", "Failed to parse workload record {}: {}", records.size(), ex.what());
+        return -1;
+    }
+}
+
+static int ReplayResult(int res)
+{
+    return res == 0 ? 0 : -1;
+}
+
+static int ReplayResult(const std::vector<int> &res)
+{
+    for (const auto &r : res)
+    {
+        if (r != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int ReplayResult(const DBStringResult &res)
+{
+    return res.error == 0 ? 0 : -1;
+}
+
+static int ReplayResult(const DBMd5SumDiff &res)
+{
+    return res.error == 0 ? 0 : -1;
+}
+
+static int ReplayResult(bool)
+{
+    return 0;
+}
+
+static int ReplayEntryTypeError(entry_table_rep_t entry_type)
+{
+    BlackLibraryCommon::LogError("db", "Workload entry type {} not replayable", entry_type);
+    return -1;
+}
+
+// overloads without a column mask are recorded without one so replay takes the same path.
+// lookups answered by BlackLibraryDB (found or not) are not failures, only reported errors are
+static int ReplayCall(BlackLibraryDB &db, const DBWorkloadRecord &record)
+{
+    const njson &args = record.args;
+
+    switch (record.operation)
+    {
+        case LIST_ENTRIES_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(0).get<entry_table_rep_t>();
+            if (entry_type != STAGING_ENTRY && entry_type != BLACK_ENTRY)
+                return ReplayEntryTypeError(entry_type);
+            if (args.size() > 1)
+            {
+                const entry_column_mask_t columns = args.at(1).get<entry_column_mask_t>();
+                if (entry_type == STAGING_ENTRY)
+                    db.GetStagingEntryList(columns);
+                else
+                    db.GetBlackEntryList(columns);
+            }
+            else
+            {
+                if (entry_type == STAGING_ENTRY)
+                    db.GetStagingEntryList();
+                else
+                    db.GetBlackEntryList();
+            }
+            return 0;
+        }
+        case FOR_EACH_ENTRY_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(0).get<entry_table_rep_t>();
+            const entry_callback_t callback = [](const DBEntry &) { return true; };
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.ForEachStagingEntry(callback));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.ForEachBlackEntry(callback));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case FOR_EACH_ENTRY_VIEW_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(0).get<entry_table_rep_t>();
+            const entry_column_mask_t columns = args.at(1).get<entry_column_mask_t>();
+            const entry_view_callback_t callback = [](const DBEntryView &) { return true; };
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.ForEachStagingEntryView(columns, callback));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.ForEachBlackEntryView(columns, callback));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case LIST_CHECKSUMS_OPERATION:
+            db.GetChecksumList();
+            return 0;
+        case LIST_ERROR_ENTRIES_OPERATION:
+            db.GetErrorEntryList();
+            return 0;
+        case LIST_ENTRIES_PAGE_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(0).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                db.GetStagingEntryPage(args.at(1).get<std::string>(), args.at(2).get<size_t>());
+            else if (entry_type == BLACK_ENTRY)
+                db.GetBlackEntryPage(args.at(1).get<std::string>(), args.at(2).get<size_t>());
+            else
+                return ReplayEntryTypeError(entry_type);
+            return 0;
+        }
+        case LIST_CHECKSUMS_PAGE_OPERATION:
+            db.GetChecksumPage(args.at(0).get<std::string>(), args.at(1).get<size_t>(), args.at(2).get<size_t>());
+            return 0;
+        case LIST_ERROR_ENTRIES_PAGE_OPERATION:
+            db.GetErrorEntryPage(args.at(0).get<std::string>(), args.at(1).get<size_t>());
+            return 0;
+        case CREATE_ENTRIES_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.CreateStagingEntries(RowsFromJson<DBEntry>(args.at(0), EntryColumns)));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.CreateBlackEntries(RowsFromJson<DBEntry>(args.at(0), EntryColumns)));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case UPDATE_ENTRIES_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.UpdateStagingEntries(RowsFromJson<DBEntry>(args.at(0), EntryColumns)));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.UpdateBlackEntries(RowsFromJson<DBEntry>(args.at(0), EntryColumns)));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case CREATE_ENTRY_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.CreateStagingEntry(RowFromJson<DBEntry>(args.at(0), EntryColumns)));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.CreateBlackEntry(RowFromJson<DBEntry>(args.at(0), EntryColumns)));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case READ_ENTRY_OPERATION:
+        {
+            const std::string uuid = args.at(0).get<std::string>();
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type != STAGING_ENTRY && entry_type != BLACK_ENTRY)
+                return ReplayEntryTypeError(entry_type);
+            if (args.size() > 2)
+            {
+                const entry_column_mask_t columns = args.at(2).get<entry_column_mask_t>();
+                if (entry_type == STAGING_ENTRY)
+                    db.ReadStagingEntry(uuid, columns);
+                else
+                    db.ReadBlackEntry(uuid, columns);
+            }
+            else
+            {
+                if (entry_type == STAGING_ENTRY)
+                    db.ReadStagingEntry(uuid);
+                else
+                    db.ReadBlackEntry(uuid);
+            }
+            return 0;
+        }
+        case UPDATE_ENTRY_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.UpdateStagingEntry(RowFromJson<DBEntry>(args.at(0), EntryColumns)));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.UpdateBlackEntry(RowFromJson<DBEntry>(args.at(0), EntryColumns)));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case DELETE_ENTRY_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.DeleteStagingEntry(args.at(0).get<std::string>()));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.DeleteBlackEntry(args.at(0).get<std::string>()));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case CREATE_MD5_SUM_OPERATION:
+            return ReplayResult(db.CreateMd5Sum(RowFromJson<DBMd5Sum>(args.at(0), Md5SumColumns)));
+        case READ_MD5_SUM_OPERATION:
+            db.ReadMd5Sum(args.at(0).get<std::string>(), args.at(1).get<size_t>());
+            return 0;
+        case UPDATE_MD5_SUM_OPERATION:
+            return ReplayResult(db.UpdateMd5Sum(RowFromJson<DBMd5Sum>(args.at(0), Md5SumColumns)));
+        case UPSERT_MD5_SUMS_OPERATION:
+            return ReplayResult(db.UpsertMd5Sums(args.at(0).get<std::string>(), RowsFromJson<DBMd5Sum>(args.at(1), Md5SumColumns)));
+        case DELETE_MD5_SUM_OPERATION:
+            return ReplayResult(db.DeleteMd5Sum(args.at(0).get<std::string>(), args.at(1).get<size_t>()));
+        case CREATE_REFRESH_OPERATION:
+            return ReplayResult(db.CreateRefresh(RowFromJson<DBRefresh>(args.at(0), RefreshColumns)));
+        case READ_REFRESH_OPERATION:
+            db.ReadRefresh(args.at(0).get<std::string>());
+            return 0;
+        case DELETE_REFRESH_OPERATION:
+            return ReplayResult(db.DeleteRefresh(args.at(0).get<std::string>()));
+        case CLAIM_REFRESHES_OPERATION:
+            db.ClaimRefreshes(args.at(0).get<std::string>(), args.at(1).get<time_t>(), args.at(2).get<size_t>());
+            return 0;
+        case COMPLETE_REFRESH_OPERATION:
+            return ReplayResult(db.CompleteRefresh(args.at(0).get<std::string>(), args.at(1).get<std::string>()));
+        case RELEASE_REFRESH_OPERATION:
+            return ReplayResult(db.ReleaseRefresh(args.at(0).get<std::string>(), args.at(1).get<std::string>()));
+        case CREATE_ERROR_ENTRY_OPERATION:
+            return ReplayResult(db.CreateErrorEntry(RowFromJson<DBErrorEntry>(args.at(0), ErrorEntryColumns)));
+        case DELETE_ERROR_ENTRY_OPERATION:
+            return ReplayResult(db.DeleteErrorEntry(args.at(0).get<std::string>(), args.at(1).get<size_t>()));
+        case DOES_ENTRY_URL_EXIST_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.DoesStagingEntryUrlExist(args.at(0).get<std::string>()));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.DoesBlackEntryUrlExist(args.at(0).get<std::string>()));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case DOES_ENTRY_UUID_EXIST_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.DoesStagingEntryUUIDExist(args.at(0).get<std::string>()));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.DoesBlackEntryUUIDExist(args.at(0).get<std::string>()));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case DOES_MD5_SUM_EXIST_OPERATION:
+            return ReplayResult(db.DoesMd5SumExist(args.at(0).get<std::string>(), args.at(1).get<size_t>()));
+        case DOES_REFRESH_EXIST_OPERATION:
+            return ReplayResult(db.DoesRefreshExist(args.at(0).get<std::string>()));
+        case DOES_MIN_REFRESH_EXIST_OPERATION:
+            return ReplayResult(db.DoesMinRefreshExist());
+        case DOES_ERROR_ENTRY_EXIST_OPERATION:
+            return ReplayResult(db.DoesErrorEntryExist(args.at(0).get<std::string>(), args.at(1).get<size_t>()));
+        case GET_ENTRY_UUID_FROM_URL_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.GetStagingEntryUUIDFromUrl(args.at(0).get<std::string>()));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.GetBlackEntryUUIDFromUrl(args.at(0).get<std::string>()));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case GET_ENTRY_URL_FROM_UUID_OPERATION:
+        {
+            const entry_table_rep_t entry_type = args.at(1).get<entry_table_rep_t>();
+            if (entry_type == STAGING_ENTRY)
+                return ReplayResult(db.GetStagingEntryUrlFromUUID(args.at(0).get<std::string>()));
+            if (entry_type == BLACK_ENTRY)
+                return ReplayResult(db.GetBlackEntryUrlFromUUID(args.at(0).get<std::string>()));
+            return ReplayEntryTypeError(entry_type);
+        }
+        case GET_MD5_SUMS_FOR_UUID_OPERATION:
+        {
+            std::vector<DBMd5Sum> md5s;
+            return ReplayResult(db.GetMd5SumsForUUID(args.at(0).get<std::string>(), md5s));
+        }
+        case DIFF_MD5_SUMS_OPERATION:
+            return ReplayResult(db.DiffMd5Sums(args.at(0).get<std::string>(), args.at(1).get<std::vector<std::pair<size_t, std::string>>>()));
+        case GET_VERSION_FROM_MD5_OPERATION:
+            db.GetVersionFromMd5(args.at(0).get<std::string>(), args.at(1).get<size_t>());
+            return 0;
+        case GET_REFRESH_FROM_MIN_DATE_OPERATION:
+            db.GetRefreshFromMinDate();
+            return 0;
+        case GET_DUE_REFRESHES_OPERATION:
+            db.GetDueRefreshes(args.at(0).get<time_t>(), args.at(1).get<size_t>());
+            return 0;
+        default:
+            BlackLibraryCommon::LogError("db", "Workload operation {} not replayable", record.operation);
+            return -1;
+    }
+}
+
+int ReplayDBWorkloadRecord(BlackLibraryDB &db, const DBWorkloadRecord &record)
+{
+    try
+    {
+        return ReplayCall(db, record);
+    }
+    catch (const njson::exception &ex)
+    {
+        BlackLibraryCommon::LogError("db", "Failed to decode {} workload args: {}", DBStats::OperationName(record.operation), ex.what());
+        return -1;
+    }
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -2,15 +2,24 @@
  * SQLiteDB.cc
  */
 
+#include <algorithm>
+#include <ctime>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <utility>
 
 #include <FileOperations.h>
 #include <LogOperations.h>
 #include <SourceInformation.h>
 
+#include <spdlog/spdlog.h>
+
 #include <DBConnectionInterfaceUtils.h>
+#include <SQLiteColumns.h>
 #include <SQLiteDB.h>
 
 namespace black_library {
@@ -21,6 +30,15 @@ namespace db {
 
 namespace BlackLibraryCommon = black_library::core::common;
 
+// hot path instrumentation, arguments are only evaluated once the cached db logger passes its level check
+#ifdef BLACKLIBRARYDB_NO_TRACE_LOG
+#define DB_LOG_ENABLED(level) false
+#else
+#define DB_LOG_ENABLED(level) (logger_ && logger_->should_log(level))
+#endif
+#define DB_LOG_TRACE(...) do { if (DB_LOG_ENABLED(spdlog::level::trace)) logger_->trace(__VA_ARGS__); } while (0)
+#define DB_LOG_DEBUG(...) do { if (DB_LOG_ENABLED(spdlog::level::debug)) logger_->debug(__VA_ARGS__); } while (0)
+
 static constexpr const char CreateUserTable[]                     = "CREATE TABLE IF NOT EXISTS user(UID INTEGER PRIMARY KEY, permission_level INTEGER DEFAULT 0 NOT NULL, name TEXT NOT NULL)";
 static constexpr const char CreateMediaTypeTable[]                = "CREATE TABLE IF NOT EXISTS media_type(name TEXT NOT NULL PRIMARY KEY)";
 static constexpr const char CreateMediaSubtypeTable[]             = "CREATE TABLE IF NOT EXISTS media_subtype(name TEXT NOT NULL PRIMARY KEY, media_type_name TEXT, FOREIGN KEY(media_type_name) REFERENCES media_type(name))";
@@ -32,30 +50,19 @@ static constexpr const char CreateBlackEntryTable[]               = "CREATE TABL
 static constexpr const char CreateMd5SumTable[]                   = "CREATE TABLE IF NOT EXISTS md5_sum(UUID VARCHAR(36) NOT NULL, index_num INTERGER, md5_sum VARCHAR(32), version_num INTERGER, PRIMARY KEY (UUID, index_num))";
 static constexpr const char CreateRefreshTable[]                  = "CREATE TABLE IF NOT EXISTS refresh(UUID VARCHAR(36) NOT NULL PRIMARY KEY, refresh_date INTERGER)";
 static constexpr const char CreateErrorEntryTable[]               = "CREATE TABLE IF NOT EXISTS error_entry(UUID VARCHAR(36) PRIMARY KEY NOT NULL, progress_num INTEGER)";
+static constexpr const char CreateMd5SumDiffTempTable[]           = "CREATE TEMP TABLE IF NOT EXISTS md5_sum_diff(index_num INTEGER PRIMARY KEY, md5_sum VARCHAR(32))";
+static constexpr const char CreateStagingEntryUrlIndex[]          = "CREATE INDEX IF NOT EXISTS staging_entry_url_idx ON staging_entry(url)";
+static constexpr const char CreateBlackEntryUrlIndex[]            = "CREATE INDEX IF NOT EXISTS black_entry_url_idx ON black_entry(url)";
+static constexpr const char CreateRefreshDateIndex[]              = "CREATE INDEX IF NOT EXISTS refresh_date_idx ON refresh(refresh_date)";
+static constexpr const char AddRefreshLeaseOwnerColumn[]          = "ALTER TABLE refresh ADD COLUMN lease_owner TEXT";
+static constexpr const char AddRefreshLeaseExpiresColumn[]        = "ALTER TABLE refresh ADD COLUMN lease_expires INTEGER";
 
 static constexpr const char CreateUserStatement[]                 = "INSERT INTO user(UID, permission_level, name) VALUES (:UID, :permission_level, :name)";
 static constexpr const char CreateMediaTypeStatement[]            = "INSERT INTO media_type(name) VALUES (:name)";
 static constexpr const char CreateMediaSubtypeStatement[]         = "INSERT INTO media_subtype(name, media_type_name) VALUES (:name, :media_type_name)";
 static constexpr const char CreateSourceStatement[]               = "INSERT INTO source(name, media_type, media_subtype) VALUES (:name, :media_type, :media_subtype)";
-static constexpr const char CreateStagingEntryStatement[]         = "INSERT INTO staging_entry(UUID, title, author, nickname, source, url, last_url, series, series_length, version, media_path, birth_date, check_date, update_date, user_contributed) VALUES (:UUID, :title, :author, :nickname, :source, :url, :last_url, :series, :series_length, :version, :media_path, :birth_date, :check_date, :update_date, :user_contributed)";
-static constexpr const char CreateBlackEntryStatement[]           = "INSERT INTO black_entry(UUID, title, author, nickname, source, url, last_url, series, series_length, version, media_path, birth_date, check_date, update_date, user_contributed) VALUES (:UUID, :title, :author, :nickname, :source, :url, :last_url, :series, :series_length, :version, :media_path, :birth_date, :check_date, :update_date, :user_contributed)";
-static constexpr const char CreateMd5SumStatement[]               = "INSERT INTO md5_sum(UUID, index_num, md5_sum, version_num) VALUES (:UUID, :index_num, :md5_sum, :version_num)";
-static constexpr const char CreateRefreshStatement[]              = "INSERT INTO refresh(UUID, refresh_date) VALUES (:UUID, :refresh_date)";
-static constexpr const char CreateErrorEntryStatement[]           = "INSERT INTO error_entry(UUID, progress_num) VALUES (:UUID, :progress_num)";
-
-static constexpr const char ReadStagingEntryStatement[]           = "SELECT * FROM staging_entry WHERE UUID = :UUID";
-static constexpr const char ReadStagingEntryUrlStatement[]        = "SELECT * FROM staging_entry WHERE url = :url";
-static constexpr const char ReadStagingEntryUUIDStatement[]       = "SELECT * FROM staging_entry WHERE UUID = :UUID";
-static constexpr const char ReadBlackEntryStatement[]             = "SELECT * FROM black_entry WHERE UUID = :UUID";
-static constexpr const char ReadBlackEntryUrlStatement[]          = "SELECT * FROM black_entry WHERE url = :url";
-static constexpr const char ReadBlackEntryUUIDStatement[]         = "SELECT * FROM black_entry WHERE UUID = :UUID";
-static constexpr const char ReadMd5SumStatement[]                 = "SELECT * FROM md5_sum WHERE UUID = :UUID AND index_num = :index_num";
-static constexpr const char ReadRefreshStatement[]                = "SELECT * FROM refresh WHERE UUID = :UUID";
-static constexpr const char ReadErrorEntryStatement[]             = "SELECT * FROM error_entry WHERE UUID = :UUID AND progress_num = :progress_num";
-
-static constexpr const char UpdateStagingEntryStatement[]         = "UPDATE staging_entry SET title = :title, author = :author, nickname = :nickname, source = :source, url = :url, last_url = :last_url, series = :series, series_length = :series_length, version = :version, media_path = :media_path, birth_date = :birth_date, check_date = :check_date, update_date = :update_date, user_contributed = :user_contributed WHERE UUID = :UUID";
-static constexpr const char UpdateBlackEntryStatement[]           = "UPDATE black_entry SET title = :title, author = :author, nickname = :nickname, source = :source, url = :url, last_url = :last_url, series = :series, series_length = :series_length, version = :version, media_path = :media_path, birth_date = :birth_date, check_date = :check_date, update_date = :update_date, user_contributed = :user_contributed WHERE UUID = :UUID";
-static constexpr const char UpdateMd5SumStatement[]               = "UPDATE md5_sum SET md5_sum = :md5_sum, version_num = :version_num WHERE UUID = :UUID AND index_num = :index_num";
+
+static constexpr const char UpsertMd5SumStatement[]               = "INSERT INTO md5_sum(UUID, index_num, md5_sum, version_num) VALUES (:UUID, :index_num, :md5_sum, :version_num) ON CONFLICT(UUID, index_num) DO UPDATE SET md5_sum = excluded.md5_sum, version_num = excluded.version_num";
 
 static constexpr const char DeleteStagingEntryStatement[]         = "DELETE FROM staging_entry WHERE UUID = :UUID";
 static constexpr const char DeleteBlackEntryStatement[]           = "DELETE FROM black_entry WHERE UUID = :UUID";
@@ -63,18 +70,45 @@ static constexpr const char DeleteMd5SumStatement[]               = "DELETE FROM
 static constexpr const char DeleteRefreshStatement[]              = "DELETE FROM refresh WHERE UUID = :UUID";
 static constexpr const char DeleteErrorEntryStatement[]           = "DELETE FROM error_entry WHERE UUID = :UUID AND progress_num = :progress_num";
 
-static constexpr const char GetStagingEntriesStatement[]          = "SELECT * FROM staging_entry";
-static constexpr const char GetBlackEntriesStatement[]            = "SELECT * FROM black_entry";
-static constexpr const char GetMd5sumsStatement[]                 = "SELECT * FROM md5_sum";
-static constexpr const char GetErrorEntriesStatement[]            = "SELECT * FROM error_entry";
-
 static constexpr const char DoesMinRefreshExistStatement[]        = "SELECT CASE WHEN EXISTS(SELECT 1 FROM refresh) THEN 1 ELSE 0 END";
 static constexpr const char GetStagingEntryUUIDFromUrlStatement[] = "SELECT UUID FROM staging_entry WHERE url = :url";
 static constexpr const char GetBlackEntryUUIDFromUrlStatement[]   = "SELECT UUID FROM black_entry WHERE url = :url";
 static constexpr const char GetStagingEntryUrlFromUUIDStatement[] = "SELECT url, last_url FROM staging_entry WHERE UUID = :UUID";
 static constexpr const char GetBlackEntryUrlFromUUIDStatement[]   = "SELECT url, last_url FROM black_entry WHERE UUID = :UUID";
 static constexpr const char GetMd5SumFromUUIDAndIndexStatement[]  = "SELECT md5_sum FROM md5_sum WHERE UUID = :UUID AND index_num = :index_num";
-static constexpr const char GetRefreshFromMinDateStatement[]      = "SELECT * FROM refresh WHERE refresh_date=(SELECT MIN(refresh_date) FROM refresh)";
+static constexpr const char ClearMd5SumDiffStatement[]            = "DELETE FROM temp.md5_sum_diff";
+static constexpr const char InsertMd5SumDiffStatement[]           = "INSERT OR REPLACE INTO temp.md5_sum_diff(index_num, md5_sum) VALUES (:index_num, :md5_sum)";
+static constexpr const char DiffMd5SumsStatement[]                = "SELECT f.index_num, CASE WHEN m.index_num IS NULL THEN 0 ELSE 1 END FROM temp.md5_sum_diff f LEFT JOIN md5_sum m ON m.UUID = :UUID AND m.index_num = f.index_num WHERE m.md5_sum IS NOT f.md5_sum "
+                                                                    "UNION ALL SELECT m.index_num, 2 FROM md5_sum m WHERE m.UUID = :UUID AND NOT EXISTS (SELECT 1 FROM temp.md5_sum_diff f WHERE f.index_num = m.index_num) ORDER BY 1";
+
+static constexpr const char GetClaimableRefreshesStatement[]      = "SELECT UUID, refresh_date FROM refresh WHERE refresh_date <= :now AND (lease_owner IS NULL OR lease_expires <= :now) ORDER BY refresh_date LIMIT :limit";
+static constexpr const char ClaimRefreshStatement[]               = "UPDATE refresh SET lease_owner = :lease_owner, lease_expires = :lease_expires WHERE UUID = :UUID AND (lease_owner IS NULL OR lease_expires <= :now)";
+static constexpr const char CompleteRefreshStatement[]            = "DELETE FROM refresh WHERE UUID = :UUID AND lease_owner = :lease_owner";
+static constexpr const char ReleaseRefreshStatement[]             = "UPDATE refresh SET lease_owner = NULL, lease_expires = NULL WHERE UUID = :UUID AND lease_owner = :lease_owner";
+
+static constexpr const char BeginDeferredTransactionStatement[]   = "BEGIN DEFERRED TRANSACTION";
+static constexpr const char BeginImmediateTransactionStatement[]  = "BEGIN IMMEDIATE TRANSACTION";
+static constexpr const char CommitTransactionStatement[]          = "COMMIT TRANSACTION";
+static constexpr const char RollbackTransactionStatement[]        = "ROLLBACK TRANSACTION";
+
+static constexpr const int BusyTimeoutMs                          = 5000;
+
+// indexed by sqlite_parameter_id_t, resolved to bind indices once per prepared statement
+static constexpr const char *ParameterNames[] = { ":UID", ":UUID", ":author", ":birth_date", ":check_date", ":index_num", ":last_url", ":lease_expires",
+    ":lease_owner", ":limit", ":md5_sum", ":media_path", ":media_subtype", ":media_type", ":media_type_name", ":name", ":nickname", ":now",
+    ":permission_level", ":progress_num", ":refresh_date", ":series", ":series_length", ":source", ":title", ":update_date", ":url",
+    ":user_contributed", ":version", ":version_num" };
+static_assert(sizeof(ParameterNames) / sizeof(ParameterNames[0]) == _NUM_SQLITE_PARAMETERS, "ParameterNames must match sqlite_parameter_id_t");
+
+// ordered by version, PRAGMA user_version records the last one applied
+// new schema changes are appended here, never edit a migration that has shipped
+static const std::vector<SQLiteMigration> Migrations = {
+    { 1, "create tables", { CreateUserTable, CreateMediaTypeTable, CreateMediaSubtypeTable, CreateBookGenreTable, CreateDocumentTagTable, CreateSourceTable,
+        CreateStagingEntryTable, CreateBlackEntryTable, CreateMd5SumTable, CreateRefreshTable, CreateErrorEntryTable } },
+    { 2, "index entry urls", { CreateStagingEntryUrlIndex, CreateBlackEntryUrlIndex } },
+    { 3, "index refresh dates", { CreateRefreshDateIndex } },
+    { 4, "add refresh leases", { AddRefreshLeaseOwnerColumn, AddRefreshLeaseExpiresColumn } },
+};
 
 typedef enum {
     CREATE_USER_STATEMENT,
@@ -100,6 +134,7 @@ typedef enum {
     UPDATE_STAGING_ENTRY_STATEMENT,
     UPDATE_BLACK_ENTRY_STATEMENT,
     UPDATE_MD5_SUM_STATEMENT,
+    UPSERT_MD5_SUM_STATEMENT,
 
     DELETE_STAGING_ENTRY_STATEMENT,
     DELETE_BLACK_ENTRY_STATEMENT,
@@ -111,6 +146,10 @@ typedef enum {
     GET_BLACK_ENTRIES_STATEMENT,
     GET_CHECKSUMS_STATEMENT,
     GET_ERROR_ENTRIES_STATEMENT,
+    GET_STAGING_ENTRIES_PAGE_STATEMENT,
+    GET_BLACK_ENTRIES_PAGE_STATEMENT,
+    GET_CHECKSUMS_PAGE_STATEMENT,
+    GET_ERROR_ENTRIES_PAGE_STATEMENT,
 
     DOES_MIN_REFRESH_EXIST_STATEMENT,
     GET_STAGING_ENTRY_UUID_FROM_URL_STATEMENT,
@@ -118,55 +157,187 @@ typedef enum {
     GET_BLACK_ENTRY_UUID_FROM_URL_STATEMENT,
     GET_BLACK_ENTRY_URL_FROM_UUID_STATEMENT,
     GET_MD5_SUM_FROM_UUID_AND_INDEX_STATEMENT,
+    GET_MD5_SUMS_FROM_UUID_STATEMENT,
     GET_REFRESH_FROM_MIN_DATE_STATEMENT,
+    GET_DUE_REFRESHES_STATEMENT,
+
+    CLEAR_MD5_SUM_DIFF_STATEMENT,
+    INSERT_MD5_SUM_DIFF_STATEMENT,
+    DIFF_MD5_SUMS_STATEMENT,
+
+    GET_CLAIMABLE_REFRESHES_STATEMENT,
+    CLAIM_REFRESH_STATEMENT,
+    COMPLETE_REFRESH_STATEMENT,
+    RELEASE_REFRESH_STATEMENT,
+
+    BEGIN_DEFERRED_TRANSACTION_STATEMENT,
+    BEGIN_IMMEDIATE_TRANSACTION_STATEMENT,
+    COMMIT_TRANSACTION_STATEMENT,
+    ROLLBACK_TRANSACTION_STATEMENT,
 
     _NUM_PREPARED_STATEMENTS
 } prepared_statement_id_t;
 
-SQLiteDB::SQLiteDB(const std::string &database_url) :
-    database_conn_(),
-    prepared_statements_(),
+// indexed by prepared_statement_id_t, names statements in the slow query log
+static constexpr const char *PreparedStatementNames[] = { "CREATE_USER_STATEMENT", "CREATE_MEDIA_TYPE_STATEMENT", "CREATE_MEDIA_SUBTYPE_STATEMENT",
+    "CREATE_SOURCE_STATEMENT", "CREATE_STAGING_ENTRY_STATEMENT", "CREATE_BLACK_ENTRY_STATEMENT", "CREATE_MD5_SUM_STATEMENT",
+    "CREATE_REFRESH_STATEMENT", "CREATE_ERROR_ENTRY_STATEMENT", "READ_STAGING_ENTRY_STATEMENT", "READ_STAGING_ENTRY_URL_STATEMENT",
+    "READ_STAGING_ENTRY_UUID_STATEMENT", "READ_BLACK_ENTRY_STATEMENT", "READ_BLACK_ENTRY_URL_STATEMENT", "READ_BLACK_ENTRY_UUID_STATEMENT",
+    "READ_MD5_SUM_STATEMENT", "READ_REFRESH_STATEMENT", "READ_ERROR_ENTRY_STATEMENT", "UPDATE_STAGING_ENTRY_STATEMENT",
+    "UPDATE_BLACK_ENTRY_STATEMENT", "UPDATE_MD5_SUM_STATEMENT", "UPSERT_MD5_SUM_STATEMENT", "DELETE_STAGING_ENTRY_STATEMENT",
+    "DELETE_BLACK_ENTRY_STATEMENT", "DELETE_MD5_SUM_STATEMENT", "DELETE_REFRESH_STATEMENT", "DELETE_ERROR_ENTRY_STATEMENT",
+    "GET_STAGING_ENTRIES_STATEMENT", "GET_BLACK_ENTRIES_STATEMENT", "GET_CHECKSUMS_STATEMENT", "GET_ERROR_ENTRIES_STATEMENT",
+    "GET_STAGING_ENTRIES_PAGE_STATEMENT", "GET_BLACK_ENTRIES_PAGE_STATEMENT", "GET_CHECKSUMS_PAGE_STATEMENT", "GET_ERROR_ENTRIES_PAGE_STATEMENT",
+    "DOES_MIN_REFRESH_EXIST_STATEMENT", "GET_STAGING_ENTRY_UUID_FROM_URL_STATEMENT", "GET_STAGING_ENTRY_URL_FROM_UUID_STATEMENT",
+    "GET_BLACK_ENTRY_UUID_FROM_URL_STATEMENT", "GET_BLACK_ENTRY_URL_FROM_UUID_STATEMENT", "GET_MD5_SUM_FROM_UUID_AND_INDEX_STATEMENT",
+    "GET_MD5_SUMS_FROM_UUID_STATEMENT", "GET_REFRESH_FROM_MIN_DATE_STATEMENT", "GET_DUE_REFRESHES_STATEMENT", "CLEAR_MD5_SUM_DIFF_STATEMENT",
+    "INSERT_MD5_SUM_DIFF_STATEMENT", "DIFF_MD5_SUMS_STATEMENT", "GET_CLAIMABLE_REFRESHES_STATEMENT", "CLAIM_REFRESH_STATEMENT",
+    "COMPLETE_REFRESH_STATEMENT", "RELEASE_REFRESH_STATEMENT", "BEGIN_DEFERRED_TRANSACTION_STATEMENT", "BEGIN_IMMEDIATE_TRANSACTION_STATEMENT",
+    "COMMIT_TRANSACTION_STATEMENT", "ROLLBACK_TRANSACTION_STATEMENT" };
+static_assert(sizeof(PreparedStatementNames) / sizeof(PreparedStatementNames[0]) == _NUM_PREPARED_STATEMENTS, "PreparedStatementNames must match prepared_statement_id_t");
+
+static inline const char *ParameterName(sqlite3_stmt *stmt, int parameter_index)
+{
+    const char *name = sqlite3_bind_parameter_name(stmt, parameter_index);
+    if (!name)
+        return "unknown";
+
+    return name;
+}
+
+class SQLiteDB::ReadConnectionLease
+{
+public:
+    explicit ReadConnectionLease(const SQLiteDB &db) :
+        db_(db),
+        write_lock_(),
+        connection_(nullptr)
+    {
+        // without a read pool every read shares the writer connection
+        if (db_.read_connections_.empty())
+        {
+            write_lock_ = std::unique_lock<std::mutex>(db_.write_mutex_);
+            connection_ = &db_.write_connection_;
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(db_.read_pool_mutex_);
+        db_.read_pool_cv_.wait(lock, [this]{ return !db_.idle_read_connections_.empty(); });
+        connection_ = db_.idle_read_connections_.back();
+        db_.idle_read_connections_.pop_back();
+    }
+
+    ~ReadConnectionLease()
+    {
+        if (write_lock_.owns_lock())
+            return;
+
+        {
+            const std::lock_guard<std::mutex> lock(db_.read_pool_mutex_);
+            db_.idle_read_connections_.emplace_back(connection_);
+        }
+        db_.read_pool_cv_.notify_one();
+    }
+
+    const SQLiteConnection *operator->() const
+    {
+        return connection_;
+    }
+
+    const SQLiteConnection &operator*() const
+    {
+        return *connection_;
+    }
+
+private:
+    const SQLiteDB &db_;
+    std::unique_lock<std::mutex> write_lock_;
+    const SQLiteConnection *connection_;
+};
+
+class SQLiteDB::WriteConnectionLease
+{
+public:
+    explicit WriteConnectionLease(const SQLiteDB &db) :
+        write_lock_(db.write_mutex_),
+        connection_(&db.write_connection_)
+    {
+    }
+
+    const SQLiteConnection *operator->() const
+    {
+        return connection_;
+    }
+
+    const SQLiteConnection &operator*() const
+    {
+        return *connection_;
+    }
+
+private:
+    const std::lock_guard<std::mutex> write_lock_;
+    const SQLiteConnection *connection_;
+};
+
+SQLiteDB::SQLiteDB(const std::string &database_url, size_t read_pool_size, size_t slow_query_threshold_ms) :
+    write_connection_(),
+    read_connections_(),
+    idle_read_connections_(),
+    read_pool_mutex_(),
+    read_pool_cv_(),
+    write_mutex_(),
+    logger_(spdlog::get("db")),
+    slow_query_threshold_ns_(static_cast<uint64_t>(slow_query_threshold_ms) * 1000000),
     initialized_(false)
 {
     std::string target_url = database_url;
     if (target_url.empty())
     {
         target_url = DefaultDBPath;
-        BlackLibraryCommon::LogDebug("db", "Empty database url given, using default: {}", target_url);
+        DB_LOG_DEBUG("Empty database url given, using default: {}", target_url);
     }
 
     bool first_time_setup = false;
     if (!BlackLibraryCommon::PathExists(target_url))
     {
-        BlackLibraryCommon::LogDebug("db", "{} does not exist, first tiem setup enabled", target_url);
+        DB_LOG_DEBUG("{} does not exist, first tiem setup enabled", target_url);
         first_time_setup = true;
     }
 
-    int res = sqlite3_open(target_url.c_str(), &database_conn_);
+    int res = sqlite3_open(target_url.c_str(), &write_connection_.database_conn);
     
     if (res != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "Failed to open db at: {} - {}", target_url, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Failed to open db at: {} - {}", target_url, sqlite3_errmsg(write_connection_.database_conn));
         return;
     }
 
     BlackLibraryCommon::LogInfo("db", "Open database at: {}", target_url);
 
-    if (first_time_setup)
+    if (SetupWriteConnection())
     {
-        if (GenerateTables())
-        {
-            BlackLibraryCommon::LogError("db", "Failed to generate database tables");
-            return;
-        }
+        BlackLibraryCommon::LogError("db", "Failed to setup write connection");
+        return;
     }
 
-    if (PrepareStatements())
+    if (RunMigrations())
+    {
+        BlackLibraryCommon::LogError("db", "Failed to migrate database schema");
+        return;
+    }
+
+    if (PrepareStatements(write_connection_))
     {
         BlackLibraryCommon::LogError("db", "Failed to setup prepare statements");
         return;
     }
 
+    if (EnableSlowQueryLog(write_connection_))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to enable slow query log");
+        return;
+    }
+
     if (first_time_setup)
     {
         if (SetupDefaultBlackLibraryUsers())
@@ -181,29 +352,72 @@ SQLiteDB::SQLiteDB(const std::string &database_url) :
         }
     }
 
+    if (OpenReadConnections(target_url, read_pool_size))
+    {
+        BlackLibraryCommon::LogError("db", "Failed to open read connection pool");
+        return;
+    }
+
     initialized_ = true;
 }
 
 SQLiteDB::~SQLiteDB()
 {
-    if (database_conn_)
+    // close readers first so the writer can checkpoint the WAL on close
+    for (auto &read_connection : read_connections_)
     {
-        for (size_t i = 0; i < prepared_statements_.size(); ++i)
-        {
-            sqlite3_finalize(prepared_statements_[i]);
-        }
-        sqlite3_close(database_conn_);
+        CloseConnection(*read_connection);
     }
+
+    CloseConnection(write_connection_);
 }
 
 std::vector<DBEntry> SQLiteDB::ListEntries(entry_table_rep_t entry_type) const
 {
-    BlackLibraryCommon::LogDebug("db", "List {} entries", GetEntryTypeString(entry_type));
+    return ListEntries(entry_type, AllEntryColumns);
+}
+
+std::vector<DBEntry> SQLiteDB::ListEntries(entry_table_rep_t entry_type, entry_column_mask_t columns) const
+{
+    DB_LOG_DEBUG("List {} entries with columns: {:#x}", GetEntryTypeString(entry_type), columns);
 
     std::vector<DBEntry> entries;
 
+    ForEachEntry(entry_type, columns, [&entries](const DBEntry &entry)
+    {
+        entries.emplace_back(entry);
+        return true;
+    });
+
+    return entries;
+}
+
+int SQLiteDB::ForEachEntry(entry_table_rep_t entry_type, const entry_callback_t &callback) const
+{
+    return ForEachEntry(entry_type, AllEntryColumns, callback);
+}
+
+int SQLiteDB::ForEachEntry(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_callback_t &callback) const
+{
+    // one entry is reused for every row so its string buffers are only grown, not reallocated
+    DBEntry entry;
+
+    return ForEachEntryView(entry_type, columns, [&entry, &callback](const DBEntryView &view)
+    {
+        view.MaterializeInto(entry);
+        return callback(entry);
+    });
+}
+
+int SQLiteDB::ForEachEntryView(entry_table_rep_t entry_type, entry_column_mask_t columns, const entry_view_callback_t &callback) const
+{
+    DB_LOG_DEBUG("For each {} entry with columns: {:#x}", GetEntryTypeString(entry_type), columns);
+
     if (CheckInitialized())
-        return entries;
+        return -1;
+
+    // UUID is always selected, it identifies the row to the caller
+    columns = (columns & AllEntryColumns) | EntryColumnMask(DBEntryColumnID::uuid);
 
     int statement_id;
     switch (entry_type)
@@ -215,61 +429,60 @@ std::vector<DBEntry> SQLiteDB::ListEntries(entry_table_rep_t entry_type) const
             statement_id = GET_STAGING_ENTRIES_STATEMENT;
             break;
         default:
-            return entries;
+            return -1;
     }
 
-    if (BeginTransaction())
-        return entries;
+    // the read connection stays leased until the scan finishes or the callback stops it
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    if (columns != AllEntryColumns)
+        stmt = GetProjectedStatement(*lease, entry_type, columns, false);
+
+    if (!stmt)
+        return -1;
 
     LogTraceStatement(stmt);
 
-    // run statement in loop until done
-    while (sqlite3_step(stmt) == SQLITE_ROW)
+    // views point into the current row, they are rebuilt on every step without copying
+    DBEntryView view;
+
+    int ret = SQLITE_OK;
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        DBEntry entry;
+        ReadEntryViewColumns(stmt, columns, view);
 
-        entry.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-        entry.title = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
-        entry.author = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
-        entry.nickname = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
-        entry.source = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)));
-        entry.url = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5)));
-        entry.last_url = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6)));
-        entry.series = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7)));
-        entry.series_length = sqlite3_column_int(stmt, 8);
-        entry.version = sqlite3_column_int(stmt, 9);
-        entry.media_path = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10)));
-        entry.birth_date = sqlite3_column_int(stmt, 11);
-        entry.check_date = sqlite3_column_int(stmt, 12);
-        entry.update_date = sqlite3_column_int(stmt, 13);
-        entry.user_contributed = sqlite3_column_int(stmt, 14);
+        if (!callback(view))
+        {
+            ret = SQLITE_DONE;
+            break;
+        }
+    }
 
-        entries.emplace_back(entry);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "For each {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return entries;
-
-    return entries;
+    return 0;
 }
 
 std::vector<DBMd5Sum> SQLiteDB::ListChecksums() const
 {
-    BlackLibraryCommon::LogDebug("db", "List checksums");
+    DB_LOG_DEBUG("List checksums");
 
     std::vector<DBMd5Sum> checksums;
 
     if (CheckInitialized())
         return checksums;
 
-    if (BeginTransaction())
-        return checksums;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[GET_CHECKSUMS_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_CHECKSUMS_STATEMENT];
 
     LogTraceStatement(stmt);
 
@@ -278,35 +491,28 @@ std::vector<DBMd5Sum> SQLiteDB::ListChecksums() const
     {
         DBMd5Sum checksum;
 
-        checksum.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-        checksum.index_num = sqlite3_column_int(stmt, 1);
-        checksum.md5_sum = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
-        checksum.version_num = sqlite3_column_int(stmt, 3);
+        ReadSQLiteRow(stmt, checksum, Md5SumColumns);
 
         checksums.emplace_back(checksum);
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return checksums;
-
     return checksums;
 }
 
 std::vector<DBErrorEntry> SQLiteDB::ListErrorEntries() const
 {
-    BlackLibraryCommon::LogDebug("db", "List error entries");
+    DB_LOG_DEBUG("List error entries");
 
     std::vector<DBErrorEntry> entries;
 
     if (CheckInitialized())
         return entries;
 
-    if (BeginTransaction())
-        return entries;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[GET_ERROR_ENTRIES_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_ERROR_ENTRIES_STATEMENT];
 
     LogTraceStatement(stmt);
 
@@ -315,218 +521,245 @@ std::vector<DBErrorEntry> SQLiteDB::ListErrorEntries() const
     {
         DBErrorEntry entry;
 
-        entry.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-        entry.progress_num = sqlite3_column_int(stmt, 1);
+        ReadSQLiteRow(stmt, entry, ErrorEntryColumns);
 
         entries.emplace_back(entry);
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return entries;
-
     return entries;
 }
 
-int SQLiteDB::CreateUser(const DBUser &user) const
+int SQLiteDB::ListEntriesPage(entry_table_rep_t entry_type, const std::string &after_uuid, size_t limit, std::vector<DBEntry> &entries) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create user: {} with UID: {}", user.name, user.uid);
+    DB_LOG_DEBUG("List up to {} {} entries after UUID: {}", limit, GetEntryTypeString(entry_type), after_uuid);
 
-    if (BeginTransaction())
+    if (CheckInitialized())
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_USER_STATEMENT];
+    int statement_id;
+    switch (entry_type)
+    {
+        case BLACK_ENTRY:
+            statement_id = GET_BLACK_ENTRIES_PAGE_STATEMENT;
+            break;
+        case STAGING_ENTRY:
+            statement_id = GET_STAGING_ENTRIES_PAGE_STATEMENT;
+            break;
+        default:
+            return -1;
+    }
+
+    if (limit == 0)
+    {
+        entries.clear();
+        return 0;
+    }
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
 
     // bind statement variables
-    if (BindInt(stmt, "UID", user.uid))
-        return -1;
-    if (BindInt(stmt, "permission_level", static_cast<uint8_t>(user.permission_level)))
+    if (BindText(stmt, parameters[UUID_PARAMETER], after_uuid))
         return -1;
-    if (BindText(stmt, "name", user.name))
+    if (BindInt64(stmt, parameters[LIMIT_PARAMETER], limit))
         return -1;
 
-    // run statement
+    LogTraceStatement(stmt);
+
+    // after_uuid may point into the caller's previous page, keep it intact until the statement is done
+    std::vector<DBEntry> page;
+
+    // range scan over the UUID primary key starting after the last key of the previous page
     int ret = SQLITE_OK;
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        DBEntry entry;
+
+        ReadSQLiteRow(stmt, entry, EntryColumns);
+
+        page.emplace_back(std::move(entry));
+    }
 
-    ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create user: {} with UID: {} failed: {}", user.name, user.uid, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "List {} entries page failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return -1;
+    entries.swap(page);
 
     return 0;
 }
 
-int SQLiteDB::CreateMediaType(const std::string &media_type_name) const
+int SQLiteDB::ListChecksumsPage(const std::string &after_uuid, size_t after_index_num, size_t limit, std::vector<DBMd5Sum> &checksums) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create media type: {}", media_type_name);
+    DB_LOG_DEBUG("List up to {} checksums after UUID: {} index_num: {}", limit, after_uuid, after_index_num);
 
-    if (BeginTransaction())
+    if (CheckInitialized())
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_MEDIA_TYPE_STATEMENT];
+    if (limit == 0)
+    {
+        checksums.clear();
+        return 0;
+    }
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_CHECKSUMS_PAGE_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[GET_CHECKSUMS_PAGE_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "name", media_type_name))
+    if (BindText(stmt, parameters[UUID_PARAMETER], after_uuid))
+        return -1;
+    if (BindInt64(stmt, parameters[INDEX_NUM_PARAMETER], after_index_num))
+        return -1;
+    if (BindInt64(stmt, parameters[LIMIT_PARAMETER], limit))
         return -1;
 
     LogTraceStatement(stmt);
 
-    // run statement
+    // after_uuid may point into the caller's previous page, keep it intact until the statement is done
+    std::vector<DBMd5Sum> page;
+
+    // range scan over the (UUID, index_num) primary key starting after the last key of the previous page
     int ret = SQLITE_OK;
-    ret = sqlite3_step(stmt);
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        DBMd5Sum checksum;
+
+        ReadSQLiteRow(stmt, checksum, Md5SumColumns);
+
+        page.emplace_back(std::move(checksum));
+    }
+
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create media type: {} failed: {}", media_type_name, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "List checksums page failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return -1;
+    checksums.swap(page);
 
     return 0;
 }
 
-int SQLiteDB::CreateMediaSubtype(const std::string &media_subtype_name, const std::string &media_type_name) const
+int SQLiteDB::ListErrorEntriesPage(const std::string &after_uuid, size_t limit, std::vector<DBErrorEntry> &entries) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create subtype: {} media: {}", media_subtype_name, media_type_name);
+    DB_LOG_DEBUG("List up to {} error entries after UUID: {}", limit, after_uuid);
 
-    if (BeginTransaction())
+    if (CheckInitialized())
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_MEDIA_SUBTYPE_STATEMENT];
+    if (limit == 0)
+    {
+        entries.clear();
+        return 0;
+    }
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_ERROR_ENTRIES_PAGE_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[GET_ERROR_ENTRIES_PAGE_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "name", media_subtype_name))
+    if (BindText(stmt, parameters[UUID_PARAMETER], after_uuid))
         return -1;
-    if (BindText(stmt, "media_type_name", media_type_name))
+    if (BindInt64(stmt, parameters[LIMIT_PARAMETER], limit))
         return -1;
 
     LogTraceStatement(stmt);
 
-    // run statement
+    // after_uuid may point into the caller's previous page, keep it intact until the statement is done
+    std::vector<DBErrorEntry> page;
+
+    // range scan over the UUID primary key starting after the last key of the previous page
     int ret = SQLITE_OK;
-    ret = sqlite3_step(stmt);
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        DBErrorEntry entry;
+
+        ReadSQLiteRow(stmt, entry, ErrorEntryColumns);
+
+        page.emplace_back(std::move(entry));
+    }
+
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create subtype: {} - media: {} failed: {}", media_subtype_name, media_type_name, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "List error entries page failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return -1;
+    entries.swap(page);
 
     return 0;
 }
 
-int SQLiteDB::CreateSource(const DBSource &source) const
+int SQLiteDB::CreateUser(const DBUser &user) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create source: {}", source.name);
+    DB_LOG_DEBUG("Create user: {} with UID: {}", user.name, user.uid);
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_SOURCE_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_USER_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[CREATE_USER_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "name", source.name))
+    if (BindInt(stmt, parameters[UID_PARAMETER], user.uid))
         return -1;
-    if (BindText(stmt, "media_type", GetMediaTypeString(source.media_type)))
+    if (BindInt(stmt, parameters[PERMISSION_LEVEL_PARAMETER], static_cast<uint8_t>(user.permission_level)))
         return -1;
-    if (BindText(stmt, "media_subtype", GetMediaSubtypeString(source.subtype)))
+    if (BindText(stmt, parameters[NAME_PARAMETER], user.name))
         return -1;
 
-    LogTraceStatement(stmt);
-
     // run statement
     int ret = SQLITE_OK;
+
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create source: {} failed: {}", source.name, sqlite3_errmsg(database_conn_));
-        ResetStatement(stmt);
-        EndTransaction();
+        BlackLibraryCommon::LogError("db", "Create user: {} with UID: {} failed: {}", user.name, user.uid, sqlite3_errmsg(lease->database_conn));
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
 }
 
-int SQLiteDB::CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const
+int SQLiteDB::CreateMediaType(const std::string &media_type_name) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create {} entry with UUID: {}", GetEntryTypeString(entry_type), entry.uuid);
-
-    if (CheckInitialized())
-        return -1;
+    DB_LOG_DEBUG("Create media type: {}", media_type_name);
 
-    int statement_id;
-    switch (entry_type)
-    {
-        case BLACK_ENTRY:
-            statement_id = CREATE_BLACK_ENTRY_STATEMENT;
-            break;
-        case STAGING_ENTRY:
-            statement_id = CREATE_STAGING_ENTRY_STATEMENT;
-            break;
-        default:
-            return -1;
-    }
+    const WriteConnectionLease lease(*this);
 
-    if (BeginTransaction())
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_MEDIA_TYPE_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[CREATE_MEDIA_TYPE_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", entry.uuid))
-        return -1;
-    if (BindText(stmt, "title", entry.title))
-        return -1;
-    if (BindText(stmt, "author", entry.author))
-        return -1;
-    if (BindText(stmt, "nickname", entry.nickname))
-        return -1;
-    if (BindText(stmt, "source", entry.source))
-        return -1;
-    if (BindText(stmt, "url", entry.url))
-        return -1;
-    if (BindText(stmt, "last_url", entry.last_url))
-        return -1;
-    if (BindText(stmt, "series", entry.series))
-        return -1;
-    if (BindInt(stmt, "series_length", entry.series_length))
-        return -1;
-    if (BindInt(stmt, "version", entry.version))
-        return -1;
-    if (BindText(stmt, "media_path", entry.media_path))
-        return -1;
-    if (BindInt(stmt, "birth_date", entry.birth_date))
-        return -1;
-    if (BindInt(stmt, "check_date", entry.check_date))
-        return -1;
-    if (BindInt(stmt, "update_date", entry.update_date))
-        return -1;
-    if (BindInt(stmt, "user_contributed", entry.user_contributed))
+    if (BindText(stmt, parameters[NAME_PARAMETER], media_type_name))
         return -1;
 
     LogTraceStatement(stmt);
@@ -536,143 +769,295 @@ int SQLiteDB::CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) co
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Create media type: {} failed: {}", media_type_name, sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
 }
 
-DBEntry SQLiteDB::ReadEntry(const std::string &uuid, entry_table_rep_t entry_type) const
+int SQLiteDB::CreateMediaSubtype(const std::string &media_subtype_name, const std::string &media_type_name) const
 {
-    BlackLibraryCommon::LogDebug("db", "Read {} entry with UUID: {}", GetEntryTypeString(entry_type), uuid);
-
-    DBEntry entry;
+    DB_LOG_DEBUG("Create subtype: {} media: {}", media_subtype_name, media_type_name);
 
-    if (CheckInitialized())
-        return entry;
-
-    int statement_id;
-    switch (entry_type)
-    {
-        case BLACK_ENTRY:
-            statement_id = READ_BLACK_ENTRY_STATEMENT;
-            break;
-        case STAGING_ENTRY:
-            statement_id = READ_STAGING_ENTRY_STATEMENT;
-            break;
-        default:
-            return entry;
-    }
+    const WriteConnectionLease lease(*this);
 
-    if (BeginTransaction())
-        return entry;
+    if (BeginTransaction(*lease))
+        return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_MEDIA_SUBTYPE_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[CREATE_MEDIA_SUBTYPE_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
-        return entry;
+    if (BindText(stmt, parameters[NAME_PARAMETER], media_subtype_name))
+        return -1;
+    if (BindText(stmt, parameters[MEDIA_TYPE_NAME_PARAMETER], media_type_name))
+        return -1;
 
     LogTraceStatement(stmt);
 
     // run statement
     int ret = SQLITE_OK;
     ret = sqlite3_step(stmt);
-    if (ret != SQLITE_ROW)
+    if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Read {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Create subtype: {} - media: {} failed: {}", media_subtype_name, media_type_name, sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
-        return entry;
+        RollbackTransaction(*lease);
+        return -1;
     }
 
-    entry.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-    entry.title = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
-    entry.author = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
-    entry.nickname = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
-    entry.source = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)));
-    entry.url = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5)));
-    entry.last_url = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6)));
-    entry.series = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7)));
-    entry.series_length = sqlite3_column_int(stmt, 8);
-    entry.version = sqlite3_column_int(stmt, 9);
-    entry.media_path = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10)));
-    entry.birth_date = sqlite3_column_int(stmt, 11);
-    entry.check_date = sqlite3_column_int(stmt, 12);
-    entry.update_date = sqlite3_column_int(stmt, 13);
-    entry.user_contributed = sqlite3_column_int(stmt, 14);
-
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return entry;
+    if (EndTransaction(*lease))
+        return -1;
 
-    return entry;
+    return 0;
 }
 
-int SQLiteDB::UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const
+int SQLiteDB::CreateSource(const DBSource &source) const
 {
-    BlackLibraryCommon::LogDebug("db", "Update {} entry with UUID: {}", GetEntryTypeString(entry_type), entry.uuid);
+    DB_LOG_DEBUG("Create source: {}", source.name);
 
-    if (CheckInitialized())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    int statement_id;
-    switch (entry_type)
-    {
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_SOURCE_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[CREATE_SOURCE_STATEMENT];
+
+    // bind statement variables
+    if (BindText(stmt, parameters[NAME_PARAMETER], source.name))
+        return -1;
+    if (BindText(stmt, parameters[MEDIA_TYPE_PARAMETER], GetMediaTypeString(source.media_type)))
+        return -1;
+    if (BindText(stmt, parameters[MEDIA_SUBTYPE_PARAMETER], GetMediaSubtypeString(source.subtype)))
+        return -1;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Create source: {} failed: {}", source.name, sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        RollbackTransaction(*lease);
+        return -1;
+    }
+
+    ResetStatement(stmt);
+
+    if (EndTransaction(*lease))
+        return -1;
+
+    return 0;
+}
+
+std::vector<int> SQLiteDB::CreateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const
+{
+    DB_LOG_DEBUG("Create {} {} entries", entries.size(), GetEntryTypeString(entry_type));
+
+    std::vector<int> results(entries.size(), -1);
+
+    if (CheckInitialized())
+        return results;
+
+    int statement_id;
+    switch (entry_type)
+    {
         case BLACK_ENTRY:
-            statement_id = UPDATE_BLACK_ENTRY_STATEMENT;
+            statement_id = CREATE_BLACK_ENTRY_STATEMENT;
             break;
         case STAGING_ENTRY:
-            statement_id = UPDATE_STAGING_ENTRY_STATEMENT;
+            statement_id = CREATE_STAGING_ENTRY_STATEMENT;
+            break;
+        default:
+            return results;
+    }
+
+    return StepEntries(entries, statement_id);
+}
+
+int SQLiteDB::CreateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const
+{
+    DB_LOG_DEBUG("Create {} entry with UUID: {}", GetEntryTypeString(entry_type), entry.uuid);
+
+    if (CheckInitialized())
+        return -1;
+
+    int statement_id;
+    switch (entry_type)
+    {
+        case BLACK_ENTRY:
+            statement_id = CREATE_BLACK_ENTRY_STATEMENT;
+            break;
+        case STAGING_ENTRY:
+            statement_id = CREATE_STAGING_ENTRY_STATEMENT;
             break;
         default:
             return -1;
     }
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", entry.uuid))
-        return -1;
-    if (BindText(stmt, "title", entry.title))
-        return -1;
-    if (BindText(stmt, "author", entry.author))
-        return -1;
-    if (BindText(stmt, "nickname", entry.nickname))
-        return -1;
-    if (BindText(stmt, "source", entry.source))
-        return -1;
-    if (BindText(stmt, "url", entry.url))
-        return -1;
-    if (BindText(stmt, "last_url", entry.last_url))
-        return -1;
-    if (BindText(stmt, "series", entry.series))
+    if (BindRow(stmt, entry, EntryColumns))
         return -1;
-    if (BindInt(stmt, "series_length", entry.series_length))
-        return -1;
-    if (BindInt(stmt, "version", entry.version))
-        return -1;
-    if (BindText(stmt, "media_path", entry.media_path))
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Create {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        RollbackTransaction(*lease);
         return -1;
-    if (BindInt(stmt, "birth_date", entry.birth_date))
+    }
+
+    ResetStatement(stmt);
+
+    if (EndTransaction(*lease))
         return -1;
-    if (BindInt(stmt, "check_date", entry.check_date))
+
+    return 0;
+}
+
+DBEntry SQLiteDB::ReadEntry(const std::string &uuid, entry_table_rep_t entry_type) const
+{
+    return ReadEntry(uuid, entry_type, AllEntryColumns);
+}
+
+DBEntry SQLiteDB::ReadEntry(const std::string &uuid, entry_table_rep_t entry_type, entry_column_mask_t columns) const
+{
+    DB_LOG_DEBUG("Read {} entry with UUID: {} columns: {:#x}", GetEntryTypeString(entry_type), uuid, columns);
+
+    DBEntry entry;
+
+    if (CheckInitialized())
+        return entry;
+
+    // UUID is always selected, an empty UUID marks a missing entry
+    columns = (columns & AllEntryColumns) | EntryColumnMask(DBEntryColumnID::uuid);
+
+    int statement_id;
+    switch (entry_type)
+    {
+        case BLACK_ENTRY:
+            statement_id = READ_BLACK_ENTRY_STATEMENT;
+            break;
+        case STAGING_ENTRY:
+            statement_id = READ_STAGING_ENTRY_STATEMENT;
+            break;
+        default:
+            return entry;
+    }
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    if (columns != AllEntryColumns)
+        stmt = GetProjectedStatement(*lease, entry_type, columns, true);
+
+    if (!stmt)
+        return entry;
+
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
+
+    // bind statement variables
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return entry;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_ROW)
+    {
+        BlackLibraryCommon::LogError("db", "Read {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        return entry;
+    }
+
+    ReadEntryColumns(stmt, columns, entry);
+
+    ResetStatement(stmt);
+
+    return entry;
+}
+
+std::vector<int> SQLiteDB::UpdateEntries(const std::vector<DBEntry> &entries, entry_table_rep_t entry_type) const
+{
+    DB_LOG_DEBUG("Update {} {} entries", entries.size(), GetEntryTypeString(entry_type));
+
+    std::vector<int> results(entries.size(), -1);
+
+    if (CheckInitialized())
+        return results;
+
+    int statement_id;
+    switch (entry_type)
+    {
+        case BLACK_ENTRY:
+            statement_id = UPDATE_BLACK_ENTRY_STATEMENT;
+            break;
+        case STAGING_ENTRY:
+            statement_id = UPDATE_STAGING_ENTRY_STATEMENT;
+            break;
+        default:
+            return results;
+    }
+
+    return StepEntries(entries, statement_id);
+}
+
+int SQLiteDB::UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) const
+{
+    DB_LOG_DEBUG("Update {} entry with UUID: {}", GetEntryTypeString(entry_type), entry.uuid);
+
+    if (CheckInitialized())
         return -1;
-    if (BindInt(stmt, "update_date", entry.update_date))
+
+    int statement_id;
+    switch (entry_type)
+    {
+        case BLACK_ENTRY:
+            statement_id = UPDATE_BLACK_ENTRY_STATEMENT;
+            break;
+        case STAGING_ENTRY:
+            statement_id = UPDATE_STAGING_ENTRY_STATEMENT;
+            break;
+        default:
+            return -1;
+    }
+
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
-    if (BindInt(stmt, "user_contributed", entry.user_contributed))
+
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+
+    // bind statement variables
+    if (BindRow(stmt, entry, EntryColumns))
         return -1;
 
     LogTraceStatement(stmt);
@@ -682,15 +1067,15 @@ int SQLiteDB::UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) co
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Update {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Update {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
@@ -698,7 +1083,7 @@ int SQLiteDB::UpdateEntry(const DBEntry &entry, entry_table_rep_t entry_type) co
 
 int SQLiteDB::DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type) const
 {
-    BlackLibraryCommon::LogDebug("db", "Delete {} entry with UUID: {}", GetEntryTypeString(entry_type), uuid);
+    DB_LOG_DEBUG("Delete {} entry with UUID: {}", GetEntryTypeString(entry_type), uuid);
 
     if (CheckInitialized())
         return -1;
@@ -716,13 +1101,16 @@ int SQLiteDB::DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type)
             return -1;
     }
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
         return -1;
 
     LogTraceStatement(stmt);
@@ -732,15 +1120,15 @@ int SQLiteDB::DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type)
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Delete {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Delete {} entry failed: {}", GetEntryTypeString(entry_type), sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
@@ -748,24 +1136,20 @@ int SQLiteDB::DeleteEntry(const std::string &uuid, entry_table_rep_t entry_type)
 
 int SQLiteDB::CreateMd5Sum(const DBMd5Sum &md5) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create MD5 checksum with UUID: {} index_num: {} sum: {}", md5.uuid, md5.index_num, md5.md5_sum);
+    DB_LOG_DEBUG("Create MD5 checksum with UUID: {} index_num: {} sum: {}", md5.uuid, md5.index_num, md5.md5_sum);
 
     if (CheckInitialized())
         return -1;
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_MD5_SUM_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_MD5_SUM_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", md5.uuid))
-        return -1;
-    if (BindInt(stmt, "index_num", md5.index_num))
-        return -1;
-    if (BindText(stmt, "md5_sum", md5.md5_sum))
-        return -1;
-    if (BindInt(stmt, "version_num", md5.version_num))
+    if (BindRow(stmt, md5, Md5SumColumns))
         return -1;
 
     LogTraceStatement(stmt);
@@ -775,15 +1159,15 @@ int SQLiteDB::CreateMd5Sum(const DBMd5Sum &md5) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Create MD5 checksum failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
@@ -791,22 +1175,22 @@ int SQLiteDB::CreateMd5Sum(const DBMd5Sum &md5) const
 
 DBMd5Sum SQLiteDB::ReadMd5Sum(const std::string &uuid, size_t index_num) const
 {
-    BlackLibraryCommon::LogDebug("db", "Read MD5 checksum with UUID: {} index_num: {}", uuid, index_num);
+    DB_LOG_DEBUG("Read MD5 checksum with UUID: {} index_num: {}", uuid, index_num);
 
     DBMd5Sum md5;
 
     if (CheckInitialized())
         return md5;
 
-    if (BeginTransaction())
-        return md5;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[READ_MD5_SUM_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[READ_MD5_SUM_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[READ_MD5_SUM_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
         return md5;
-    if (BindInt(stmt, "index_num", index_num))
+    if (BindInt64(stmt, parameters[INDEX_NUM_PARAMETER], index_num))
         return md5;
 
     LogTraceStatement(stmt);
@@ -816,45 +1200,34 @@ DBMd5Sum SQLiteDB::ReadMd5Sum(const std::string &uuid, size_t index_num) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
         return md5;
     }
 
-    md5.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-    md5.index_num = sqlite3_column_int(stmt, 1);
-    md5.md5_sum = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
-    md5.version_num = sqlite3_column_int(stmt, 3);
+    ReadSQLiteRow(stmt, md5, Md5SumColumns);
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return md5;
-
     return md5;
 }
 
 int SQLiteDB::UpdateMd5Sum(const DBMd5Sum &md5) const
 {
-    BlackLibraryCommon::LogDebug("db", "Update MD5 checksum with UUID: {} index_num: {} sum: {}", md5.uuid, md5.index_num, md5.md5_sum);
+    DB_LOG_DEBUG("Update MD5 checksum with UUID: {} index_num: {} sum: {}", md5.uuid, md5.index_num, md5.md5_sum);
 
     if (CheckInitialized())
         return -1;
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[UPDATE_MD5_SUM_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[UPDATE_MD5_SUM_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", md5.uuid))
-        return -1;
-    if (BindInt(stmt, "index_num", md5.index_num))
-        return -1;
-    if (BindText(stmt, "md5_sum", md5.md5_sum))
-        return -1;
-    if (BindInt(stmt, "version_num", md5.version_num))
+    if (BindRow(stmt, md5, Md5SumColumns))
         return -1;
 
     LogTraceStatement(stmt);
@@ -864,15 +1237,70 @@ int SQLiteDB::UpdateMd5Sum(const DBMd5Sum &md5) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Update MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Update MD5 checksum failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
+        return -1;
+
+    return 0;
+}
+
+int SQLiteDB::UpsertMd5Sums(const std::string &uuid, const std::vector<DBMd5Sum> &md5s) const
+{
+    DB_LOG_DEBUG("Upsert {} MD5 checksums with UUID: {}", md5s.size(), uuid);
+
+    if (CheckInitialized())
+        return -1;
+
+    if (md5s.empty())
+        return 0;
+
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
+        return -1;
+
+    sqlite3_stmt *stmt = lease->prepared_statements[UPSERT_MD5_SUM_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[UPSERT_MD5_SUM_STATEMENT];
+
+    // UUID is shared by every row, reset keeps it bound between steps
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return -1;
+
+    for (const auto &md5 : md5s)
+    {
+        // bind statement variables
+        if (BindInt64(stmt, parameters[INDEX_NUM_PARAMETER], md5.index_num))
+            return -1;
+        if (BindText(stmt, parameters[MD5_SUM_PARAMETER], md5.md5_sum))
+            return -1;
+        if (BindInt64(stmt, parameters[VERSION_NUM_PARAMETER], md5.version_num))
+            return -1;
+
+        LogTraceStatement(stmt);
+
+        // run statement
+        int ret = SQLITE_OK;
+        ret = sqlite3_step(stmt);
+        if (ret != SQLITE_DONE)
+        {
+            // all of the entry's checksums are stored or none are
+            BlackLibraryCommon::LogError("db", "Upsert MD5 checksum index_num: {} failed: {}", md5.index_num, sqlite3_errmsg(lease->database_conn));
+            ResetStatement(stmt);
+            RollbackTransaction(*lease);
+            return -1;
+        }
+
+        ResetStatement(stmt);
+    }
+
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
@@ -880,20 +1308,23 @@ int SQLiteDB::UpdateMd5Sum(const DBMd5Sum &md5) const
 
 int SQLiteDB::DeleteMd5Sum(const std::string &uuid, size_t index_num) const
 {
-    BlackLibraryCommon::LogDebug("db", "Delete MD5 checksum with UUID: {} index_num: {}", uuid, index_num);
+    DB_LOG_DEBUG("Delete MD5 checksum with UUID: {} index_num: {}", uuid, index_num);
 
     if (CheckInitialized())
         return -1;
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[DELETE_MD5_SUM_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[DELETE_MD5_SUM_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[DELETE_MD5_SUM_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
         return -1;
-    if (BindInt(stmt, "index_num", index_num))
+    if (BindInt64(stmt, parameters[INDEX_NUM_PARAMETER], index_num))
         return -1;
 
     LogTraceStatement(stmt);
@@ -903,15 +1334,15 @@ int SQLiteDB::DeleteMd5Sum(const std::string &uuid, size_t index_num) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Delete MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Delete MD5 checksum failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
@@ -919,20 +1350,20 @@ int SQLiteDB::DeleteMd5Sum(const std::string &uuid, size_t index_num) const
 
 int SQLiteDB::CreateRefresh(const DBRefresh &refresh) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create refresh with UUID: {} refresh_date: {}", refresh.uuid, refresh.refresh_date);
+    DB_LOG_DEBUG("Create refresh with UUID: {} refresh_date: {}", refresh.uuid, refresh.refresh_date);
 
     if (CheckInitialized())
         return -1;
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_REFRESH_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_REFRESH_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", refresh.uuid))
-        return -1;
-    if (BindInt(stmt, "refresh_date", refresh.refresh_date))
+    if (BindRow(stmt, refresh, RefreshColumns))
         return -1;
 
     LogTraceStatement(stmt);
@@ -942,15 +1373,15 @@ int SQLiteDB::CreateRefresh(const DBRefresh &refresh) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Create refresh checksum failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Create refresh checksum failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
     
     return 0;
@@ -958,20 +1389,20 @@ int SQLiteDB::CreateRefresh(const DBRefresh &refresh) const
 
 DBRefresh SQLiteDB::ReadRefresh(const std::string &uuid) const
 {
-    BlackLibraryCommon::LogDebug("db", "Read refresh with UUID: {}", uuid);
+    DB_LOG_DEBUG("Read refresh with UUID: {}", uuid);
 
     DBRefresh refresh;
 
     if (CheckInitialized())
         return refresh;
 
-    if (BeginTransaction())
-        return refresh;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[READ_REFRESH_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[READ_REFRESH_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[READ_REFRESH_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
         return refresh;
 
     LogTraceStatement(stmt);
@@ -981,37 +1412,35 @@ DBRefresh SQLiteDB::ReadRefresh(const std::string &uuid) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
         return refresh;
     }
 
-    refresh.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-    refresh.refresh_date = sqlite3_column_int(stmt, 1);
+    ReadSQLiteRow(stmt, refresh, RefreshColumns);
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return refresh;
-
     return refresh;
 }
 
 int SQLiteDB::DeleteRefresh(const std::string &uuid) const
 {
-    BlackLibraryCommon::LogDebug("db", "Delete refresh with UUID: {}", uuid);
+    DB_LOG_DEBUG("Delete refresh with UUID: {}", uuid);
 
     if (CheckInitialized())
         return -1;
 
-    if (BeginTransaction())
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[DELETE_REFRESH_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[DELETE_REFRESH_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[DELETE_REFRESH_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
         return -1;
 
     LogTraceStatement(stmt);
@@ -1021,93 +1450,302 @@ int SQLiteDB::DeleteRefresh(const std::string &uuid) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Delete refresh failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Delete refresh failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
 }
 
-int SQLiteDB::CreateErrorEntry(const DBErrorEntry &entry) const
+int SQLiteDB::ClaimRefreshes(const std::string &worker_id, time_t lease_seconds, size_t limit, std::vector<DBRefresh> &refreshes) const
 {
-    BlackLibraryCommon::LogDebug("db", "Create error entry for UUID: {}", entry.uuid);
+    DB_LOG_DEBUG("Claim up to {} refreshes for worker: {} lease_seconds: {}", limit, worker_id, lease_seconds);
 
-    if (CheckInitialized())
-        return -1;
-
-    if (BeginTransaction())
-        return -1;
+    refreshes.clear();
 
-    sqlite3_stmt *stmt = prepared_statements_[CREATE_ERROR_ENTRY_STATEMENT];
-
-    // bind statement variables
-    if (BindText(stmt, "UUID", entry.uuid))
-        return -1;
-    if (BindInt(stmt, "progress_num", entry.progress_num))
+    if (CheckInitialized())
         return -1;
 
-    LogTraceStatement(stmt);
+    if (limit == 0)
+        return 0;
 
-    // run statement
-    int ret = SQLITE_OK;
-    ret = sqlite3_step(stmt);
-    if (ret != SQLITE_DONE)
+    // a lease that is already expired can be claimed again straight away
+    if (lease_seconds <= 0)
     {
-        BlackLibraryCommon::LogError("db", "Create error entry for UUID: {} failed: {}", entry.uuid, sqlite3_errmsg(database_conn_));
-        ResetStatement(stmt);
-        EndTransaction();
+        BlackLibraryCommon::LogError("db", "Claim refreshes for worker: {} with non positive lease_seconds: {}", worker_id, lease_seconds);
         return -1;
     }
 
-    ResetStatement(stmt);
-
-    if (EndTransaction())
-        return -1;
-
-    return 0;
-}
+    const time_t now = std::time(nullptr);
+    // saturates so a lease that outlives time_t stays held instead of wrapping into the past
+    const time_t lease_expires = lease_seconds > std::numeric_limits<time_t>::max() - now ? std::numeric_limits<time_t>::max() : now + lease_seconds;
 
-int SQLiteDB::DeleteErrorEntry(const std::string &uuid, size_t progress_num) const
-{
-    BlackLibraryCommon::LogDebug("db", "Delete error entry for UUID: {} and progress number: {}", uuid, progress_num);
-
-    if (CheckInitialized())
-        return -1;
+    const WriteConnectionLease lease(*this);
 
-    if (BeginTransaction())
+    // candidates and lease updates share one transaction so no other claim can interleave
+    if (BeginTransaction(*lease))
         return -1;
 
-    sqlite3_stmt *stmt = prepared_statements_[DELETE_ERROR_ENTRY_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_CLAIMABLE_REFRESHES_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[GET_CLAIMABLE_REFRESHES_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindInt64(stmt, parameters[NOW_PARAMETER], now))
         return -1;
-    if (BindInt(stmt, "progress_num", progress_num))
+    if (BindInt64(stmt, parameters[LIMIT_PARAMETER], limit))
         return -1;
 
     LogTraceStatement(stmt);
 
-    // run statement
+    // due rows that are unleased or whose lease has expired, earliest first
+    std::vector<DBRefresh> candidates;
     int ret = SQLITE_OK;
-    ret = sqlite3_step(stmt);
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        DBRefresh refresh;
+
+        ReadSQLiteRow(stmt, refresh, RefreshColumns);
+
+        candidates.emplace_back(refresh);
+    }
+
     if (ret != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Delete error entry for UUID: {} and progress number: {} failed: {}", uuid, progress_num, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Get claimable refreshes failed: {}", sqlite3_errmsg(lease->database_conn));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(*lease);
         return -1;
     }
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    stmt = lease->prepared_statements[CLAIM_REFRESH_STATEMENT];
+    const sqlite_parameter_indices_t &claim_parameters = lease->parameter_indices[CLAIM_REFRESH_STATEMENT];
+
+    for (auto &candidate : candidates)
+    {
+        // bind statement variables
+        if (BindText(stmt, claim_parameters[UUID_PARAMETER], candidate.uuid) ||
+            BindText(stmt, claim_parameters[LEASE_OWNER_PARAMETER], worker_id) ||
+            BindInt64(stmt, claim_parameters[LEASE_EXPIRES_PARAMETER], lease_expires) ||
+            BindInt64(stmt, claim_parameters[NOW_PARAMETER], now))
+        {
+            ResetStatement(stmt);
+            RollbackTransaction(*lease);
+            return -1;
+        }
+
+        LogTraceStatement(stmt);
+
+        // run statement
+        ret = sqlite3_step(stmt);
+        if (ret != SQLITE_DONE)
+        {
+            BlackLibraryCommon::LogError("db", "Claim refresh with UUID: {} failed: {}", candidate.uuid, sqlite3_errmsg(lease->database_conn));
+            ResetStatement(stmt);
+            RollbackTransaction(*lease);
+            return -1;
+        }
+
+        // the lease guard in the update skips rows another process claimed first
+        if (sqlite3_changes(lease->database_conn) == 1)
+            refreshes.emplace_back(std::move(candidate));
+
+        ResetStatement(stmt);
+    }
+
+    if (EndTransaction(*lease))
+    {
+        refreshes.clear();
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::CompleteRefresh(const std::string &uuid, const std::string &worker_id) const
+{
+    DB_LOG_DEBUG("Complete refresh with UUID: {} worker: {}", uuid, worker_id);
+
+    if (CheckInitialized())
+        return -1;
+
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
+        return -1;
+
+    sqlite3_stmt *stmt = lease->prepared_statements[COMPLETE_REFRESH_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[COMPLETE_REFRESH_STATEMENT];
+
+    // bind statement variables
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return -1;
+    if (BindText(stmt, parameters[LEASE_OWNER_PARAMETER], worker_id))
+        return -1;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Complete refresh failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        RollbackTransaction(*lease);
+        return -1;
+    }
+
+    const int changes = sqlite3_changes(lease->database_conn);
+
+    ResetStatement(stmt);
+
+    if (EndTransaction(*lease))
+        return -1;
+
+    if (changes != 1)
+    {
+        BlackLibraryCommon::LogError("db", "Complete refresh with UUID: {} failed, worker: {} does not hold its lease", uuid, worker_id);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::ReleaseRefresh(const std::string &uuid, const std::string &worker_id) const
+{
+    DB_LOG_DEBUG("Release refresh with UUID: {} worker: {}", uuid, worker_id);
+
+    if (CheckInitialized())
+        return -1;
+
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
+        return -1;
+
+    sqlite3_stmt *stmt = lease->prepared_statements[RELEASE_REFRESH_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[RELEASE_REFRESH_STATEMENT];
+
+    // bind statement variables
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return -1;
+    if (BindText(stmt, parameters[LEASE_OWNER_PARAMETER], worker_id))
+        return -1;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Release refresh failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        RollbackTransaction(*lease);
+        return -1;
+    }
+
+    const int changes = sqlite3_changes(lease->database_conn);
+
+    ResetStatement(stmt);
+
+    if (EndTransaction(*lease))
+        return -1;
+
+    if (changes != 1)
+    {
+        BlackLibraryCommon::LogError("db", "Release refresh with UUID: {} failed, worker: {} does not hold its lease", uuid, worker_id);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::CreateErrorEntry(const DBErrorEntry &entry) const
+{
+    DB_LOG_DEBUG("Create error entry for UUID: {}", entry.uuid);
+
+    if (CheckInitialized())
+        return -1;
+
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
+        return -1;
+
+    sqlite3_stmt *stmt = lease->prepared_statements[CREATE_ERROR_ENTRY_STATEMENT];
+
+    // bind statement variables
+    if (BindRow(stmt, entry, ErrorEntryColumns))
+        return -1;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Create error entry for UUID: {} failed: {}", entry.uuid, sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        RollbackTransaction(*lease);
+        return -1;
+    }
+
+    ResetStatement(stmt);
+
+    if (EndTransaction(*lease))
+        return -1;
+
+    return 0;
+}
+
+int SQLiteDB::DeleteErrorEntry(const std::string &uuid, size_t progress_num) const
+{
+    DB_LOG_DEBUG("Delete error entry for UUID: {} and progress number: {}", uuid, progress_num);
+
+    if (CheckInitialized())
+        return -1;
+
+    const WriteConnectionLease lease(*this);
+
+    if (BeginTransaction(*lease))
+        return -1;
+
+    sqlite3_stmt *stmt = lease->prepared_statements[DELETE_ERROR_ENTRY_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[DELETE_ERROR_ENTRY_STATEMENT];
+
+    // bind statement variables
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return -1;
+    if (BindInt64(stmt, parameters[PROGRESS_NUM_PARAMETER], progress_num))
+        return -1;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Delete error entry for UUID: {} and progress number: {} failed: {}", uuid, progress_num, sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        RollbackTransaction(*lease);
+        return -1;
+    }
+
+    ResetStatement(stmt);
+
+    if (EndTransaction(*lease))
         return -1;
 
     return 0;
@@ -1115,13 +1753,13 @@ int SQLiteDB::DeleteErrorEntry(const std::string &uuid, size_t progress_num) con
 
 DBBoolResult SQLiteDB::DoesEntryUrlExist(const std::string &url, entry_table_rep_t entry_type) const
 {
-    BlackLibraryCommon::LogDebug("db", "Check {} entries for url: {}", GetEntryTypeString(entry_type), url);
+    DB_LOG_DEBUG("Check {} entries for url: {}", GetEntryTypeString(entry_type), url);
 
     DBBoolResult check;
 
     if (CheckInitialized())
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(write_connection_.database_conn);
         return check;
     }
 
@@ -1138,18 +1776,15 @@ DBBoolResult SQLiteDB::DoesEntryUrlExist(const std::string &url, entry_table_rep
             return check;
     }
 
-    if (BeginTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
 
     // bind statement variables
-    if (BindText(stmt, "url", url))
+    if (BindText(stmt, parameters[URL_PARAMETER], url))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
 
@@ -1160,10 +1795,9 @@ DBBoolResult SQLiteDB::DoesEntryUrlExist(const std::string &url, entry_table_rep
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "Entry {} url: {} does not exist", GetEntryTypeString(entry_type), url);
+        DB_LOG_DEBUG("Entry {} url: {} does not exist", GetEntryTypeString(entry_type), url);
         check.result = false;
         ResetStatement(stmt);
-        EndTransaction();
         return check;
     }
     else
@@ -1174,18 +1808,12 @@ DBBoolResult SQLiteDB::DoesEntryUrlExist(const std::string &url, entry_table_rep
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
-
     return check;
 }
 
 DBBoolResult SQLiteDB::DoesEntryUUIDExist(const std::string &uuid, entry_table_rep_t entry_type) const
 {
-    BlackLibraryCommon::LogDebug("db", "Check {} entries for UUID: {}", GetEntryTypeString(entry_type), uuid);
+    DB_LOG_DEBUG("Check {} entries for UUID: {}", GetEntryTypeString(entry_type), uuid);
 
     DBBoolResult check;
 
@@ -1197,7 +1825,7 @@ DBBoolResult SQLiteDB::DoesEntryUUIDExist(const std::string &uuid, entry_table_r
 
     if (CheckInitialized())
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(write_connection_.database_conn);
         return check;
     }
 
@@ -1214,18 +1842,15 @@ DBBoolResult SQLiteDB::DoesEntryUUIDExist(const std::string &uuid, entry_table_r
             return check;
     }
 
-    if (BeginTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
 
@@ -1236,10 +1861,9 @@ DBBoolResult SQLiteDB::DoesEntryUUIDExist(const std::string &uuid, entry_table_r
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "Entry {} UUID: {} does not exist",  GetEntryTypeString(entry_type), uuid);
+        DB_LOG_DEBUG("Entry {} UUID: {} does not exist",  GetEntryTypeString(entry_type), uuid);
         check.result = false;
         ResetStatement(stmt);
-        EndTransaction();
         return check;
     }
     else
@@ -1250,18 +1874,12 @@ DBBoolResult SQLiteDB::DoesEntryUUIDExist(const std::string &uuid, entry_table_r
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
-
     return check;
 }
 
 DBBoolResult SQLiteDB::DoesMd5SumExist(const std::string &uuid, size_t index_num) const
 {
-    BlackLibraryCommon::LogDebug("db", "Check MD5 checksum for UUID: {}, index_num: {}", uuid, index_num);
+    DB_LOG_DEBUG("Check MD5 checksum for UUID: {}, index_num: {}", uuid, index_num);
 
     DBBoolResult check;
 
@@ -1273,27 +1891,24 @@ DBBoolResult SQLiteDB::DoesMd5SumExist(const std::string &uuid, size_t index_num
 
     if (CheckInitialized())
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(write_connection_.database_conn);
         return check;
     }
 
-    if (BeginTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[READ_MD5_SUM_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[READ_MD5_SUM_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[READ_MD5_SUM_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
-    if (BindInt(stmt, "index_num", index_num))
+    if (BindInt64(stmt, parameters[INDEX_NUM_PARAMETER], index_num))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
 
@@ -1304,10 +1919,9 @@ DBBoolResult SQLiteDB::DoesMd5SumExist(const std::string &uuid, size_t index_num
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "MD5 checksum UUID: {} index_num: {} does not exist", uuid, index_num);
+        DB_LOG_DEBUG("MD5 checksum UUID: {} index_num: {} does not exist", uuid, index_num);
         check.result = false;
         ResetStatement(stmt);
-        EndTransaction();
         return check;
     }
     else
@@ -1317,18 +1931,12 @@ DBBoolResult SQLiteDB::DoesMd5SumExist(const std::string &uuid, size_t index_num
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
-
     return check;
 }
 
 DBBoolResult SQLiteDB::DoesRefreshExist(const std::string &uuid) const
 {
-    BlackLibraryCommon::LogDebug("db", "Check refresh for UUID: {}", uuid);
+    DB_LOG_DEBUG("Check refresh for UUID: {}", uuid);
 
     DBBoolResult check;
 
@@ -1340,22 +1948,19 @@ DBBoolResult SQLiteDB::DoesRefreshExist(const std::string &uuid) const
 
     if (CheckInitialized())
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(write_connection_.database_conn);
         return check;
     }
 
-    if (BeginTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[READ_REFRESH_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[READ_REFRESH_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[READ_REFRESH_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
 
@@ -1366,10 +1971,9 @@ DBBoolResult SQLiteDB::DoesRefreshExist(const std::string &uuid) const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "refresh UUID: {} does not exist", uuid);
+        DB_LOG_DEBUG("refresh UUID: {} does not exist", uuid);
         check.result = false;
         ResetStatement(stmt);
-        EndTransaction();
         return check;
     }
     else
@@ -1379,18 +1983,12 @@ DBBoolResult SQLiteDB::DoesRefreshExist(const std::string &uuid) const
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
-
     return check;
 }
 
 DBBoolResult SQLiteDB::DoesErrorEntryExist(const std::string &uuid, size_t progress_num) const
 {
-    BlackLibraryCommon::LogDebug("db", "Check error entries for UUID: {}, progress_num: {}", uuid, progress_num);
+    DB_LOG_DEBUG("Check error entries for UUID: {}, progress_num: {}", uuid, progress_num);
 
     DBBoolResult check;
 
@@ -1402,27 +2000,24 @@ DBBoolResult SQLiteDB::DoesErrorEntryExist(const std::string &uuid, size_t progr
 
     if (CheckInitialized())
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(write_connection_.database_conn);
         return check;
     }
 
-    if (BeginTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[READ_ERROR_ENTRY_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[READ_ERROR_ENTRY_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[READ_ERROR_ENTRY_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
-    if (BindInt(stmt, "progress_num", progress_num))
+    if (BindInt64(stmt, parameters[PROGRESS_NUM_PARAMETER], progress_num))
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(lease->database_conn);
         return check;
     }
 
@@ -1433,10 +2028,9 @@ DBBoolResult SQLiteDB::DoesErrorEntryExist(const std::string &uuid, size_t progr
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "UUID: {} progress_num: {} does not exist", uuid, progress_num);
+        DB_LOG_DEBUG("UUID: {} progress_num: {} does not exist", uuid, progress_num);
         check.result = false;
         ResetStatement(stmt);
-        EndTransaction();
         return check;
     }
     else
@@ -1446,34 +2040,24 @@ DBBoolResult SQLiteDB::DoesErrorEntryExist(const std::string &uuid, size_t progr
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
-
     return check;
 }
 
 DBBoolResult SQLiteDB::DoesMinRefreshExist() const
 {
-    BlackLibraryCommon::LogDebug("db", "Check refresh for min date");
+    DB_LOG_DEBUG("Check refresh for min date");
 
     DBBoolResult check;
 
     if (CheckInitialized())
     {
-        check.error = sqlite3_errcode(database_conn_);
+        check.error = sqlite3_errcode(write_connection_.database_conn);
         return check;
     }
 
-    if (BeginTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[DOES_MIN_REFRESH_EXIST_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[DOES_MIN_REFRESH_EXIST_STATEMENT];
 
     LogTraceStatement(stmt);
 
@@ -1482,10 +2066,9 @@ DBBoolResult SQLiteDB::DoesMinRefreshExist() const
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "refresh does not exist");
+        DB_LOG_DEBUG("refresh does not exist");
         check.result = false;
         ResetStatement(stmt);
-        EndTransaction();
         return check;
     }
 
@@ -1493,18 +2076,12 @@ DBBoolResult SQLiteDB::DoesMinRefreshExist() const
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-    {
-        check.error = sqlite3_errcode(database_conn_);
-        return check;
-    }
-
     return check;
 }
 
 DBStringResult SQLiteDB::GetEntryUUIDFromUrl(const std::string &url, entry_table_rep_t entry_type) const
 {
-    BlackLibraryCommon::LogDebug("db", "Get UUID from url: {}", url);
+    DB_LOG_DEBUG("Get UUID from url: {}", url);
 
     DBStringResult res;
 
@@ -1525,13 +2102,13 @@ DBStringResult SQLiteDB::GetEntryUUIDFromUrl(const std::string &url, entry_table
             return res;
     }
 
-    if (BeginTransaction())
-        return res;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
 
     // bind statement variables
-    if (BindText(stmt, "url", url))
+    if (BindText(stmt, parameters[URL_PARAMETER], url))
         return res;
 
     LogTraceStatement(stmt);
@@ -1541,9 +2118,8 @@ DBStringResult SQLiteDB::GetEntryUUIDFromUrl(const std::string &url, entry_table
     ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW)
     {
-        BlackLibraryCommon::LogDebug("db", "Url: {} does not exist", url);
+        DB_LOG_DEBUG("Url: {} does not exist", url);
         ResetStatement(stmt);
-        EndTransaction();
         res.does_not_exist = true;
         res.error = false;
         return res;
@@ -1553,9 +2129,6 @@ DBStringResult SQLiteDB::GetEntryUUIDFromUrl(const std::string &url, entry_table
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return res;
-
     res.error = false;
 
     return res;
@@ -1563,12 +2136,15 @@ DBStringResult SQLiteDB::GetEntryUUIDFromUrl(const std::string &url, entry_table
 
 DBStringResult SQLiteDB::GetEntryUrlFromUUID(const std::string &uuid, entry_table_rep_t entry_type) const
 {
-    BlackLibraryCommon::LogDebug("db", "Get url from UUID: {}", uuid);
+    DB_LOG_DEBUG("Get url from UUID: {}", uuid);
 
     DBStringResult res;
 
     if (CheckInitialized())
+    {
+        res.error = sqlite3_errcode(write_connection_.database_conn);
         return res;
+    }
 
     int statement_id;
     switch (entry_type)
@@ -1580,160 +2156,430 @@ DBStringResult SQLiteDB::GetEntryUrlFromUUID(const std::string &uuid, entry_tabl
             statement_id = GET_STAGING_ENTRY_URL_FROM_UUID_STATEMENT;
             break;
         default:
-            EndTransaction();
             res.error = true;
             return res;
     }
 
-    if (BeginTransaction())
-        return res;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[statement_id];
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[statement_id];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+    {
+        res.error = sqlite3_errcode(lease->database_conn);
         return res;
+    }
 
     LogTraceStatement(stmt);
 
     // run statement
     int ret = SQLITE_OK;
     ret = sqlite3_step(stmt);
-    if (ret != SQLITE_ROW)
+    if (ret == SQLITE_DONE)
     {
-        BlackLibraryCommon::LogDebug("db", "UUID: {} does not exist", uuid);
+        DB_LOG_DEBUG("UUID: {} does not exist", uuid);
         ResetStatement(stmt);
-        EndTransaction();
         res.does_not_exist = true;
         res.error = false;
         return res;
     }
+    else if (ret != SQLITE_ROW)
+    {
+        BlackLibraryCommon::LogError("db", "Get url from UUID: {} failed: {}", uuid, sqlite3_errmsg(lease->database_conn));
+        res.error = sqlite3_errcode(lease->database_conn);
+        ResetStatement(stmt);
+        return res;
+    }
 
-    std::string url = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-    std::string last_url = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+    const char *url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    if (url)
+        res.result = url;
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
-        return res;
-
-    res.result = url;
-
     res.error = false;
 
     return res;
 }
 
-uint16_t SQLiteDB::GetVersionFromMd5(const std::string &uuid, size_t index_num) const
+int SQLiteDB::GetMd5SumsForUUID(const std::string &uuid, std::vector<DBMd5Sum> &md5s) const
 {
-    BlackLibraryCommon::LogDebug("db", "Get version from MD5");
-
-    uint16_t version_num = 0;
+    DB_LOG_DEBUG("Get MD5 checksums for UUID: {}", uuid);
 
     if (CheckInitialized())
-        return version_num;
+        return -1;
 
-    if (BeginTransaction())
-        return version_num;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[READ_MD5_SUM_STATEMENT];
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_MD5_SUMS_FROM_UUID_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[GET_MD5_SUMS_FROM_UUID_STATEMENT];
 
     // bind statement variables
-    if (BindText(stmt, "UUID", uuid))
-        return version_num;
-    if (BindInt(stmt, "index_num", index_num))
-        return version_num;
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return -1;
 
     LogTraceStatement(stmt);
 
-    // run statement
+    // range scan over the (UUID, index_num) primary key, rows come back ordered by index_num
+    size_t count = 0;
     int ret = SQLITE_OK;
-    ret = sqlite3_step(stmt);
-    if (ret != SQLITE_ROW)
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
-        ResetStatement(stmt);
-        EndTransaction();
-        return version_num;
+        // reuse the caller's elements so their string buffers are kept
+        if (count == md5s.size())
+            md5s.emplace_back();
+
+        DBMd5Sum &md5 = md5s[count];
+
+        ReadSQLiteRow(stmt, md5, Md5SumColumns);
+
+        ++count;
     }
 
-    version_num = sqlite3_column_int(stmt, 3);
+    md5s.resize(count);
 
-    ResetStatement(stmt);
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Get MD5 checksums for UUID: {} failed: {}", uuid, sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        return -1;
+    }
 
-    if (EndTransaction())
-        return version_num;
+    ResetStatement(stmt);
 
-    return version_num;
+    return 0;
 }
 
-DBRefresh SQLiteDB::GetRefreshFromMinDate() const
+DBMd5SumDiff SQLiteDB::DiffMd5Sums(const std::string &uuid, const std::vector<std::pair<size_t, std::string>> &fresh) const
 {
-    BlackLibraryCommon::LogDebug("db", "Get refresh from next date");
+    DB_LOG_DEBUG("Diff {} MD5 checksums for UUID: {}", fresh.size(), uuid);
 
-    DBRefresh refresh;
+    DBMd5SumDiff diff;
 
     if (CheckInitialized())
-        return refresh;
+    {
+        diff.error = -1;
+        return diff;
+    }
 
-    if (BeginTransaction())
-        return refresh;
+    const ReadConnectionLease lease(*this);
 
-    sqlite3_stmt *stmt = prepared_statements_[GET_REFRESH_FROM_MIN_DATE_STATEMENT];
+    if (BeginReadTransaction(*lease))
+    {
+        diff.error = -1;
+        return diff;
+    }
 
-    LogTraceStatement(stmt);
+    sqlite3_stmt *clear_stmt = lease->prepared_statements[CLEAR_MD5_SUM_DIFF_STATEMENT];
+    sqlite3_stmt *insert_stmt = lease->prepared_statements[INSERT_MD5_SUM_DIFF_STATEMENT];
+    const sqlite_parameter_indices_t &insert_parameters = lease->parameter_indices[INSERT_MD5_SUM_DIFF_STATEMENT];
+    sqlite3_stmt *diff_stmt = lease->prepared_statements[DIFF_MD5_SUMS_STATEMENT];
+    const sqlite_parameter_indices_t &diff_parameters = lease->parameter_indices[DIFF_MD5_SUMS_STATEMENT];
 
-    // run statement
-    int ret = SQLITE_OK;
-    ret = sqlite3_step(stmt);
-    if (ret != SQLITE_ROW)
+    if (sqlite3_step(clear_stmt) != SQLITE_DONE)
     {
-        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(database_conn_));
-        ResetStatement(stmt);
-        EndTransaction();
-        return refresh;
+        BlackLibraryCommon::LogError("db", "Clear MD5 checksum diff failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(clear_stmt);
+        RollbackTransaction(*lease);
+        diff.error = -1;
+        return diff;
     }
+    ResetStatement(clear_stmt);
 
-    refresh.uuid = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
-    refresh.refresh_date = sqlite3_column_int(stmt, 1);
+    // load the fresh checksums into the per connection temp table
+    for (const auto &fresh_md5 : fresh)
+    {
+        if (BindInt64(insert_stmt, insert_parameters[INDEX_NUM_PARAMETER], fresh_md5.first) || BindText(insert_stmt, insert_parameters[MD5_SUM_PARAMETER], fresh_md5.second))
+        {
+            ResetStatement(insert_stmt);
+            RollbackTransaction(*lease);
+            diff.error = -1;
+            return diff;
+        }
+
+        if (sqlite3_step(insert_stmt) != SQLITE_DONE)
+        {
+            BlackLibraryCommon::LogError("db", "Load MD5 checksum diff index_num: {} failed: {}", fresh_md5.first, sqlite3_errmsg(lease->database_conn));
+            ResetStatement(insert_stmt);
+            RollbackTransaction(*lease);
+            diff.error = -1;
+            return diff;
+        }
+        ResetStatement(insert_stmt);
+    }
+
+    // bind statement variables
+    if (BindText(diff_stmt, diff_parameters[UUID_PARAMETER], uuid))
+    {
+        RollbackTransaction(*lease);
+        diff.error = -1;
+        return diff;
+    }
+
+    LogTraceStatement(diff_stmt);
+
+    // run statement in loop until done
+    int ret = SQLITE_OK;
+    while ((ret = sqlite3_step(diff_stmt)) == SQLITE_ROW)
+    {
+        size_t index_num = sqlite3_column_int64(diff_stmt, 0);
+
+        switch (sqlite3_column_int(diff_stmt, 1))
+        {
+            case 0:
+                diff.new_indices.emplace_back(index_num);
+                break;
+            case 1:
+                diff.changed_indices.emplace_back(index_num);
+                break;
+            default:
+                diff.vanished_indices.emplace_back(index_num);
+                break;
+        }
+    }
+
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Diff MD5 checksums for UUID: {} failed: {}", uuid, sqlite3_errmsg(lease->database_conn));
+        ResetStatement(diff_stmt);
+        RollbackTransaction(*lease);
+        diff.error = -1;
+        return diff;
+    }
+
+    ResetStatement(diff_stmt);
+
+    // do not hold on to the fresh checksums between calls, rolling back drops them as well
+    if (sqlite3_step(clear_stmt) != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Clear MD5 checksum diff failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(clear_stmt);
+        RollbackTransaction(*lease);
+        diff.error = -1;
+        return diff;
+    }
+    ResetStatement(clear_stmt);
+
+    if (EndTransaction(*lease))
+        diff.error = -1;
+
+    return diff;
+}
+
+uint16_t SQLiteDB::GetVersionFromMd5(const std::string &uuid, size_t index_num) const
+{
+    DB_LOG_DEBUG("Get version from MD5");
+
+    uint16_t version_num = 0;
+
+    if (CheckInitialized())
+        return version_num;
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[READ_MD5_SUM_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[READ_MD5_SUM_STATEMENT];
+
+    // bind statement variables
+    if (BindText(stmt, parameters[UUID_PARAMETER], uuid))
+        return version_num;
+    if (BindInt64(stmt, parameters[INDEX_NUM_PARAMETER], index_num))
+        return version_num;
+
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_ROW)
+    {
+        BlackLibraryCommon::LogError("db", "Read MD5 checksum failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        return version_num;
+    }
+
+    version_num = sqlite3_column_int(stmt, 3);
 
     ResetStatement(stmt);
 
-    if (EndTransaction())
+    return version_num;
+}
+
+DBRefresh SQLiteDB::GetRefreshFromMinDate() const
+{
+    DB_LOG_DEBUG("Get refresh from next date");
+
+    DBRefresh refresh;
+
+    if (CheckInitialized())
+        return refresh;
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_REFRESH_FROM_MIN_DATE_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[GET_REFRESH_FROM_MIN_DATE_STATEMENT];
+
+    // NULL refresh dates sort first so they are skipped, as are refreshes another worker holds a lease on
+    if (BindInt64(stmt, parameters[NOW_PARAMETER], std::time(nullptr)))
         return refresh;
 
+    LogTraceStatement(stmt);
+
+    // run statement
+    int ret = SQLITE_OK;
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_ROW)
+    {
+        BlackLibraryCommon::LogError("db", "Get refresh from min date failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        return refresh;
+    }
+
+    ReadSQLiteRow(stmt, refresh, RefreshColumns);
+
+    ResetStatement(stmt);
+
     return refresh;
 }
 
+int SQLiteDB::GetDueRefreshes(time_t now, size_t limit, std::vector<DBRefresh> &refreshes) const
+{
+    DB_LOG_DEBUG("Get up to {} refreshes due by: {}", limit, now);
+
+    refreshes.clear();
+
+    if (CheckInitialized())
+        return -1;
+
+    if (limit == 0)
+        return 0;
+
+    const ReadConnectionLease lease(*this);
+
+    sqlite3_stmt *stmt = lease->prepared_statements[GET_DUE_REFRESHES_STATEMENT];
+    const sqlite_parameter_indices_t &parameters = lease->parameter_indices[GET_DUE_REFRESHES_STATEMENT];
+
+    // bind statement variables
+    if (BindInt64(stmt, parameters[REFRESH_DATE_PARAMETER], now))
+        return -1;
+    if (BindInt64(stmt, parameters[LIMIT_PARAMETER], limit))
+        return -1;
+    if (BindInt64(stmt, parameters[NOW_PARAMETER], std::time(nullptr)))
+        return -1;
+
+    LogTraceStatement(stmt);
+
+    // range scan over refresh_date_idx, rows come back in date order
+    int ret = SQLITE_OK;
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        DBRefresh refresh;
+
+        ReadSQLiteRow(stmt, refresh, RefreshColumns);
+
+        refreshes.emplace_back(refresh);
+    }
+
+    if (ret != SQLITE_DONE)
+    {
+        BlackLibraryCommon::LogError("db", "Get due refreshes failed: {}", sqlite3_errmsg(lease->database_conn));
+        ResetStatement(stmt);
+        return -1;
+    }
+
+    ResetStatement(stmt);
+
+    return 0;
+}
+
+int SQLiteDB::ExplainPreparedStatements(std::vector<SQLiteQueryPlan> &plans) const
+{
+    if (CheckInitialized())
+        return -1;
+
+    const WriteConnectionLease lease(*this);
+
+    plans.clear();
+    for (size_t i = 0; i < lease->prepared_statements.size(); ++i)
+    {
+        SQLiteQueryPlan plan;
+        plan.statement_name = PreparedStatementNames[i];
+        plan.sql = sqlite3_sql(lease->prepared_statements[i]);
+
+        const std::string explain_sql = "EXPLAIN QUERY PLAN " + plan.sql;
+        sqlite3_stmt *stmt = nullptr;
+        int ret = sqlite3_prepare_v2(lease->database_conn, explain_sql.c_str(), -1, &stmt, nullptr);
+        if (ret != SQLITE_OK)
+        {
+            BlackLibraryCommon::LogError("db", "Explain {} failed: {}", plan.statement_name, sqlite3_errmsg(lease->database_conn));
+            sqlite3_finalize(stmt);
+            return -1;
+        }
+
+        // the detail text is the fourth column in every sqlite release that has EXPLAIN QUERY PLAN
+        while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            const unsigned char *detail = sqlite3_column_text(stmt, 3);
+            plan.details.emplace_back(detail ? reinterpret_cast<const char *>(detail) : "");
+        }
+
+        sqlite3_finalize(stmt);
+
+        if (ret != SQLITE_DONE)
+        {
+            BlackLibraryCommon::LogError("db", "Explain {} failed: {}", plan.statement_name, sqlite3_errmsg(lease->database_conn));
+            return -1;
+        }
+
+        plans.emplace_back(plan);
+    }
+
+    return 0;
+}
+
 bool SQLiteDB::IsReady() const
 {
     return initialized_;
 }
 
-int SQLiteDB::GenerateTables()
+int SQLiteDB::RunMigrations()
 {
-    BlackLibraryCommon::LogDebug("db", "Setting up tables");
+    int schema_version = 0;
 
-    int res = 0;
+    if (GetSchemaVersion(schema_version))
+        return -1;
 
-    res += GenerateTable(CreateUserTable);
-    res += GenerateTable(CreateMediaTypeTable);
-    res += GenerateTable(CreateMediaSubtypeTable);
-    res += GenerateTable(CreateBookGenreTable);
-    res += GenerateTable(CreateDocumentTagTable);
-    res += GenerateTable(CreateSourceTable);
-    res += GenerateTable(CreateStagingEntryTable);
-    res += GenerateTable(CreateBlackEntryTable);
-    res += GenerateTable(CreateMd5SumTable);
-    res += GenerateTable(CreateRefreshTable);
-    res += GenerateTable(CreateErrorEntryTable);
+    const int latest_version = Migrations.back().version;
 
-    return res;
+    if (schema_version == latest_version)
+    {
+        DB_LOG_DEBUG("Schema version {} is current", schema_version);
+        return 0;
+    }
+
+    if (schema_version > latest_version)
+    {
+        BlackLibraryCommon::LogInfo("db", "Schema version {} is newer than supported version {}, skipping migrations", schema_version, latest_version);
+        return 0;
+    }
+
+    for (const auto &migration : Migrations)
+    {
+        if (migration.version <= schema_version)
+            continue;
+
+        if (RunMigration(migration))
+            return -1;
+    }
+
+    return 0;
 }
 
 int SQLiteDB::SetupDefaultTypeTables()
 {
-    BlackLibraryCommon::LogDebug("db", "Setting up default type tables");
+    DB_LOG_DEBUG("Setting up default type tables");
 
     int res = 0;
 
@@ -1824,55 +2670,80 @@ int SQLiteDB::SetupDefaultSourceTable()
     return 0;
 }
 
-int SQLiteDB::PrepareStatements()
+int SQLiteDB::PrepareStatements(SQLiteConnection &connection)
 {
-    if (!database_conn_)
+    if (!connection.database_conn)
+        return -1;
+
+    // temp tables only live on their own connection, create them before preparing statements that use them
+    if (GenerateTempTables(connection))
         return -1;
 
     int res = 0;
 
-    res += PrepareStatement(CreateUserStatement, CREATE_USER_STATEMENT);
-    res += PrepareStatement(CreateMediaTypeStatement, CREATE_MEDIA_TYPE_STATEMENT);
-    res += PrepareStatement(CreateMediaSubtypeStatement, CREATE_MEDIA_SUBTYPE_STATEMENT);
-    res += PrepareStatement(CreateSourceStatement, CREATE_SOURCE_STATEMENT);
-    res += PrepareStatement(CreateStagingEntryStatement, CREATE_STAGING_ENTRY_STATEMENT);
-    res += PrepareStatement(CreateBlackEntryStatement, CREATE_BLACK_ENTRY_STATEMENT);
-    res += PrepareStatement(CreateMd5SumStatement, CREATE_MD5_SUM_STATEMENT);
-    res += PrepareStatement(CreateRefreshStatement, CREATE_REFRESH_STATEMENT);
-    res += PrepareStatement(CreateErrorEntryStatement, CREATE_ERROR_ENTRY_STATEMENT);
-
-    res += PrepareStatement(ReadStagingEntryStatement, READ_STAGING_ENTRY_STATEMENT);
-    res += PrepareStatement(ReadStagingEntryUrlStatement, READ_STAGING_ENTRY_URL_STATEMENT);
-    res += PrepareStatement(ReadStagingEntryUUIDStatement, READ_STAGING_ENTRY_UUID_STATEMENT);
-    res += PrepareStatement(ReadBlackEntryStatement, READ_BLACK_ENTRY_STATEMENT);
-    res += PrepareStatement(ReadBlackEntryUrlStatement, READ_BLACK_ENTRY_URL_STATEMENT);
-    res += PrepareStatement(ReadBlackEntryUUIDStatement, READ_BLACK_ENTRY_UUID_STATEMENT);
-    res += PrepareStatement(ReadMd5SumStatement, READ_MD5_SUM_STATEMENT);
-    res += PrepareStatement(ReadRefreshStatement, READ_REFRESH_STATEMENT);
-    res += PrepareStatement(ReadErrorEntryStatement, READ_ERROR_ENTRY_STATEMENT);
-
-    res += PrepareStatement(UpdateStagingEntryStatement, UPDATE_STAGING_ENTRY_STATEMENT);
-    res += PrepareStatement(UpdateBlackEntryStatement, UPDATE_BLACK_ENTRY_STATEMENT);
-    res += PrepareStatement(UpdateMd5SumStatement, UPDATE_MD5_SUM_STATEMENT);
-
-    res += PrepareStatement(DeleteStagingEntryStatement, DELETE_STAGING_ENTRY_STATEMENT);
-    res += PrepareStatement(DeleteBlackEntryStatement, DELETE_BLACK_ENTRY_STATEMENT);
-    res += PrepareStatement(DeleteMd5SumStatement, DELETE_MD5_SUM_STATEMENT);
-    res += PrepareStatement(DeleteRefreshStatement, DELETE_REFRESH_STATEMENT);
-    res += PrepareStatement(DeleteErrorEntryStatement, DELETE_ERROR_ENTRY_STATEMENT);
-
-    res += PrepareStatement(GetStagingEntriesStatement, GET_STAGING_ENTRIES_STATEMENT);
-    res += PrepareStatement(GetBlackEntriesStatement, GET_BLACK_ENTRIES_STATEMENT);
-    res += PrepareStatement(GetMd5sumsStatement, GET_CHECKSUMS_STATEMENT);
-    res += PrepareStatement(GetErrorEntriesStatement, GET_ERROR_ENTRIES_STATEMENT);
-
-    res += PrepareStatement(DoesMinRefreshExistStatement, DOES_MIN_REFRESH_EXIST_STATEMENT);
-    res += PrepareStatement(GetStagingEntryUUIDFromUrlStatement, GET_STAGING_ENTRY_UUID_FROM_URL_STATEMENT);
-    res += PrepareStatement(GetStagingEntryUrlFromUUIDStatement, GET_STAGING_ENTRY_URL_FROM_UUID_STATEMENT);
-    res += PrepareStatement(GetBlackEntryUUIDFromUrlStatement, GET_BLACK_ENTRY_UUID_FROM_URL_STATEMENT);
-    res += PrepareStatement(GetBlackEntryUrlFromUUIDStatement, GET_BLACK_ENTRY_URL_FROM_UUID_STATEMENT);
-    res += PrepareStatement(GetMd5SumFromUUIDAndIndexStatement, GET_MD5_SUM_FROM_UUID_AND_INDEX_STATEMENT);
-    res += PrepareStatement(GetRefreshFromMinDateStatement, GET_REFRESH_FROM_MIN_DATE_STATEMENT);
+    res += PrepareStatement(connection, CreateUserStatement, CREATE_USER_STATEMENT);
+    res += PrepareStatement(connection, CreateMediaTypeStatement, CREATE_MEDIA_TYPE_STATEMENT);
+    res += PrepareStatement(connection, CreateMediaSubtypeStatement, CREATE_MEDIA_SUBTYPE_STATEMENT);
+    res += PrepareStatement(connection, CreateSourceStatement, CREATE_SOURCE_STATEMENT);
+    res += PrepareStatement(connection, InsertSQLiteRowSQL(EntryColumns, "staging_entry"), CREATE_STAGING_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, InsertSQLiteRowSQL(EntryColumns, "black_entry"), CREATE_BLACK_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, InsertSQLiteRowSQL(Md5SumColumns, "md5_sum"), CREATE_MD5_SUM_STATEMENT);
+    res += PrepareStatement(connection, InsertSQLiteRowSQL(RefreshColumns, "refresh"), CREATE_REFRESH_STATEMENT);
+    res += PrepareStatement(connection, InsertSQLiteRowSQL(ErrorEntryColumns, "error_entry"), CREATE_ERROR_ENTRY_STATEMENT);
+
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "staging_entry", "WHERE UUID = :UUID"), READ_STAGING_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "staging_entry", "WHERE url = :url"), READ_STAGING_ENTRY_URL_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "staging_entry", "WHERE UUID = :UUID"), READ_STAGING_ENTRY_UUID_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "black_entry", "WHERE UUID = :UUID"), READ_BLACK_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "black_entry", "WHERE url = :url"), READ_BLACK_ENTRY_URL_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "black_entry", "WHERE UUID = :UUID"), READ_BLACK_ENTRY_UUID_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(Md5SumColumns, "md5_sum", "WHERE UUID = :UUID AND index_num = :index_num"), READ_MD5_SUM_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(RefreshColumns, "refresh", "WHERE UUID = :UUID"), READ_REFRESH_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(ErrorEntryColumns, "error_entry", "WHERE UUID = :UUID AND progress_num = :progress_num"), READ_ERROR_ENTRY_STATEMENT);
+
+    res += PrepareStatement(connection, UpdateSQLiteRowSQL(EntryColumns, "staging_entry"), UPDATE_STAGING_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, UpdateSQLiteRowSQL(EntryColumns, "black_entry"), UPDATE_BLACK_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, UpdateSQLiteRowSQL(Md5SumColumns, "md5_sum", 2), UPDATE_MD5_SUM_STATEMENT);
+    res += PrepareStatement(connection, UpsertMd5SumStatement, UPSERT_MD5_SUM_STATEMENT);
+
+    res += PrepareStatement(connection, DeleteStagingEntryStatement, DELETE_STAGING_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, DeleteBlackEntryStatement, DELETE_BLACK_ENTRY_STATEMENT);
+    res += PrepareStatement(connection, DeleteMd5SumStatement, DELETE_MD5_SUM_STATEMENT);
+    res += PrepareStatement(connection, DeleteRefreshStatement, DELETE_REFRESH_STATEMENT);
+    res += PrepareStatement(connection, DeleteErrorEntryStatement, DELETE_ERROR_ENTRY_STATEMENT);
+
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "staging_entry"), GET_STAGING_ENTRIES_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "black_entry"), GET_BLACK_ENTRIES_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(Md5SumColumns, "md5_sum"), GET_CHECKSUMS_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(ErrorEntryColumns, "error_entry"), GET_ERROR_ENTRIES_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "staging_entry", "WHERE UUID > :UUID ORDER BY UUID LIMIT :limit"), GET_STAGING_ENTRIES_PAGE_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(EntryColumns, "black_entry", "WHERE UUID > :UUID ORDER BY UUID LIMIT :limit"), GET_BLACK_ENTRIES_PAGE_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(Md5SumColumns, "md5_sum", "WHERE (UUID, index_num) > (:UUID, :index_num) ORDER BY UUID, index_num LIMIT :limit"), GET_CHECKSUMS_PAGE_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(ErrorEntryColumns, "error_entry", "WHERE UUID > :UUID ORDER BY UUID LIMIT :limit"), GET_ERROR_ENTRIES_PAGE_STATEMENT);
+
+    res += PrepareStatement(connection, DoesMinRefreshExistStatement, DOES_MIN_REFRESH_EXIST_STATEMENT);
+    res += PrepareStatement(connection, GetStagingEntryUUIDFromUrlStatement, GET_STAGING_ENTRY_UUID_FROM_URL_STATEMENT);
+    res += PrepareStatement(connection, GetStagingEntryUrlFromUUIDStatement, GET_STAGING_ENTRY_URL_FROM_UUID_STATEMENT);
+    res += PrepareStatement(connection, GetBlackEntryUUIDFromUrlStatement, GET_BLACK_ENTRY_UUID_FROM_URL_STATEMENT);
+    res += PrepareStatement(connection, GetBlackEntryUrlFromUUIDStatement, GET_BLACK_ENTRY_URL_FROM_UUID_STATEMENT);
+    res += PrepareStatement(connection, GetMd5SumFromUUIDAndIndexStatement, GET_MD5_SUM_FROM_UUID_AND_INDEX_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(Md5SumColumns, "md5_sum", "WHERE UUID = :UUID ORDER BY index_num"), GET_MD5_SUMS_FROM_UUID_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(RefreshColumns, "refresh", "WHERE refresh_date IS NOT NULL AND (lease_owner IS NULL OR lease_expires <= :now) ORDER BY refresh_date LIMIT 1"), GET_REFRESH_FROM_MIN_DATE_STATEMENT);
+    res += PrepareStatement(connection, SelectSQLiteRowSQL(RefreshColumns, "refresh", "WHERE refresh_date <= :refresh_date AND (lease_owner IS NULL OR lease_expires <= :now) ORDER BY refresh_date LIMIT :limit"), GET_DUE_REFRESHES_STATEMENT);
+
+    res += PrepareStatement(connection, ClearMd5SumDiffStatement, CLEAR_MD5_SUM_DIFF_STATEMENT);
+    res += PrepareStatement(connection, InsertMd5SumDiffStatement, INSERT_MD5_SUM_DIFF_STATEMENT);
+    res += PrepareStatement(connection, DiffMd5SumsStatement, DIFF_MD5_SUMS_STATEMENT);
+
+    res += PrepareStatement(connection, GetClaimableRefreshesStatement, GET_CLAIMABLE_REFRESHES_STATEMENT);
+    res += PrepareStatement(connection, ClaimRefreshStatement, CLAIM_REFRESH_STATEMENT);
+    res += PrepareStatement(connection, CompleteRefreshStatement, COMPLETE_REFRESH_STATEMENT);
+    res += PrepareStatement(connection, ReleaseRefreshStatement, RELEASE_REFRESH_STATEMENT);
+
+    res += PrepareStatement(connection, BeginDeferredTransactionStatement, BEGIN_DEFERRED_TRANSACTION_STATEMENT);
+    res += PrepareStatement(connection, BeginImmediateTransactionStatement, BEGIN_IMMEDIATE_TRANSACTION_STATEMENT);
+    res += PrepareStatement(connection, CommitTransactionStatement, COMMIT_TRANSACTION_STATEMENT);
+    res += PrepareStatement(connection, RollbackTransactionStatement, ROLLBACK_TRANSACTION_STATEMENT);
 
     return res;
 }
@@ -1919,14 +2790,26 @@ int SQLiteDB::SetupDefaultBlackLibraryUsers()
     return 0;
 }
 
-int SQLiteDB::BeginTransaction() const
+// writers take the write lock up front so a busy database fails here instead of on the first write
+int SQLiteDB::BeginTransaction(const SQLiteConnection &connection) const
 {
-    char *error_msg = 0;
-    BlackLibraryCommon::LogTrace("db", "Begin transaction");
-    int ret = sqlite3_exec(database_conn_, "BEGIN TRANSACTION", 0, 0, &error_msg);
-    if (ret != SQLITE_OK)
+    DB_LOG_TRACE("Begin immediate transaction");
+    if (StepTransactionStatement(connection, BEGIN_IMMEDIATE_TRANSACTION_STATEMENT, BeginImmediateTransactionStatement))
+    {
+        BlackLibraryCommon::LogError("db", "Begin immediate transaction failed: {}", sqlite3_errmsg(connection.database_conn));
+        return -1;
+    }
+
+    return 0;
+}
+
+// only reads that span several statements need one, a single statement already reads a consistent snapshot
+int SQLiteDB::BeginReadTransaction(const SQLiteConnection &connection) const
+{
+    DB_LOG_TRACE("Begin deferred transaction");
+    if (StepTransactionStatement(connection, BEGIN_DEFERRED_TRANSACTION_STATEMENT, BeginDeferredTransactionStatement))
     {
-        BlackLibraryCommon::LogError("db", "Begin transaction failed: {} - {}", error_msg, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Begin deferred transaction failed: {}", sqlite3_errmsg(connection.database_conn));
         return -1;
     }
 
@@ -1944,87 +2827,462 @@ int SQLiteDB::CheckInitialized() const
     return 0;
 }
 
-int SQLiteDB::EndTransaction() const
+int SQLiteDB::CloseConnection(SQLiteConnection &connection)
 {
-    char *error_msg = 0;
-    BlackLibraryCommon::LogTrace("db", "End transaction");
-    int ret = sqlite3_exec(database_conn_, "END TRANSACTION", 0, 0, &error_msg);
+    if (!connection.database_conn)
+        return 0;
+
+    for (size_t i = 0; i < connection.prepared_statements.size(); ++i)
+    {
+        sqlite3_finalize(connection.prepared_statements[i]);
+    }
+    connection.prepared_statements.clear();
+    connection.parameter_indices.clear();
+
+    for (const auto &projected_statement : connection.projected_statements)
+    {
+        sqlite3_finalize(projected_statement.second);
+    }
+    connection.projected_statements.clear();
+
+    int ret = sqlite3_close(connection.database_conn);
+    connection.database_conn = nullptr;
     if (ret != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "End transaction  failed: {} - {}", error_msg, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Close connection failed: {}", sqlite3_errstr(ret));
         return -1;
     }
 
     return 0;
 }
 
+int SQLiteDB::EnableSlowQueryLog(SQLiteConnection &connection)
+{
+    if (slow_query_threshold_ns_ == 0)
+        return 0;
+
+    int ret = sqlite3_trace_v2(connection.database_conn, SQLITE_TRACE_PROFILE, &SQLiteDB::ProfileCallback, const_cast<SQLiteDB *>(this));
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Register profile callback failed: {}", sqlite3_errmsg(connection.database_conn));
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::EndTransaction(const SQLiteConnection &connection) const
+{
+    DB_LOG_TRACE("Commit transaction");
+    if (StepTransactionStatement(connection, COMMIT_TRANSACTION_STATEMENT, CommitTransactionStatement))
+    {
+        BlackLibraryCommon::LogError("db", "Commit transaction failed: {}", sqlite3_errmsg(connection.database_conn));
+        // a failed commit can leave the transaction open
+        RollbackTransaction(connection);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::GetSchemaVersion(int &schema_version)
+{
+    sqlite3_stmt *stmt = nullptr;
+
+    int ret = sqlite3_prepare_v2(write_connection_.database_conn, "PRAGMA user_version", -1, &stmt, nullptr);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Prepare schema version failed: {}", sqlite3_errmsg(write_connection_.database_conn));
+        return -1;
+    }
+
+    ret = sqlite3_step(stmt);
+    if (ret != SQLITE_ROW)
+    {
+        BlackLibraryCommon::LogError("db", "Read schema version failed: {}", sqlite3_errmsg(write_connection_.database_conn));
+        sqlite3_finalize(stmt);
+        return -1;
+    }
+
+    schema_version = sqlite3_column_int(stmt, 0);
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+sqlite3_stmt *SQLiteDB::GetProjectedStatement(const SQLiteConnection &connection, entry_table_rep_t entry_type, entry_column_mask_t columns, bool by_uuid) const
+{
+    const uint64_t key = (static_cast<uint64_t>(entry_type) << 33) | (static_cast<uint64_t>(by_uuid) << 32) | columns;
+
+    const auto cached = connection.projected_statements.find(key);
+    if (cached != connection.projected_statements.end())
+        return cached->second;
+
+    std::string table_name;
+    switch (entry_type)
+    {
+        case BLACK_ENTRY:
+            table_name = "black_entry";
+            break;
+        case STAGING_ENTRY:
+            table_name = "staging_entry";
+            break;
+        default:
+            return nullptr;
+    }
+
+    const std::string statement = SelectSQLiteRowSQL(EntryColumns, table_name, by_uuid ? "WHERE UUID = :UUID" : "", columns);
+
+    sqlite3_stmt *stmt = nullptr;
+    int ret = sqlite3_prepare_v2(connection.database_conn, statement.c_str(), -1, &stmt, nullptr);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Prepare projected statement: {} failed: {}", statement, sqlite3_errmsg(connection.database_conn));
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+
+    DB_LOG_DEBUG("Prepared projected statement: {}", statement);
+
+    connection.projected_statements.emplace(key, stmt);
+
+    return stmt;
+}
+
 int SQLiteDB::GenerateTable(const std::string &sql)
 {
     char *error_msg = 0;
-    int ret = sqlite3_exec(database_conn_, sql.c_str(), 0, 0, &error_msg);
+    int ret = sqlite3_exec(write_connection_.database_conn, sql.c_str(), 0, 0, &error_msg);
     if (ret != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "Generate table failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Generate table failed: {}", sqlite3_errmsg(write_connection_.database_conn));
         return -1;
     }
 
     return 0;
 }
 
+int SQLiteDB::GenerateTempTables(SQLiteConnection &connection)
+{
+    char *error_msg = 0;
+    int ret = sqlite3_exec(connection.database_conn, CreateMd5SumDiffTempTable, 0, 0, &error_msg);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Generate temp table failed: {} - {}", error_msg, sqlite3_errmsg(connection.database_conn));
+        sqlite3_free(error_msg);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::OpenReadConnections(const std::string &database_url, size_t read_pool_size)
+{
+    DB_LOG_DEBUG("Open {} read connections", read_pool_size);
+
+    for (size_t i = 0; i < read_pool_size; ++i)
+    {
+        auto read_connection = std::make_unique<SQLiteConnection>();
+
+        int ret = sqlite3_open_v2(database_url.c_str(), &read_connection->database_conn, SQLITE_OPEN_READONLY, nullptr);
+        if (ret != SQLITE_OK)
+        {
+            BlackLibraryCommon::LogError("db", "Failed to open read connection at: {} - {}", database_url, sqlite3_errmsg(read_connection->database_conn));
+            CloseConnection(*read_connection);
+            return -1;
+        }
+
+        sqlite3_busy_timeout(read_connection->database_conn, BusyTimeoutMs);
+
+        if (PrepareStatements(*read_connection))
+        {
+            CloseConnection(*read_connection);
+            return -1;
+        }
+
+        if (EnableSlowQueryLog(*read_connection))
+        {
+            CloseConnection(*read_connection);
+            return -1;
+        }
+
+        idle_read_connections_.emplace_back(read_connection.get());
+        read_connections_.emplace_back(std::move(read_connection));
+    }
+
+    return 0;
+}
+
 // TODO: fix this so it uses a map intead of memory mapping in order
-int SQLiteDB::PrepareStatement(const std::string &statement, int statement_id)
+int SQLiteDB::PrepareStatement(SQLiteConnection &connection, const std::string &statement, int statement_id)
 {
-    prepared_statements_.emplace_back();
-    int ret = sqlite3_prepare_v2(database_conn_, statement.c_str(), -1, &prepared_statements_[statement_id], nullptr);
+    connection.prepared_statements.emplace_back();
+    connection.parameter_indices.emplace_back();
+    int ret = sqlite3_prepare_v2(connection.database_conn, statement.c_str(), -1, &connection.prepared_statements[statement_id], nullptr);
     if (ret != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "Prepare failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Prepare failed: {}", sqlite3_errmsg(connection.database_conn));
+        return -1;
+    }
+
+    ResolveParameterIndices(connection, statement_id);
+
+    return 0;
+}
+
+int SQLiteDB::RollbackTransaction(const SQLiteConnection &connection) const
+{
+    if (sqlite3_get_autocommit(connection.database_conn))
+        return 0;
+
+    DB_LOG_TRACE("Rollback transaction");
+    if (StepTransactionStatement(connection, ROLLBACK_TRANSACTION_STATEMENT, RollbackTransactionStatement))
+    {
+        BlackLibraryCommon::LogError("db", "Rollback transaction failed: {}", sqlite3_errmsg(connection.database_conn));
         return -1;
     }
 
     return 0;
 }
 
+// used where only the statement is at hand, such as a failed bind
+int SQLiteDB::RollbackTransaction(sqlite3 *database_conn) const
+{
+    if (sqlite3_get_autocommit(database_conn))
+        return 0;
+
+    char *error_msg = 0;
+    DB_LOG_TRACE("Rollback transaction");
+    int ret = sqlite3_exec(database_conn, RollbackTransactionStatement, 0, 0, &error_msg);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Rollback transaction failed: {} - {}", error_msg, sqlite3_errmsg(database_conn));
+        sqlite3_free(error_msg);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::RunMigration(const SQLiteMigration &migration)
+{
+    BlackLibraryCommon::LogInfo("db", "Migrate schema to version {}: {}", migration.version, migration.description);
+
+    if (BeginTransaction(write_connection_))
+        return -1;
+
+    for (const auto &statement : migration.statements)
+    {
+        if (GenerateTable(statement))
+        {
+            RollbackTransaction(write_connection_);
+            return -1;
+        }
+    }
+
+    // user_version is stored in the database header so it commits with the migration
+    const std::string set_version = "PRAGMA user_version = " + std::to_string(migration.version);
+    if (GenerateTable(set_version))
+    {
+        RollbackTransaction(write_connection_);
+        return -1;
+    }
+
+    if (EndTransaction(write_connection_))
+    {
+        RollbackTransaction(write_connection_);
+        return -1;
+    }
+
+    return 0;
+}
+
+void SQLiteDB::ResolveParameterIndices(SQLiteConnection &connection, int statement_id)
+{
+    sqlite3_stmt *stmt = connection.prepared_statements[statement_id];
+    sqlite_parameter_indices_t &parameter_indices = connection.parameter_indices[statement_id];
+
+    for (size_t i = 0; i < _NUM_SQLITE_PARAMETERS; ++i)
+    {
+        parameter_indices[i] = sqlite3_bind_parameter_index(stmt, ParameterNames[i]);
+    }
+}
+
 int SQLiteDB::ResetStatement(sqlite3_stmt* stmt) const
 {
     int ret = sqlite3_reset(stmt);
-    BlackLibraryCommon::LogTrace("db", "Reset statement");
+    DB_LOG_TRACE("Reset statement");
     if (ret != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "Reset statement failed: {}", sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Reset statement failed: {}", sqlite3_errmsg(sqlite3_db_handle(stmt)));
         return -1;
     }
 
     return 0;
 }
 
-int SQLiteDB::BindInt(sqlite3_stmt* stmt, const std::string &parameter_name, const int &bind_int) const
+// migrations run before the statements are prepared, they fall back to parsing the transaction control text
+int SQLiteDB::StepTransactionStatement(const SQLiteConnection &connection, int statement_id, const char *statement) const
+{
+    if (connection.prepared_statements.size() <= static_cast<size_t>(statement_id))
+    {
+        int ret = sqlite3_exec(connection.database_conn, statement, 0, 0, nullptr);
+        return ret == SQLITE_OK ? 0 : -1;
+    }
+
+    sqlite3_stmt *stmt = connection.prepared_statements[statement_id];
+
+    int ret = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+
+    return ret == SQLITE_DONE ? 0 : -1;
+}
+
+int SQLiteDB::SetupWriteConnection()
 {
-    BlackLibraryCommon::LogTrace("db", "BindInt parameter:{} with {}", parameter_name, bind_int);
-    const std::string parameter_index_name = ":" + parameter_name;
-    int ret = sqlite3_bind_int(stmt, sqlite3_bind_parameter_index(stmt, parameter_index_name.c_str()), bind_int);
+    char *error_msg = 0;
+
+    sqlite3_busy_timeout(write_connection_.database_conn, BusyTimeoutMs);
+
+    // WAL lets the read connections run alongside the writer
+    int ret = sqlite3_exec(write_connection_.database_conn, "PRAGMA journal_mode=WAL", 0, 0, &error_msg);
     if (ret != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "Bind of {}: {} failed: {}", parameter_name, bind_int, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Enable WAL journal mode failed: {} - {}", error_msg, sqlite3_errmsg(write_connection_.database_conn));
+        sqlite3_free(error_msg);
+        return -1;
+    }
+
+    return 0;
+}
+
+std::vector<int> SQLiteDB::StepEntries(const std::vector<DBEntry> &entries, int statement_id) const
+{
+    std::vector<int> results(entries.size(), -1);
+
+    if (entries.empty())
+        return results;
+
+    const WriteConnectionLease lease(*this);
+
+    // the whole batch shares one transaction, a failed row only rolls back its own statement
+    if (BeginTransaction(*lease))
+        return results;
+
+    sqlite3_stmt *stmt = lease->prepared_statements[statement_id];
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const DBEntry &entry = entries[i];
+
+        if (entry.uuid.empty())
+        {
+            BlackLibraryCommon::LogError("db", "Skip entry with empty UUID at batch index: {}", i);
+            continue;
+        }
+
+        // a failed bind already ended the transaction
+        if (BindRow(stmt, entry, EntryColumns))
+            return std::vector<int>(entries.size(), -1);
+
+        LogTraceStatement(stmt);
+
+        int ret = sqlite3_step(stmt);
+        if (ret != SQLITE_DONE)
+        {
+            BlackLibraryCommon::LogError("db", "Step entry with UUID: {} failed: {}", entry.uuid, sqlite3_errmsg(lease->database_conn));
+        }
+        else
+        {
+            results[i] = 0;
+        }
+
+        ResetStatement(stmt);
+    }
+
+    if (EndTransaction(*lease))
+        return std::vector<int>(entries.size(), -1);
+
+    return results;
+}
+
+template <typename Row, typename Columns>
+int SQLiteDB::BindRow(sqlite3_stmt* stmt, const Row &row, const Columns &columns) const
+{
+    int ret = BindSQLiteRow(stmt, row, columns);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Bind row failed: {}", sqlite3_errmsg(sqlite3_db_handle(stmt)));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(sqlite3_db_handle(stmt));
         return -1;
     }
 
     return 0;
 }
 
-int SQLiteDB::BindText(sqlite3_stmt* stmt, const std::string &parameter_name, const std::string &bind_text) const
+void SQLiteDB::ReadEntryColumns(sqlite3_stmt* stmt, entry_column_mask_t columns, DBEntry &entry) const
 {
-    BlackLibraryCommon::LogTrace("db", "BindText parameter:{} with {}", parameter_name, bind_text);
-    const std::string parameter_index_name = ":" + parameter_name;
-    int index = sqlite3_bind_parameter_index(stmt, parameter_index_name.c_str());
-    int ret = sqlite3_bind_text(stmt, index, bind_text.c_str(), bind_text.length(), SQLITE_STATIC);
+    DBEntryView view;
+
+    ReadEntryViewColumns(stmt, columns, view);
+
+    view.MaterializeInto(entry);
+}
+
+// selected columns come back in DBEntryColumnID order, unselected fields are left untouched
+void SQLiteDB::ReadEntryViewColumns(sqlite3_stmt* stmt, entry_column_mask_t columns, DBEntryView &view) const
+{
+    if (columns == AllEntryColumns)
+    {
+        ReadSQLiteRow(stmt, view, EntryViewColumns);
+        return;
+    }
+
+    ReadSQLiteRowColumns(stmt, columns, view, EntryViewColumns);
+}
+
+int SQLiteDB::BindInt(sqlite3_stmt* stmt, int parameter_index, const int &bind_int) const
+{
+    DB_LOG_TRACE("BindInt parameter:{} with {}", ParameterName(stmt, parameter_index), bind_int);
+    int ret = sqlite3_bind_int(stmt, parameter_index, bind_int);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Bind of {}: {} failed: {}", ParameterName(stmt, parameter_index), bind_int, sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        ResetStatement(stmt);
+        RollbackTransaction(sqlite3_db_handle(stmt));
+        return -1;
+    }
+
+    return 0;
+}
+
+// times, limits and index numbers bind as 64 bit, the width the row codec binds them with
+int SQLiteDB::BindInt64(sqlite3_stmt* stmt, int parameter_index, const sqlite3_int64 &bind_int) const
+{
+    DB_LOG_TRACE("BindInt64 parameter:{} with {}", ParameterName(stmt, parameter_index), bind_int);
+    int ret = sqlite3_bind_int64(stmt, parameter_index, bind_int);
+    if (ret != SQLITE_OK)
+    {
+        BlackLibraryCommon::LogError("db", "Bind of {}: {} failed: {}", ParameterName(stmt, parameter_index), bind_int, sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        ResetStatement(stmt);
+        RollbackTransaction(sqlite3_db_handle(stmt));
+        return -1;
+    }
+
+    return 0;
+}
+
+int SQLiteDB::BindText(sqlite3_stmt* stmt, int parameter_index, const std::string &bind_text) const
+{
+    DB_LOG_TRACE("BindText parameter:{} with {}", ParameterName(stmt, parameter_index), bind_text);
+    int ret = sqlite3_bind_text(stmt, parameter_index, bind_text.c_str(), bind_text.length(), SQLITE_STATIC);
     if (ret != SQLITE_OK)
     {
-        BlackLibraryCommon::LogError("db", "Bind of {}: {} failed: {}", parameter_name, bind_text, sqlite3_errmsg(database_conn_));
+        BlackLibraryCommon::LogError("db", "Bind of {}: {} failed: {}", ParameterName(stmt, parameter_index), bind_text, sqlite3_errmsg(sqlite3_db_handle(stmt)));
         ResetStatement(stmt);
-        EndTransaction();
+        RollbackTransaction(sqlite3_db_handle(stmt));
         return -1;
     }
 
@@ -2033,13 +3291,68 @@ int SQLiteDB::BindText(sqlite3_stmt* stmt, const std::string &parameter_name, co
 
 int SQLiteDB::LogTraceStatement(sqlite3_stmt* stmt) const
 {
+    // expanding the bound values allocates, only pay for it when the trace is written
+    if (!DB_LOG_ENABLED(spdlog::level::trace))
+        return 0;
+
     char *trace_sql = sqlite3_expanded_sql(stmt);
-    BlackLibraryCommon::LogTrace("db", "{}", std::string(trace_sql));
+    logger_->trace("{}", trace_sql ? trace_sql : sqlite3_sql(stmt));
     sqlite3_free(trace_sql);
 
     return 0;
 }
 
+// the vm counters are reset after every run so a slow run reports only its own scans and sorts
+void SQLiteDB::LogSlowQuery(sqlite3_stmt* stmt, uint64_t elapsed_ns) const
+{
+    const int full_scan_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    const int sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    const int autoindexes = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+    const int vm_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+
+    // sqlite times runs with the VFS clock, which only has millisecond resolution
+    if (elapsed_ns <= slow_query_threshold_ns_)
+        return;
+
+    // the connections are fixed once the database is open, find the one that owns the statement
+    const char *statement_name = "unprepared";
+    const sqlite3 *database_conn = sqlite3_db_handle(stmt);
+    const SQLiteConnection *connection = &write_connection_;
+    for (const auto &read_connection : read_connections_)
+    {
+        if (read_connection->database_conn == database_conn)
+            connection = read_connection.get();
+    }
+    if (connection->database_conn == database_conn)
+    {
+        const auto &statements = connection->prepared_statements;
+        const auto it = std::find(statements.begin(), statements.end(), stmt);
+        if (it != statements.end())
+            statement_name = PreparedStatementNames[it - statements.begin()];
+        else if (std::any_of(connection->projected_statements.begin(), connection->projected_statements.end(),
+                     [stmt](const auto &projected_statement) { return projected_statement.second == stmt; }))
+            statement_name = "PROJECTED_ENTRY_STATEMENT";
+    }
+
+    char *expanded_sql = sqlite3_expanded_sql(stmt);
+
+    BlackLibraryCommon::LogWarn("db", "Slow query {} took {} ms full_scan_steps: {} sorts: {} autoindexes: {} vm_steps: {} - {}",
+        statement_name, elapsed_ns / 1000000, full_scan_steps, sorts, autoindexes, vm_steps, expanded_sql ? expanded_sql : sqlite3_sql(stmt));
+
+    sqlite3_free(expanded_sql);
+}
+
+int SQLiteDB::ProfileCallback(unsigned int trace_type, void *context, void *p, void *x)
+{
+    if (trace_type != SQLITE_TRACE_PROFILE)
+        return 0;
+
+    const SQLiteDB *db = static_cast<const SQLiteDB *>(context);
+    db->LogSlowQuery(static_cast<sqlite3_stmt *>(p), static_cast<uint64_t>(*static_cast<const sqlite3_int64 *>(x)));
+
+    return 0;
+}
+
 } // namespace db
 } // namespace core
 } // namespace black_library
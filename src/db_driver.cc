@@ -1,40 +1,74 @@
 /**
  * db_driver.cc
- * 
- * deprecated 2022-02-14
+ *
+ * replays a workload trace recorded by BlackLibraryDB (db_workload_path) through a BlackLibraryDB opened
+ * on a copy of a catalog and reports throughput and tail latency as json. The catalog should be a snapshot
+ * taken when the recording started so the recorded calls find the rows they found in production
  */
 
 #include <getopt.h>
 #include <string.h>
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <unordered_set>
+
+#include <sqlite3.h>
 
 #include <ConfigOperations.h>
+#include <LogOperations.h>
 
 #include <BlackLibraryDB.h>
+#include <DBStats.h>
+#include <DBWorkload.h>
 
+namespace BlackLibraryCommon = black_library::core::common;
 namespace BlackLibraryDB = black_library::core::db;
 
 struct options
 {
+    std::string trace_path = "";
     std::string config_path = "";
-    bool print_config = false;
+    std::string db_path = "";
+    std::string copy_path = "";
+    std::string output_path = "";
+    size_t threads = 1;
+    size_t read_pool_size = BlackLibraryDB::DefaultDBReadPoolSize;
+    double speed = 1.0;
+    bool paced = false;
+};
+
+struct ReplayResults
+{
+    BlackLibraryDB::DBLatencyHistogram latency;
+    BlackLibraryDB::DBLatencyHistogram schedule_lag;
+    std::atomic<uint64_t> failures{ 0 };
 };
 
 static void Usage(const char *prog)
 {
     const char *p = strchr(prog, '/');
-    printf("usage: %s --(c)onfig --[p]rint_config [-h]\n", p ? (p + 1) : prog);
+    printf("usage: %s --(t)race --(d)b_path --[c]opy_path --[C]onfig --[j]obs --[p]aced --[s]peed --[r]ead_pool --[o]utput [-h]\n", p ? (p + 1) : prog);
 }
 
 static int ParseOptions(int argc, char **argv, struct options *opts)
 {
-    static const char *const optstr = "c:hp";
+    static const char *const optstr = "C:c:d:hj:o:pr:s:t:";
     static const struct option long_opts[] = {
-        { "config", required_argument, 0, 'c' },
+        { "config", required_argument, 0, 'C' },
+        { "copy_path", required_argument, 0, 'c' },
+        { "db_path", required_argument, 0, 'd' },
         { "help", no_argument, 0, 'h' },
-        { "print_config", no_argument, 0, 'p' },
+        { "jobs", required_argument, 0, 'j' },
+        { "output", required_argument, 0, 'o' },
+        { "paced", no_argument, 0, 'p' },
+        { "read_pool", required_argument, 0, 'r' },
+        { "speed", required_argument, 0, 's' },
+        { "trace", required_argument, 0, 't' },
         { 0, 0, 0, 0 }
     };
 
@@ -46,15 +80,36 @@ static int ParseOptions(int argc, char **argv, struct options *opts)
     {
         switch (opt)
         {
-            case 'c':
+            case 'C':
                 opts->config_path = std::string(optarg);
                 break;
+            case 'c':
+                opts->copy_path = std::string(optarg);
+                break;
+            case 'd':
+                opts->db_path = std::string(optarg);
+                break;
             case 'h':
                 Usage(argv[0]);
                 exit(0);
                 break;
+            case 'j':
+                opts->threads = std::stoul(optarg);
+                break;
+            case 'o':
+                opts->output_path = std::string(optarg);
+                break;
             case 'p':
-                opts->print_config = true;
+                opts->paced = true;
+                break;
+            case 'r':
+                opts->read_pool_size = std::stoul(optarg);
+                break;
+            case 's':
+                opts->speed = std::stod(optarg);
+                break;
+            case 't':
+                opts->trace_path = std::string(optarg);
                 break;
             default:
                 exit(1);
@@ -68,9 +123,89 @@ static int ParseOptions(int argc, char **argv, struct options *opts)
         exit(1);
     }
 
+    if (opts->trace_path.empty() || opts->db_path.empty())
+    {
+        fprintf(stderr, "trace and db_path are required\n");
+        exit(1);
+    }
+
+    if (opts->threads == 0 || opts->speed <= 0)
+    {
+        fprintf(stderr, "jobs and speed must be positive\n");
+        exit(1);
+    }
+
+    if (opts->copy_path.empty())
+        opts->copy_path = opts->db_path + ".replay";
+
     return 0;
 }
 
+// the replay writes to its own copy, uncheckpointed pages in the source wal come along
+static int CopyCatalog(const std::string &db_path, const std::string &copy_path)
+{
+    std::error_code ec;
+
+    for (const auto &suffix : { "", "-wal", "-shm" })
+    {
+        std::filesystem::remove(copy_path + suffix, ec);
+    }
+
+    if (!std::filesystem::copy_file(db_path, copy_path, ec))
+    {
+        fprintf(stderr, "failed to copy %s to %s: %s\n", db_path.c_str(), copy_path.c_str(), ec.message().c_str());
+        return -1;
+    }
+
+    if (std::filesystem::exists(db_path + "-wal") && !std::filesystem::copy_file(db_path + "-wal", copy_path + "-wal", ec))
+    {
+        fprintf(stderr, "failed to copy %s-wal: %s\n", db_path.c_str(), ec.message().c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+static njson LatencyToJson(const BlackLibraryDB::DBLatencyStats &stats)
+{
+    njson j;
+
+    j["count"] = stats.count;
+    j["mean_us"] = stats.mean_us;
+    j["p50_us"] = stats.p50_us;
+    j["p90_us"] = stats.p90_us;
+    j["p99_us"] = stats.p99_us;
+    j["max_us"] = stats.max_ns / 1000.0;
+
+    return j;
+}
+
+// each recorded thread replays on worker thread % jobs so calls that depended on each other stay in order,
+// paced replay holds each record until its recorded offset
+static void ReplayWorker(BlackLibraryDB::BlackLibraryDB &db, const std::vector<BlackLibraryDB::DBWorkloadRecord> &records,
+    size_t worker, std::chrono::steady_clock::time_point start, const options &opts, ReplayResults &results)
+{
+    for (const auto &record : records)
+    {
+        if (record.thread % opts.threads != worker)
+            continue;
+
+        if (opts.paced)
+        {
+            const auto scheduled = start + std::chrono::nanoseconds(static_cast<uint64_t>(record.offset_ns / opts.speed));
+            std::this_thread::sleep_until(scheduled);
+            results.schedule_lag.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - scheduled).count());
+        }
+
+        const auto op_start = std::chrono::steady_clock::now();
+        const int res = BlackLibraryDB::ReplayDBWorkloadRecord(db, record);
+        results.latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - op_start).count());
+
+        if (res)
+            results.failures.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     struct options opts;
@@ -87,81 +222,103 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    std::ifstream in_file(opts.config_path);
-    njson config;
-    in_file >> config;
+    BlackLibraryCommon::InitRotatingLogger("db", BlackLibraryCommon::DefaultLogPath, false);
 
-    if (opts.print_config)
+    std::vector<BlackLibraryDB::DBWorkloadRecord> records;
+    if (BlackLibraryDB::ReadDBWorkload(opts.trace_path, records))
     {
-        std::cout << config.dump(4) << std::endl;
+        fprintf(stderr, "failed to read workload trace %s\n", opts.trace_path.c_str());
+        exit(1);
     }
 
-    BlackLibraryDB::DBEntry create_staging_entry;
-    BlackLibraryDB::DBEntry read_staging_entry;
-    BlackLibraryDB::DBEntry update_staging_entry;
-
-    std::cout << "Starting db" << std::endl;
-    BlackLibraryDB::BlackLibraryDB blacklibrarydb(config);
-
-    create_staging_entry.uuid = "55ee59ad-2feb-4196-960b-3226c65c80d5";
-    create_staging_entry.title = "foo2";
-    create_staging_entry.nickname = "foo3";
-    create_staging_entry.source = "foo4";
-    create_staging_entry.url = "foo5";
-    create_staging_entry.last_url = "foo8";
-    create_staging_entry.series = "the foo";
-    create_staging_entry.series_length = 2;
-    create_staging_entry.version = 1;
-    create_staging_entry.media_path = "foo6";
-    create_staging_entry.birth_date = 0;
-    create_staging_entry.check_date = 1;
-    create_staging_entry.update_date = 2;
-    create_staging_entry.user_contributed = 4004;
-
-    // blacklibrarydb.CreateStagingEntry(create_staging_entry);
-
-    // second time should fail
-    // blacklibrarydb.CreateStagingEntry(create_staging_entry);
-
-    read_staging_entry = blacklibrarydb.ReadStagingEntry("55ee59ad-2feb-4196-960b-3226c65c80d5");
-
-    std::cout << read_staging_entry << std::endl;
-
-    bool check0 = blacklibrarydb.DoesStagingEntryUrlExist("foo5");
-    bool check1 = blacklibrarydb.DoesStagingEntryUrlExist("foo6");
-
-    std::cout << "url foo5 exists: " << check0 << std::endl;
-    std::cout << "url foo6 exists: " << check1 << std::endl;
+    if (CopyCatalog(opts.db_path, opts.copy_path))
+        exit(1);
 
-    // update read_staging_entry
-    read_staging_entry.title = "2foo";
-    read_staging_entry.nickname = "3foo";
-    read_staging_entry.source = "4foo";
-    read_staging_entry.url = "5foo";
-    read_staging_entry.last_url = "8foo";
-    read_staging_entry.series = "the bar";
-    read_staging_entry.series_length = 3;
-    read_staging_entry.version = 2;
-    read_staging_entry.media_path = "6foo";
-    read_staging_entry.birth_date = 10;
-    read_staging_entry.check_date = 11;
-    read_staging_entry.update_date = 12;
-    read_staging_entry.user_contributed = 4004;
+    std::unordered_set<uint32_t> recorded_threads;
+    for (const auto &record : records)
+    {
+        recorded_threads.emplace(record.thread);
+    }
 
-    blacklibrarydb.UpdateStagingEntry(read_staging_entry);
+    std::cerr << "Replaying " << records.size() << " records on " << opts.threads << " threads" << std::endl;
 
-    update_staging_entry = blacklibrarydb.ReadStagingEntry("55ee59ad-2feb-4196-960b-3226c65c80d5");
+    // replay with the production settings (entry cache, url index) when a config is given, never record the replay
+    njson config;
+    config["config"] = njson::object();
+    if (!opts.config_path.empty())
+    {
+        std::ifstream config_in(opts.config_path);
+        const njson file_config = njson::parse(config_in, nullptr, false);
+        if (file_config.is_discarded() || !file_config.is_object())
+        {
+            fprintf(stderr, "failed to parse config %s\n", opts.config_path.c_str());
+            exit(1);
+        }
+        config["config"] = BlackLibraryCommon::LoadConfig(file_config);
+    }
+    config["config"]["db_path"] = opts.copy_path;
+    config["config"]["db_read_pool_size"] = opts.read_pool_size;
+    config["config"].erase("db_workload_path");
 
-    std::cout << read_staging_entry << std::endl;
+    BlackLibraryDB::BlackLibraryDB db(config);
+    if (!db.IsReady())
+    {
+        fprintf(stderr, "failed to open catalog copy %s\n", opts.copy_path.c_str());
+        exit(1);
+    }
 
-    blacklibrarydb.DeleteStagingEntry("55ee59ad-2feb-4196-960b-3226c65c80d5");
-    blacklibrarydb.DeleteStagingEntry("75ee5fad-2deb-4436-120c-3226ceeeaed6");
+    ReplayResults results;
+    std::vector<std::thread> workers;
 
-    read_staging_entry = blacklibrarydb.ReadStagingEntry("55ee59ad-2feb-4196-960b-3226c65c80d5");
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < opts.threads; ++i)
+    {
+        workers.emplace_back(ReplayWorker, std::ref(db), std::cref(records), i, start, std::cref(opts), std::ref(results));
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    njson report;
+    report["tool"] = "db_driver";
+    report["sqlite_version"] = sqlite3_libversion();
+    report["trace"] = opts.trace_path;
+    report["records"] = records.size();
+    report["recorded_threads"] = recorded_threads.size();
+    report["recorded_seconds"] = records.empty() ? 0 : records.back().offset_ns / 1e9;
+    report["threads"] = opts.threads;
+    report["paced"] = opts.paced;
+    report["speed"] = opts.speed;
+    report["elapsed_seconds"] = elapsed_seconds;
+    report["ops_per_sec"] = elapsed_seconds > 0 ? records.size() / elapsed_seconds : 0;
+    report["failures"] = results.failures.load();
+    report["latency"] = LatencyToJson(results.latency.GetStats());
+    if (opts.paced)
+        report["schedule_lag"] = LatencyToJson(results.schedule_lag.GetStats());
+
+    report["operations"] = njson::object();
+    // counted below the facade, so cache hits are missing and url index maintenance shows up
+    for (const auto &operation : db.GetStats().operations)
+    {
+        if (operation.calls == 0)
+            continue;
 
-    std::cout << read_staging_entry << std::endl;
+        report["operations"][operation.name]["calls"] = operation.calls;
+        report["operations"][operation.name]["errors"] = operation.errors;
+        report["operations"][operation.name]["latency"] = LatencyToJson(operation.latency);
+    }
 
-    std::cout << "Closing application" << std::endl;
+    if (opts.output_path.empty())
+    {
+        std::cout << report.dump(4) << std::endl;
+    }
+    else
+    {
+        std::ofstream out(opts.output_path);
+        out << report.dump(4) << std::endl;
+    }
 
     return 0;
 }
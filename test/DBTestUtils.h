@@ -23,6 +23,7 @@ njson GenerateDBTestConfig()
     j["config"]["db_path"] = DefaultTestDBPath;
     j["config"]["logger_path"] = "/tmp/";
     j["config"]["db_debug_log"] = false;
+    j["config"]["db_read_pool_size"] = 2;
     return j;
 }
 
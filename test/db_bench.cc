@@ -0,0 +1,667 @@
+/**
+ * db_bench.cc
+ *
+ * throughput and latency benchmarks for SQLiteDB and BlackLibraryDB over synthetic catalogs,
+ * --threads adds a read contention run of BlackLibraryDB lookups at each thread count.
+ * results are written as json so they can be tracked across releases
+ */
+
+#include <getopt.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <sqlite3.h>
+
+#include <ConfigOperations.h>
+#include <FileOperations.h>
+#include <LogOperations.h>
+
+#include <BlackLibraryDB.h>
+#include <SQLiteDB.h>
+
+namespace BlackLibraryCommon = black_library::core::common;
+namespace BlackLibraryDB = black_library::core::db;
+
+static constexpr const char DefaultBenchDBPath[] = "/tmp/db_bench.db";
+static constexpr const char DefaultBenchCatalogSizes[] = "10000,100000,1000000";
+
+static constexpr const size_t DefaultBenchOps = 10000;
+static constexpr const size_t DefaultBenchListOps = 3;
+static constexpr const size_t DefaultBenchMd5Fanout = 8;
+static constexpr const size_t BenchMaxMd5Fanout = 256;
+static constexpr const size_t BenchPageSize = 100;
+static constexpr const size_t BenchSeedBatchSize = 1000;
+static constexpr const time_t BenchRefreshBaseDate = 1600000000;
+
+struct options
+{
+    std::string db_path = DefaultBenchDBPath;
+    std::string output_path = "";
+    std::string catalog_sizes = DefaultBenchCatalogSizes;
+    std::string thread_counts = "";
+    size_t ops = DefaultBenchOps;
+    size_t list_ops = DefaultBenchListOps;
+    size_t md5_fanout = DefaultBenchMd5Fanout;
+    uint64_t seed = 4004;
+    bool sqlite_only = false;
+};
+
+struct BenchCatalog
+{
+    size_t size = 0;
+    size_t md5_rows = 0;
+    std::vector<size_t> md5_fanout;
+};
+
+// latencies of one operation, in nanoseconds
+struct BenchTimings
+{
+    std::vector<uint64_t> latencies;
+    uint64_t total_ns = 0;
+    size_t failures = 0;
+};
+
+static void Usage(const char *prog)
+{
+    const char *p = strchr(prog, '/');
+    printf("usage: %s --[d]b_path --[s]izes 10000,100000 --(n)um_ops --[l]ist_ops --[f]anout --[r]andom_seed --[o]utput --sqlite_[O]nly --[t]hreads 1,2,4,8 [-h]\n", p ? (p + 1) : prog);
+}
+
+static int ParseOptions(int argc, char **argv, struct options *opts)
+{
+    static const char *const optstr = "d:f:hl:n:o:Or:s:t:";
+    static const struct option long_opts[] = {
+        { "db_path", required_argument, 0, 'd' },
+        { "fanout", required_argument, 0, 'f' },
+        { "help", no_argument, 0, 'h' },
+        { "list_ops", required_argument, 0, 'l' },
+        { "num_ops", required_argument, 0, 'n' },
+        { "output", required_argument, 0, 'o' },
+        { "sqlite_only", no_argument, 0, 'O' },
+        { "random_seed", required_argument, 0, 'r' },
+        { "sizes", required_argument, 0, 's' },
+        { "threads", required_argument, 0, 't' },
+        { 0, 0, 0, 0 }
+    };
+
+    if (!argv || !opts)
+        return -1;
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, optstr, long_opts, 0)) >= 0)
+    {
+        switch (opt)
+        {
+            case 'd':
+                opts->db_path = std::string(optarg);
+                break;
+            case 'f':
+                opts->md5_fanout = std::stoul(optarg);
+                break;
+            case 'h':
+                Usage(argv[0]);
+                exit(0);
+                break;
+            case 'l':
+                opts->list_ops = std::stoul(optarg);
+                break;
+            case 'n':
+                opts->ops = std::stoul(optarg);
+                break;
+            case 'o':
+                opts->output_path = std::string(optarg);
+                break;
+            case 'O':
+                opts->sqlite_only = true;
+                break;
+            case 'r':
+                opts->seed = std::stoull(optarg);
+                break;
+            case 's':
+                opts->catalog_sizes = std::string(optarg);
+                break;
+            case 't':
+                opts->thread_counts = std::string(optarg);
+                break;
+            default:
+                exit(1);
+                break;
+        }
+    }
+
+    if (optind < argc)
+    {
+        fprintf(stderr, "trailing options..\n");
+        exit(1);
+    }
+
+    if (opts->ops == 0 || opts->md5_fanout == 0 || opts->md5_fanout > BenchMaxMd5Fanout)
+    {
+        fprintf(stderr, "num_ops must be positive and fanout must be between 1 and %zu\n", BenchMaxMd5Fanout);
+        exit(1);
+    }
+
+    return 0;
+}
+
+static std::vector<size_t> ParseSizeList(const std::string &size_list)
+{
+    std::vector<size_t> sizes;
+    std::stringstream ss(size_list);
+    std::string size;
+
+    while (std::getline(ss, size, ','))
+    {
+        if (size.empty())
+            continue;
+        sizes.emplace_back(std::stoul(size));
+    }
+
+    return sizes;
+}
+
+static std::string BenchUUID(size_t index)
+{
+    char uuid[64];
+    snprintf(uuid, sizeof(uuid), "%08x-0000-4000-8000-%012zx", static_cast<uint32_t>(index), index);
+
+    return std::string(uuid);
+}
+
+static std::string BenchUrl(size_t index)
+{
+    return "https://bench.blacklibrary.local/source-" + std::to_string(index % 7) + "/work/" + std::to_string(index);
+}
+
+static BlackLibraryDB::DBEntry BenchEntry(size_t index)
+{
+    BlackLibraryDB::DBEntry entry;
+
+    entry.uuid = BenchUUID(index);
+    entry.title = "bench-title-" + std::to_string(index);
+    entry.author = "bench-author-" + std::to_string(index % 997);
+    entry.nickname = "";
+    entry.source = "source-" + std::to_string(index % 7);
+    entry.url = BenchUrl(index);
+    entry.last_url = entry.url + "/chapter/1";
+    entry.series = "bench-series-" + std::to_string(index % 101);
+    entry.series_length = 1;
+    entry.version = 1;
+    entry.media_path = "/mnt/black-library/store/" + entry.uuid;
+    entry.birth_date = BenchRefreshBaseDate;
+    entry.check_date = BenchRefreshBaseDate;
+    entry.update_date = BenchRefreshBaseDate;
+    entry.user_contributed = 4004;
+
+    return entry;
+}
+
+static std::vector<BlackLibraryDB::DBMd5Sum> BenchMd5Sums(size_t index, size_t fanout, uint16_t version_num)
+{
+    std::vector<BlackLibraryDB::DBMd5Sum> md5s;
+    md5s.reserve(fanout);
+
+    const std::string uuid = BenchUUID(index);
+    for (size_t i = 0; i < fanout; ++i)
+    {
+        BlackLibraryDB::DBMd5Sum md5;
+        md5.uuid = uuid;
+        md5.index_num = i;
+        md5.md5_sum = uuid.substr(0, 24) + std::to_string(version_num * 1000 + i);
+        md5.version_num = version_num;
+        md5s.emplace_back(md5);
+    }
+
+    return md5s;
+}
+
+// most works have a handful of sections and a few have hundreds, a geometric distribution
+// around the requested mean matches a scraped catalog well enough
+static BenchCatalog GenerateCatalog(size_t size, size_t mean_fanout, std::mt19937_64 &rng)
+{
+    BenchCatalog catalog;
+    catalog.size = size;
+    catalog.md5_fanout.reserve(size);
+
+    std::geometric_distribution<size_t> fanout_dist(1.0 / mean_fanout);
+    for (size_t i = 0; i < size; ++i)
+    {
+        const size_t fanout = std::min(BenchMaxMd5Fanout, fanout_dist(rng) + 1);
+        catalog.md5_fanout.emplace_back(fanout);
+        catalog.md5_rows += fanout;
+    }
+
+    return catalog;
+}
+
+static int SeedCatalog(const std::string &db_path, const BenchCatalog &catalog)
+{
+    BlackLibraryCommon::RemovePath(db_path);
+    BlackLibraryCommon::RemovePath(db_path + "-wal");
+    BlackLibraryCommon::RemovePath(db_path + "-shm");
+
+    BlackLibraryDB::SQLiteDB db(db_path);
+    if (!db.IsReady())
+        return -1;
+
+    std::vector<BlackLibraryDB::DBEntry> entries;
+    entries.reserve(BenchSeedBatchSize);
+    for (size_t i = 0; i < catalog.size; ++i)
+    {
+        entries.emplace_back(BenchEntry(i));
+        if (entries.size() < BenchSeedBatchSize && i + 1 < catalog.size)
+            continue;
+
+        for (const auto &res : db.CreateEntries(entries, BlackLibraryDB::BLACK_ENTRY))
+        {
+            if (res)
+                return -1;
+        }
+        entries.clear();
+    }
+
+    for (size_t i = 0; i < catalog.size; ++i)
+    {
+        if (db.UpsertMd5Sums(BenchUUID(i), BenchMd5Sums(i, catalog.md5_fanout[i], 1)))
+            return -1;
+    }
+
+    for (size_t i = 0; i < catalog.size; i += 10)
+    {
+        BlackLibraryDB::DBRefresh refresh;
+        refresh.uuid = BenchUUID(i);
+        refresh.refresh_date = BenchRefreshBaseDate + i;
+        if (db.CreateRefresh(refresh))
+            return -1;
+    }
+
+    return 0;
+}
+
+// the operations under test, SQLiteDB and BlackLibraryDB are adapted to the same shape
+struct BenchTarget
+{
+    std::string name;
+    std::function<int(const BlackLibraryDB::DBEntry &)> create_entry;
+    std::function<bool(const std::string &)> read_entry;
+    std::function<int(const BlackLibraryDB::DBEntry &)> update_entry;
+    std::function<int(const std::string &)> delete_entry;
+    std::function<bool(const std::string &)> url_exists;
+    std::function<size_t(const std::string &)> list_page;
+    std::function<size_t()> list_all;
+    std::function<size_t(const std::string &)> read_checksums;
+    std::function<int(const std::string &, const std::vector<BlackLibraryDB::DBMd5Sum> &)> upsert_checksums;
+    std::function<int(const BlackLibraryDB::DBRefresh &)> create_refresh;
+    std::function<size_t(time_t)> due_refreshes;
+    std::function<int(const std::string &)> delete_refresh;
+};
+
+static BenchTarget SQLiteBenchTarget(const BlackLibraryDB::SQLiteDB &db)
+{
+    BenchTarget target;
+    target.name = "SQLiteDB";
+
+    target.create_entry = [&db](const BlackLibraryDB::DBEntry &entry) { return db.CreateEntry(entry, BlackLibraryDB::BLACK_ENTRY); };
+    target.read_entry = [&db](const std::string &uuid) { return db.ReadEntry(uuid, BlackLibraryDB::BLACK_ENTRY).uuid == uuid; };
+    target.update_entry = [&db](const BlackLibraryDB::DBEntry &entry) { return db.UpdateEntry(entry, BlackLibraryDB::BLACK_ENTRY); };
+    target.delete_entry = [&db](const std::string &uuid) { return db.DeleteEntry(uuid, BlackLibraryDB::BLACK_ENTRY); };
+    target.url_exists = [&db](const std::string &url) { return db.DoesEntryUrlExist(url, BlackLibraryDB::BLACK_ENTRY).result; };
+    target.list_page = [&db](const std::string &after_uuid) {
+        std::vector<BlackLibraryDB::DBEntry> entries;
+        db.ListEntriesPage(BlackLibraryDB::BLACK_ENTRY, after_uuid, BenchPageSize, entries);
+        return entries.size();
+    };
+    target.list_all = [&db]() {
+        size_t count = 0;
+        db.ForEachEntryView(BlackLibraryDB::BLACK_ENTRY, BlackLibraryDB::AllEntryColumns, [&count](const BlackLibraryDB::DBEntryView &) { ++count; return true; });
+        return count;
+    };
+    target.read_checksums = [&db](const std::string &uuid) {
+        std::vector<BlackLibraryDB::DBMd5Sum> md5s;
+        db.GetMd5SumsForUUID(uuid, md5s);
+        return md5s.size();
+    };
+    target.upsert_checksums = [&db](const std::string &uuid, const std::vector<BlackLibraryDB::DBMd5Sum> &md5s) { return db.UpsertMd5Sums(uuid, md5s); };
+    target.create_refresh = [&db](const BlackLibraryDB::DBRefresh &refresh) { return db.CreateRefresh(refresh); };
+    target.due_refreshes = [&db](time_t now) {
+        std::vector<BlackLibraryDB::DBRefresh> refreshes;
+        db.GetDueRefreshes(now, BenchPageSize, refreshes);
+        return refreshes.size();
+    };
+    target.delete_refresh = [&db](const std::string &uuid) { return db.DeleteRefresh(uuid); };
+
+    return target;
+}
+
+static BenchTarget BlackLibraryBenchTarget(BlackLibraryDB::BlackLibraryDB &db)
+{
+    BenchTarget target;
+    target.name = "BlackLibraryDB";
+
+    target.create_entry = [&db](const BlackLibraryDB::DBEntry &entry) { return db.CreateBlackEntry(entry); };
+    target.read_entry = [&db](const std::string &uuid) { return db.ReadBlackEntry(uuid).uuid == uuid; };
+    target.update_entry = [&db](const BlackLibraryDB::DBEntry &entry) { return db.UpdateBlackEntry(entry); };
+    target.delete_entry = [&db](const std::string &uuid) { return db.DeleteBlackEntry(uuid); };
+    target.url_exists = [&db](const std::string &url) { return db.DoesBlackEntryUrlExist(url); };
+    target.list_page = [&db](const std::string &after_uuid) { return db.GetBlackEntryPage(after_uuid, BenchPageSize).size(); };
+    target.list_all = [&db]() {
+        size_t count = 0;
+        db.ForEachBlackEntryView(BlackLibraryDB::AllEntryColumns, [&count](const BlackLibraryDB::DBEntryView &) { ++count; return true; });
+        return count;
+    };
+    target.read_checksums = [&db](const std::string &uuid) { return db.GetMd5SumsForUUID(uuid).size(); };
+    target.upsert_checksums = [&db](const std::string &uuid, const std::vector<BlackLibraryDB::DBMd5Sum> &md5s) { return db.UpsertMd5Sums(uuid, md5s); };
+    target.create_refresh = [&db](const BlackLibraryDB::DBRefresh &refresh) { return db.CreateRefresh(refresh); };
+    target.due_refreshes = [&db](time_t now) { return db.GetDueRefreshes(now, BenchPageSize).size(); };
+    target.delete_refresh = [&db](const std::string &uuid) { return db.DeleteRefresh(uuid); };
+
+    return target;
+}
+
+// op returns true on success
+static BenchTimings TimeOps(size_t ops, const std::function<bool(size_t)> &op)
+{
+    BenchTimings timings;
+    timings.latencies.reserve(ops);
+
+    for (size_t i = 0; i < ops; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = op(i);
+        const auto end = std::chrono::steady_clock::now();
+
+        const uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        timings.latencies.emplace_back(latency);
+        timings.total_ns += latency;
+        if (!ok)
+            ++timings.failures;
+    }
+
+    return timings;
+}
+
+static double Percentile(const std::vector<uint64_t> &sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0;
+
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(percentile * sorted.size()));
+
+    return sorted[index] / 1000.0;
+}
+
+static njson SummarizeTimings(BenchTimings timings)
+{
+    njson j;
+
+    std::sort(timings.latencies.begin(), timings.latencies.end());
+
+    j["ops"] = timings.latencies.size();
+    j["failures"] = timings.failures;
+    j["ops_per_sec"] = timings.total_ns ? timings.latencies.size() * 1e9 / timings.total_ns : 0;
+    j["p50_us"] = Percentile(timings.latencies, 0.50);
+    j["p99_us"] = Percentile(timings.latencies, 0.99);
+
+    return j;
+}
+
+// every mutating operation works on entries past the end of the catalog or puts the catalog
+// back the way it found it, so each target sees the same data
+static njson RunBenchTarget(const BenchTarget &target, const BenchCatalog &catalog, const options &opts)
+{
+    njson j;
+    std::mt19937_64 rng(opts.seed);
+    std::uniform_int_distribution<size_t> catalog_dist(0, catalog.size - 1);
+
+    std::vector<size_t> picks(opts.ops);
+    for (auto &pick : picks)
+    {
+        pick = catalog_dist(rng);
+    }
+
+    const size_t first_new = catalog.size;
+
+    std::cerr << "  " << target.name << std::endl;
+
+    j["target"] = target.name;
+
+    j["operations"]["create"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.create_entry(BenchEntry(first_new + i)) == 0;
+    }));
+
+    j["operations"]["read"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.read_entry(BenchUUID(picks[i]));
+    }));
+
+    j["operations"]["update"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        BlackLibraryDB::DBEntry entry = BenchEntry(first_new + i);
+        entry.title += "-updated";
+        entry.version = 2;
+        entry.update_date = BenchRefreshBaseDate + i;
+        return target.update_entry(entry) == 0;
+    }));
+
+    // half of the lookups miss
+    j["operations"]["url_exists"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        const bool expected = i % 2 == 0;
+        const size_t index = expected ? picks[i] : first_new + opts.ops + picks[i];
+        return target.url_exists(BenchUrl(index)) == expected;
+    }));
+
+    j["operations"]["delete"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.delete_entry(BenchUUID(first_new + i)) == 0;
+    }));
+
+    j["operations"]["list_page"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.list_page(BenchUUID(picks[i])) > 0 || picks[i] + 1 == catalog.size;
+    }));
+
+    j["operations"]["list_all"] = SummarizeTimings(TimeOps(opts.list_ops, [&](size_t) {
+        return target.list_all() == catalog.size;
+    }));
+
+    j["operations"]["checksum_read"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.read_checksums(BenchUUID(picks[i])) == catalog.md5_fanout[picks[i]];
+    }));
+
+    // rewrites every checksum of the entry, as a completed refresh would
+    j["operations"]["checksum_upsert"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.upsert_checksums(BenchUUID(picks[i]), BenchMd5Sums(picks[i], catalog.md5_fanout[picks[i]], 1 + i % 2)) == 0;
+    }));
+
+    j["operations"]["refresh_create"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        BlackLibraryDB::DBRefresh refresh;
+        refresh.uuid = BenchUUID(first_new + i);
+        refresh.refresh_date = BenchRefreshBaseDate + picks[i];
+        return target.create_refresh(refresh) == 0;
+    }));
+
+    j["operations"]["refresh_due"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        target.due_refreshes(BenchRefreshBaseDate + picks[i]);
+        return true;
+    }));
+
+    j["operations"]["refresh_delete"] = SummarizeTimings(TimeOps(opts.ops, [&](size_t i) {
+        return target.delete_refresh(BenchUUID(first_new + i)) == 0;
+    }));
+
+    return j;
+}
+
+// every thread runs its own lookups against one shared instance, cycling through an entry read, a url
+// check and a checksum read, so read throughput shows how far the shared lock lets readers scale
+static njson RunReadContention(const BenchTarget &target, const BenchCatalog &catalog, const options &opts, const std::vector<size_t> &thread_counts)
+{
+    njson j = njson::array();
+
+    for (const auto &threads : thread_counts)
+    {
+        std::cerr << "  read contention " << threads << " threads" << std::endl;
+
+        std::vector<BenchTimings> thread_timings(threads);
+        std::vector<std::thread> workers;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&target, &catalog, &opts, &thread_timings, t]() {
+                std::mt19937_64 rng(opts.seed + t);
+                std::uniform_int_distribution<size_t> catalog_dist(0, catalog.size - 1);
+
+                thread_timings[t] = TimeOps(opts.ops, [&](size_t i) {
+                    const size_t pick = catalog_dist(rng);
+                    switch (i % 3)
+                    {
+                        case 0:
+                            return target.read_entry(BenchUUID(pick));
+                        case 1:
+                            return target.url_exists(BenchUrl(pick));
+                        default:
+                            return target.read_checksums(BenchUUID(pick)) == catalog.md5_fanout[pick];
+                    }
+                });
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        BenchTimings timings;
+        for (auto &thread_timing : thread_timings)
+        {
+            timings.latencies.insert(timings.latencies.end(), thread_timing.latencies.begin(), thread_timing.latencies.end());
+            timings.total_ns += thread_timing.total_ns;
+            timings.failures += thread_timing.failures;
+        }
+
+        // throughput over wall time, SummarizeTimings would report the single thread rate
+        const size_t ops = timings.latencies.size();
+        njson result = SummarizeTimings(std::move(timings));
+        result["threads"] = threads;
+        result["wall_seconds"] = wall_seconds;
+        result["ops_per_sec"] = wall_seconds > 0 ? ops / wall_seconds : 0;
+        result["ops_per_sec_per_thread"] = wall_seconds > 0 ? ops / wall_seconds / threads : 0;
+        j.emplace_back(result);
+    }
+
+    return j;
+}
+
+static njson RunBenchCatalog(size_t size, const options &opts)
+{
+    njson j;
+    std::mt19937_64 rng(opts.seed + size);
+
+    std::cerr << "catalog " << size << std::endl;
+
+    const BenchCatalog catalog = GenerateCatalog(size, opts.md5_fanout, rng);
+
+    j["catalog_size"] = catalog.size;
+    j["md5_rows"] = catalog.md5_rows;
+
+    auto start = std::chrono::steady_clock::now();
+    if (SeedCatalog(opts.db_path, catalog))
+    {
+        j["error"] = "failed to seed catalog";
+        return j;
+    }
+    j["seed_seconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    {
+        BlackLibraryDB::SQLiteDB db(opts.db_path);
+        j["targets"].emplace_back(RunBenchTarget(SQLiteBenchTarget(db), catalog, opts));
+    }
+
+    if (opts.sqlite_only)
+        return j;
+
+    njson config;
+    config["config"]["db_path"] = opts.db_path;
+    config["config"]["logger_path"] = BlackLibraryCommon::DefaultLogPath;
+    config["config"]["db_debug_log"] = false;
+
+    // one pooled read connection per reader so the contention run measures the lock, not the pool
+    const std::vector<size_t> thread_counts = ParseSizeList(opts.thread_counts);
+    if (!thread_counts.empty())
+        config["config"]["db_read_pool_size"] = std::max(BlackLibraryDB::DefaultDBReadPoolSize, *std::max_element(thread_counts.begin(), thread_counts.end()));
+
+    start = std::chrono::steady_clock::now();
+    BlackLibraryDB::BlackLibraryDB blacklibrarydb(config);
+    const double open_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    njson target = RunBenchTarget(BlackLibraryBenchTarget(blacklibrarydb), catalog, opts);
+    target["open_seconds"] = open_seconds;
+    if (!thread_counts.empty())
+        target["read_contention"] = RunReadContention(BlackLibraryBenchTarget(blacklibrarydb), catalog, opts, thread_counts);
+    j["targets"].emplace_back(target);
+
+    return j;
+}
+
+int main(int argc, char *argv[])
+{
+    struct options opts;
+
+    if (ParseOptions(argc, argv, &opts))
+    {
+        Usage(argv[0]);
+        exit(1);
+    }
+
+    const std::vector<size_t> sizes = ParseSizeList(opts.catalog_sizes);
+    if (sizes.empty() || std::find(sizes.begin(), sizes.end(), 0) != sizes.end())
+    {
+        fprintf(stderr, "sizes must be a comma separated list of positive catalog sizes\n");
+        exit(1);
+    }
+
+    const std::vector<size_t> thread_counts = ParseSizeList(opts.thread_counts);
+    if (std::find(thread_counts.begin(), thread_counts.end(), 0) != thread_counts.end())
+    {
+        fprintf(stderr, "threads must be a comma separated list of positive thread counts\n");
+        exit(1);
+    }
+
+    BlackLibraryCommon::InitRotatingLogger("db", BlackLibraryCommon::DefaultLogPath, false);
+
+    njson results;
+    results["benchmark"] = "db_bench";
+    results["sqlite_version"] = sqlite3_libversion();
+    results["options"]["ops"] = opts.ops;
+    results["options"]["list_ops"] = opts.list_ops;
+    results["options"]["md5_fanout"] = opts.md5_fanout;
+    results["options"]["page_size"] = BenchPageSize;
+    results["options"]["seed"] = opts.seed;
+    results["options"]["threads"] = thread_counts;
+    results["catalogs"] = njson::array();
+
+    for (const auto &size : sizes)
+    {
+        results["catalogs"].emplace_back(RunBenchCatalog(size, opts));
+    }
+
+    BlackLibraryCommon::RemovePath(opts.db_path);
+    BlackLibraryCommon::RemovePath(opts.db_path + "-wal");
+    BlackLibraryCommon::RemovePath(opts.db_path + "-shm");
+
+    if (opts.output_path.empty())
+    {
+        std::cout << results.dump(4) << std::endl;
+        return 0;
+    }
+
+    std::ofstream out_file(opts.output_path);
+    out_file << results.dump(4) << std::endl;
+
+    return 0;
+}
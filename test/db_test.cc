@@ -2,8 +2,14 @@
  * db_test.cc
  */
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <catch2/catch_test_macros.hpp>
 
+#include <sqlite3.h>
+
 #include <FileOperations.h>
 #include <LogOperations.h>
 
@@ -103,6 +109,216 @@ TEST_CASE( "Test CRUD for staging, black, and error entry tables black library (
     REQUIRE( blacklibrary_db.DoesErrorEntryExist(error_entry.uuid, error_entry.progress_num) == false );
 }
 
+TEST_CASE( "Test batch create and update black entries black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry black_entry_0 = GenerateTestBlackEntry();
+    DBEntry black_entry_1 = GenerateTestBlackEntry();
+    black_entry_1.uuid = "9a1c6f3e-52b4-4f0e-8d7c-1b2a3c4d5e6f";
+    black_entry_1.url = "black-url-1";
+
+    REQUIRE( blacklibrary_db.CreateBlackEntries({ black_entry_0, black_entry_1 }) == std::vector<int>({ 0, 0 }) );
+    REQUIRE( blacklibrary_db.DoesBlackEntryUrlExist(black_entry_1.url) == true );
+
+    black_entry_1.title = "renamed-title";
+    REQUIRE( blacklibrary_db.UpdateBlackEntries({ black_entry_1 }) == std::vector<int>({ 0 }) );
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry_1.uuid).title == black_entry_1.title );
+
+    std::vector<std::string> scanned_uuids;
+    REQUIRE( blacklibrary_db.ForEachBlackEntry([&scanned_uuids](const DBEntry &entry)
+    {
+        scanned_uuids.emplace_back(entry.uuid);
+        return true;
+    }) == 0 );
+    REQUIRE( scanned_uuids.size() == 2 );
+
+    auto first_page = blacklibrary_db.GetBlackEntryPage("", 1);
+    REQUIRE( first_page.size() == 1 );
+    auto second_page = blacklibrary_db.GetBlackEntryPage(first_page[0].uuid, 1);
+    REQUIRE( second_page.size() == 1 );
+    REQUIRE( second_page[0].uuid > first_page[0].uuid );
+    REQUIRE( blacklibrary_db.GetBlackEntryPage(second_page[0].uuid, 1).empty() );
+
+    auto titles = blacklibrary_db.GetBlackEntryList(EntryColumnMask(DBEntryColumnID::title));
+    REQUIRE( titles.size() == 2 );
+    REQUIRE( titles[0].media_path.empty() );
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry_1.uuid, EntryColumnMask(DBEntryColumnID::title)).title == black_entry_1.title );
+
+    size_t renamed_count = 0;
+    REQUIRE( blacklibrary_db.ForEachBlackEntryView(EntryColumnMask(DBEntryColumnID::title), [&renamed_count](const DBEntryView &view)
+    {
+        if (view.title == "renamed-title")
+            ++renamed_count;
+        return true;
+    }) == 0 );
+    REQUIRE( renamed_count == 1 );
+
+    REQUIRE( blacklibrary_db.DeleteBlackEntry(black_entry_0.uuid) == 0 );
+    REQUIRE( blacklibrary_db.DeleteBlackEntry(black_entry_1.uuid) == 0 );
+}
+
+TEST_CASE( "Test entry cache black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry black_entry = GenerateTestBlackEntry();
+    REQUIRE( blacklibrary_db.CreateBlackEntry(black_entry) == 0 );
+
+    const DBEntryCacheStats initial_stats = blacklibrary_db.GetEntryCacheStats();
+
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry.uuid).title == black_entry.title );
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry.uuid).title == black_entry.title );
+    REQUIRE( blacklibrary_db.GetBlackEntryUrlFromUUID(black_entry.uuid).result == black_entry.url );
+
+    DBEntryCacheStats stats = blacklibrary_db.GetEntryCacheStats();
+    REQUIRE( stats.misses == initial_stats.misses + 1 );
+    REQUIRE( stats.hits == initial_stats.hits + 2 );
+
+    black_entry.title = "updated-title";
+    REQUIRE( blacklibrary_db.UpdateBlackEntry(black_entry) == 0 );
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry.uuid).title == black_entry.title );
+
+    REQUIRE( blacklibrary_db.DeleteBlackEntry(black_entry.uuid) == 0 );
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry.uuid).uuid.empty() );
+}
+
+TEST_CASE( "Test url index black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    const std::string old_url = staging_entry.url;
+    const std::string new_url = staging_entry.url + "-moved";
+
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(old_url) == false );
+    REQUIRE( blacklibrary_db.GetStagingEntryUUIDFromUrl(old_url).does_not_exist == true );
+
+    REQUIRE( blacklibrary_db.CreateStagingEntry(staging_entry) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(old_url) == true );
+    REQUIRE( blacklibrary_db.DoesBlackEntryUrlExist(old_url) == false );
+    REQUIRE( blacklibrary_db.GetStagingEntryUUIDFromUrl(old_url).result == staging_entry.uuid );
+
+    staging_entry.url = new_url;
+    REQUIRE( blacklibrary_db.UpdateStagingEntry(staging_entry) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(old_url) == false );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(new_url) == true );
+
+    // a fresh instance rebuilds the index from the tables
+    {
+        BlackLibraryDB reopened_db(config);
+        REQUIRE( reopened_db.DoesStagingEntryUrlExist(new_url) == true );
+        REQUIRE( reopened_db.GetStagingUrlIndexStats().hits == 1 );
+    }
+
+    REQUIRE( blacklibrary_db.DeleteStagingEntry(staging_entry.uuid) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(new_url) == false );
+
+    DBUrlIndexStats stats = blacklibrary_db.GetStagingUrlIndexStats();
+    REQUIRE( stats.urls == 0 );
+    REQUIRE( stats.lookups == 5 );
+    REQUIRE( stats.hits == 2 );
+    REQUIRE( stats.memory_bytes > 0 );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+TEST_CASE( "Test url index update of missing entry black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    DBEntry black_entry = GenerateTestBlackEntry();
+
+    // updates match no row, the urls must not show up in the index
+    REQUIRE( blacklibrary_db.UpdateStagingEntry(staging_entry) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUUIDExist(staging_entry.uuid) == false );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(staging_entry.url) == false );
+
+    REQUIRE( blacklibrary_db.UpdateBlackEntries({ black_entry }) == std::vector<int>{ 0 } );
+    REQUIRE( blacklibrary_db.DoesBlackEntryUUIDExist(black_entry.uuid) == false );
+    REQUIRE( blacklibrary_db.DoesBlackEntryUrlExist(black_entry.url) == false );
+
+    REQUIRE( blacklibrary_db.GetStagingUrlIndexStats().urls == 0 );
+    REQUIRE( blacklibrary_db.GetBlackUrlIndexStats().urls == 0 );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+TEST_CASE( "Test url index delete after failed url lookup black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    DBEntry black_entry = GenerateTestBlackEntry();
+
+    // an empty url is still a url, deleting its row removes it from the index
+    staging_entry.url = "";
+    REQUIRE( blacklibrary_db.CreateStagingEntry(staging_entry) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist("") == true );
+    REQUIRE( blacklibrary_db.DeleteStagingEntry(staging_entry.uuid) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist("") == false );
+    REQUIRE( blacklibrary_db.GetStagingUrlIndexStats().urls == 0 );
+
+    staging_entry = GenerateTestStagingEntry();
+    REQUIRE( blacklibrary_db.CreateStagingEntry(staging_entry) == 0 );
+    REQUIRE( blacklibrary_db.CreateBlackEntry(black_entry) == 0 );
+
+    // the url lookups select last_url, renaming it makes them fail while deletes by UUID still work
+    sqlite3 *database_conn = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, "ALTER TABLE staging_entry RENAME COLUMN last_url TO renamed_last_url;"
+        "ALTER TABLE black_entry RENAME COLUMN last_url TO renamed_last_url", 0, 0, nullptr) == SQLITE_OK );
+
+    REQUIRE( blacklibrary_db.DeleteStagingEntry(staging_entry.uuid) == 0 );
+    REQUIRE( blacklibrary_db.DeleteBlackEntry(black_entry.uuid) == 0 );
+
+    REQUIRE( sqlite3_exec(database_conn, "ALTER TABLE staging_entry RENAME COLUMN renamed_last_url TO last_url;"
+        "ALTER TABLE black_entry RENAME COLUMN renamed_last_url TO last_url", 0, 0, nullptr) == SQLITE_OK );
+    sqlite3_close(database_conn);
+
+    // the indexes could not be kept in sync and were dropped, the checks now ask the database
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(staging_entry.url) == false );
+    REQUIRE( blacklibrary_db.DoesBlackEntryUrlExist(black_entry.url) == false );
+
+    REQUIRE( blacklibrary_db.CreateStagingEntry(staging_entry) == 0 );
+    REQUIRE( blacklibrary_db.DoesStagingEntryUrlExist(staging_entry.url) == true );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+TEST_CASE( "Test stats black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry black_entry = GenerateTestBlackEntry();
+
+    REQUIRE( blacklibrary_db.CreateBlackEntry(black_entry) == 0 );
+    REQUIRE( blacklibrary_db.CreateBlackEntry(black_entry) == -1 );
+    REQUIRE( blacklibrary_db.ReadBlackEntry(black_entry.uuid, AllEntryColumns).uuid == black_entry.uuid );
+    REQUIRE( blacklibrary_db.DeleteBlackEntry(black_entry.uuid) == 0 );
+
+    DBStatsSnapshot stats = blacklibrary_db.GetStats();
+    REQUIRE( stats.operations[CREATE_ENTRY_OPERATION].calls == 2 );
+    REQUIRE( stats.operations[CREATE_ENTRY_OPERATION].errors == 1 );
+    REQUIRE( stats.operations[READ_ENTRY_OPERATION].calls == 1 );
+    REQUIRE( stats.operations[DELETE_ENTRY_OPERATION].calls == 1 );
+    REQUIRE( stats.operations[DELETE_ENTRY_OPERATION].latency.count == 1 );
+    REQUIRE( stats.exclusive_lock_wait.count == 3 );
+    REQUIRE( stats.shared_lock_wait.count == 1 );
+
+    njson j = stats.ToJson();
+    REQUIRE( j["operations"]["create_entry"]["errors"] == 1 );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
 TEST_CASE( "Test CRUD for md5 checksum table black library (pass)", "[single-file]" )
 {
     njson config = GenerateDBTestConfig();
@@ -131,6 +347,32 @@ TEST_CASE( "Test CRUD for md5 checksum table black library (pass)", "[single-fil
     REQUIRE ( blacklibrary_db.DoesMd5SumExist(md5.uuid, md5.index_num) == false );
 }
 
+TEST_CASE( "Test upsert md5 checksums black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBMd5Sum md5 = GenerateTestMd5Sum();
+
+    REQUIRE( blacklibrary_db.UpsertMd5Sums("", { md5 }) == -1 );
+    REQUIRE( blacklibrary_db.UpsertMd5Sums(md5.uuid, { md5 }) == 0 );
+    md5.md5_sum = "17e8f0b4718aa78060a067fcee68513c";
+    REQUIRE( blacklibrary_db.UpsertMd5Sums(md5.uuid, { md5 }) == 0 );
+    REQUIRE( blacklibrary_db.ReadMd5Sum(md5.uuid, md5.index_num).md5_sum == md5.md5_sum );
+
+    auto md5s = blacklibrary_db.GetMd5SumsForUUID(md5.uuid);
+    REQUIRE( md5s.size() == 1 );
+    REQUIRE( md5s[0].md5_sum == md5.md5_sum );
+
+    DBMd5SumDiff diff = blacklibrary_db.DiffMd5Sums(md5.uuid, { { md5.index_num, md5.md5_sum } });
+    REQUIRE( diff.error == 0 );
+    REQUIRE( diff.new_indices.empty() );
+    REQUIRE( diff.changed_indices.empty() );
+    REQUIRE( diff.vanished_indices.empty() );
+
+    REQUIRE( blacklibrary_db.DeleteMd5Sum(md5.uuid, md5.index_num) == 0 );
+}
+
 TEST_CASE( "Test basic func for refresh table sqlite (pass)", "[single-file]" )
 {
     njson config = GenerateDBTestConfig();
@@ -153,12 +395,64 @@ TEST_CASE( "Test basic func for refresh table sqlite (pass)", "[single-file]" )
     REQUIRE ( next_refresh.uuid == refresh.uuid );
     REQUIRE ( next_refresh.refresh_date == refresh.refresh_date );
 
+    auto due_refreshes = blacklibrary_db.GetDueRefreshes(refresh.refresh_date, 10);
+    REQUIRE ( due_refreshes.size() == 1 );
+    REQUIRE ( due_refreshes[0].uuid == refresh.uuid );
+
+    auto claimed_refreshes = blacklibrary_db.ClaimRefreshes("worker-a", 600, 10);
+    REQUIRE ( claimed_refreshes.size() == 1 );
+    REQUIRE ( blacklibrary_db.ClaimRefreshes("worker-b", 600, 10).empty() );
+    REQUIRE ( blacklibrary_db.ReleaseRefresh(refresh.uuid, "worker-a") == 0 );
+    REQUIRE ( blacklibrary_db.ClaimRefreshes("worker-b", 600, 10).size() == 1 );
+    REQUIRE ( blacklibrary_db.CompleteRefresh(refresh.uuid, "worker-b") == 0 );
     REQUIRE ( blacklibrary_db.DeleteRefresh(refresh.uuid) == 0 );
 
     REQUIRE ( blacklibrary_db.DoesRefreshExist(refresh.uuid) == false );
     REQUIRE ( blacklibrary_db.DoesMinRefreshExist() == false );
 }
 
+TEST_CASE( "Test concurrent readers and writer black library (pass)", "[single-file]" )
+{
+    njson config = GenerateDBTestConfig();
+    BlackLibraryDB blacklibrary_db(config);
+
+    DBEntry black_entry = GenerateTestBlackEntry();
+    REQUIRE( blacklibrary_db.CreateBlackEntry(black_entry) == 0 );
+
+    std::atomic<size_t> failures(0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        workers.emplace_back([&blacklibrary_db, &black_entry, &failures]()
+        {
+            for (size_t j = 0; j < 50; ++j)
+            {
+                if (blacklibrary_db.GetBlackEntryUrlFromUUID(black_entry.uuid).result != black_entry.url)
+                    ++failures;
+                if (!blacklibrary_db.DoesBlackEntryUUIDExist(black_entry.uuid))
+                    ++failures;
+            }
+        });
+    }
+    workers.emplace_back([&blacklibrary_db, &failures]()
+    {
+        DBRefresh refresh = GenerateTestRefresh();
+        for (size_t j = 0; j < 20; ++j)
+        {
+            if (blacklibrary_db.CreateRefresh(refresh) || blacklibrary_db.DeleteRefresh(refresh.uuid))
+                ++failures;
+        }
+    });
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    REQUIRE( failures == 0 );
+    REQUIRE( blacklibrary_db.DeleteBlackEntry(black_entry.uuid) == 0 );
+}
+
 } // namespace db
 } // namespace core
 } // namespace black_library
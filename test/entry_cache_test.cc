@@ -0,0 +1,96 @@
+/**
+ * entry_cache_test.cc
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <DBEntryCache.h>
+
+#include <DBTestUtils.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+TEST_CASE( "Test entry cache hit and miss (pass)", "[single-file]" )
+{
+    DBEntryCache cache(4);
+    DBEntry black_entry = GenerateTestBlackEntry();
+    DBEntry read_entry;
+
+    REQUIRE( cache.Get(black_entry.uuid, BLACK_ENTRY, read_entry) == false );
+
+    cache.Put(black_entry, BLACK_ENTRY);
+
+    REQUIRE( cache.Get(black_entry.uuid, BLACK_ENTRY, read_entry) == true );
+    REQUIRE( read_entry.uuid == black_entry.uuid );
+    REQUIRE( read_entry.title == black_entry.title );
+    REQUIRE( cache.Get(black_entry.uuid, STAGING_ENTRY, read_entry) == false );
+
+    DBEntryCacheStats stats = cache.GetStats();
+    REQUIRE( stats.capacity == 4 );
+    REQUIRE( stats.size == 1 );
+    REQUIRE( stats.hits == 1 );
+    REQUIRE( stats.misses == 2 );
+    REQUIRE( stats.evictions == 0 );
+}
+
+TEST_CASE( "Test entry cache evicts least recently used (pass)", "[single-file]" )
+{
+    DBEntryCache cache(2);
+    DBEntry entry_0 = GenerateTestBlackEntry();
+    DBEntry entry_1 = GenerateTestBlackEntry();
+    DBEntry entry_2 = GenerateTestBlackEntry();
+    entry_1.uuid += "-1";
+    entry_2.uuid += "-2";
+    DBEntry read_entry;
+
+    cache.Put(entry_0, BLACK_ENTRY);
+    cache.Put(entry_1, BLACK_ENTRY);
+
+    // touch entry_0 so entry_1 becomes the oldest
+    REQUIRE( cache.Get(entry_0.uuid, BLACK_ENTRY, read_entry) == true );
+
+    cache.Put(entry_2, BLACK_ENTRY);
+
+    REQUIRE( cache.Get(entry_1.uuid, BLACK_ENTRY, read_entry) == false );
+    REQUIRE( cache.Get(entry_0.uuid, BLACK_ENTRY, read_entry) == true );
+    REQUIRE( cache.Get(entry_2.uuid, BLACK_ENTRY, read_entry) == true );
+    REQUIRE( cache.GetStats().size == 2 );
+    REQUIRE( cache.GetStats().evictions == 1 );
+}
+
+TEST_CASE( "Test entry cache invalidate (pass)", "[single-file]" )
+{
+    DBEntryCache cache(4);
+    DBEntry entry = GenerateTestStagingEntry();
+    DBEntry read_entry;
+
+    cache.Put(entry, STAGING_ENTRY);
+    cache.Invalidate(entry.uuid, BLACK_ENTRY);
+    REQUIRE( cache.Get(entry.uuid, STAGING_ENTRY, read_entry) == true );
+
+    cache.Invalidate(entry.uuid, STAGING_ENTRY);
+    REQUIRE( cache.Get(entry.uuid, STAGING_ENTRY, read_entry) == false );
+
+    cache.Put(entry, STAGING_ENTRY);
+    cache.Clear();
+    REQUIRE( cache.GetStats().size == 0 );
+}
+
+TEST_CASE( "Test entry cache disabled (pass)", "[single-file]" )
+{
+    DBEntryCache cache(0);
+    DBEntry entry = GenerateTestStagingEntry();
+    DBEntry read_entry;
+
+    cache.Put(entry, STAGING_ENTRY);
+    REQUIRE( cache.Get(entry.uuid, STAGING_ENTRY, read_entry) == false );
+    REQUIRE( cache.GetStats().size == 0 );
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -0,0 +1,165 @@
+/**
+ * query_plan_test.cc
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <FileOperations.h>
+#include <LogOperations.h>
+
+#include <SQLiteDB.h>
+
+#include <DBTestUtils.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+namespace BlackLibraryCommon = black_library::core::common;
+
+// point lookups run on every request, each must be answered from an index or primary key
+static const std::vector<std::string> HotStatements = {
+    "READ_STAGING_ENTRY_STATEMENT",
+    "READ_STAGING_ENTRY_URL_STATEMENT",
+    "READ_STAGING_ENTRY_UUID_STATEMENT",
+    "READ_BLACK_ENTRY_STATEMENT",
+    "READ_BLACK_ENTRY_URL_STATEMENT",
+    "READ_BLACK_ENTRY_UUID_STATEMENT",
+    "READ_MD5_SUM_STATEMENT",
+    "READ_REFRESH_STATEMENT",
+    "UPDATE_STAGING_ENTRY_STATEMENT",
+    "UPDATE_BLACK_ENTRY_STATEMENT",
+    "UPDATE_MD5_SUM_STATEMENT",
+    "DELETE_STAGING_ENTRY_STATEMENT",
+    "DELETE_BLACK_ENTRY_STATEMENT",
+    "DELETE_MD5_SUM_STATEMENT",
+    "DELETE_REFRESH_STATEMENT",
+    "GET_STAGING_ENTRY_UUID_FROM_URL_STATEMENT",
+    "GET_STAGING_ENTRY_URL_FROM_UUID_STATEMENT",
+    "GET_BLACK_ENTRY_UUID_FROM_URL_STATEMENT",
+    "GET_BLACK_ENTRY_URL_FROM_UUID_STATEMENT",
+    "GET_MD5_SUM_FROM_UUID_AND_INDEX_STATEMENT",
+    "GET_MD5_SUMS_FROM_UUID_STATEMENT",
+    "GET_REFRESH_FROM_MIN_DATE_STATEMENT",
+    "GET_DUE_REFRESHES_STATEMENT",
+    "DOES_MIN_REFRESH_EXIST_STATEMENT",
+    "GET_CLAIMABLE_REFRESHES_STATEMENT",
+    "CLAIM_REFRESH_STATEMENT",
+};
+
+// whole table listings scan by design, the md5 diff scans its own temp table of fresh sums
+static const std::vector<std::string> ScanningStatements = {
+    "GET_STAGING_ENTRIES_STATEMENT",
+    "GET_BLACK_ENTRIES_STATEMENT",
+    "GET_CHECKSUMS_STATEMENT",
+    "GET_ERROR_ENTRIES_STATEMENT",
+    "DIFF_MD5_SUMS_STATEMENT",
+};
+
+// "SCAN t" and the pre 3.24 "SCAN TABLE t" read every row, a scan that names an index walks it in order
+static bool IsFullScan(const std::string &detail)
+{
+    if (detail.rfind("SCAN ", 0) != 0)
+        return false;
+
+    return detail.find(" USING ") == std::string::npos && detail != "SCAN CONSTANT ROW";
+}
+
+static bool UsesIndex(const std::string &detail)
+{
+    return detail.find(" USING INDEX ") != std::string::npos ||
+        detail.find(" USING COVERING INDEX ") != std::string::npos ||
+        detail.find("PRIMARY KEY") != std::string::npos;
+}
+
+static std::vector<SQLiteQueryPlan> ExplainCatalog()
+{
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+
+    SQLiteDB db(DefaultTestDBPath);
+    REQUIRE( db.IsReady() == true );
+
+    // a few rows so the planner is not reasoning about empty tables
+    REQUIRE( db.CreateEntry(GenerateTestStagingEntry(), STAGING_ENTRY) == 0 );
+    REQUIRE( db.CreateEntry(GenerateTestBlackEntry(), BLACK_ENTRY) == 0 );
+    REQUIRE( db.CreateMd5Sum(GenerateTestMd5Sum()) == 0 );
+
+    std::vector<SQLiteQueryPlan> plans;
+    REQUIRE( db.ExplainPreparedStatements(plans) == 0 );
+
+    return plans;
+}
+
+static const SQLiteQueryPlan *FindPlan(const std::vector<SQLiteQueryPlan> &plans, const std::string &statement_name)
+{
+    const auto it = std::find_if(plans.begin(), plans.end(), [&statement_name](const SQLiteQueryPlan &plan)
+    {
+        return plan.statement_name == statement_name;
+    });
+
+    if (it == plans.end())
+        return nullptr;
+
+    return &*it;
+}
+
+TEST_CASE( "Test init query plan logger (pass)", "[single-file]")
+{
+    BlackLibraryCommon::InitRotatingLogger("db", "/tmp/", false);
+}
+
+TEST_CASE( "Test hot statements use an index query plan (pass)", "[single-file]" )
+{
+    const std::vector<SQLiteQueryPlan> plans = ExplainCatalog();
+
+    for (const auto &statement_name : HotStatements)
+    {
+        INFO( statement_name );
+        const SQLiteQueryPlan *plan = FindPlan(plans, statement_name);
+        REQUIRE( plan != nullptr );
+        INFO( plan->sql );
+        REQUIRE( plan->details.empty() == false );
+
+        bool uses_index = false;
+        for (const auto &detail : plan->details)
+        {
+            INFO( detail );
+            CHECK( IsFullScan(detail) == false );
+            uses_index = uses_index || UsesIndex(detail);
+        }
+        CHECK( uses_index == true );
+    }
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+TEST_CASE( "Test only listing statements scan query plan (pass)", "[single-file]" )
+{
+    const std::vector<SQLiteQueryPlan> plans = ExplainCatalog();
+
+    for (const auto &plan : plans)
+    {
+        if (std::find(ScanningStatements.begin(), ScanningStatements.end(), plan.statement_name) != ScanningStatements.end())
+            continue;
+
+        INFO( plan.statement_name );
+        INFO( plan.sql );
+        for (const auto &detail : plan.details)
+        {
+            INFO( detail );
+            CHECK( IsFullScan(detail) == false );
+        }
+    }
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -2,11 +2,17 @@
  * sqlite_db_test.cc
  */
 
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
 #include <catch2/catch_test_macros.hpp>
 
 #include <FileOperations.h>
 #include <LogOperations.h>
 
+#include <SQLiteColumns.h>
 #include <SQLiteDB.h>
 
 #include <DBTestUtils.h>
@@ -19,6 +25,10 @@ namespace db {
 
 namespace BlackLibraryCommon = black_library::core::common;
 
+// the lease columns cannot be added twice, a catalog rolled back to before version 4 gets the
+// refresh table it had then
+static constexpr const char RollbackRefreshLeasesStatement[] = "DROP TABLE refresh; CREATE TABLE refresh(UUID VARCHAR(36) NOT NULL PRIMARY KEY, refresh_date INTERGER)";
+
 TEST_CASE( "Test init sqlite logger (pass)", "[single-file]")
 {
     BlackLibraryCommon::InitRotatingLogger("db", "/tmp/", true);
@@ -36,6 +46,225 @@ TEST_CASE( "Test create database sqlite already exists (pass)", "[single-file]"
     SQLiteDB db(DefaultTestDBPath);
 }
 
+TEST_CASE( "Test url indexes added to existing database sqlite (pass)", "[single-file]" )
+{
+    static constexpr const char CountUrlIndexesStatement[] = "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name IN ('staging_entry_url_idx', 'black_entry_url_idx')";
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+    }
+
+    sqlite3 *database_conn = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, CountUrlIndexesStatement, -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == 2 );
+    sqlite3_finalize(stmt);
+
+    // roll the catalog back to the schema it had before the url indexes
+    REQUIRE( sqlite3_exec(database_conn, "DROP INDEX staging_entry_url_idx; DROP INDEX black_entry_url_idx; PRAGMA user_version = 1", 0, 0, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, RollbackRefreshLeasesStatement, 0, 0, nullptr) == SQLITE_OK );
+    sqlite3_close(database_conn);
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+    }
+
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_prepare_v2(database_conn, CountUrlIndexesStatement, -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == 2 );
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+}
+
+TEST_CASE( "Test schema migrations on existing database sqlite (pass)", "[single-file]" )
+{
+    DBEntry staging_entry = GenerateTestStagingEntry();
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+        REQUIRE( db.CreateEntry(staging_entry, STAGING_ENTRY) == 0 );
+    }
+
+    sqlite3 *database_conn = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    const int schema_version = sqlite3_column_int(stmt, 0);
+    REQUIRE( schema_version > 0 );
+    sqlite3_finalize(stmt);
+
+    // a catalog from before versioning reports user_version 0
+    REQUIRE( sqlite3_exec(database_conn, "PRAGMA user_version = 0", 0, 0, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, RollbackRefreshLeasesStatement, 0, 0, nullptr) == SQLITE_OK );
+    sqlite3_close(database_conn);
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+        REQUIRE( db.ReadEntry(staging_entry.uuid, STAGING_ENTRY).uuid == staging_entry.uuid );
+        REQUIRE( db.DeleteEntry(staging_entry.uuid, STAGING_ENTRY) == 0 );
+    }
+
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_prepare_v2(database_conn, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == schema_version );
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+}
+
+TEST_CASE( "Test refresh lease migration on existing database sqlite (pass)", "[single-file]" )
+{
+    static constexpr const char CountLeaseColumnsStatement[] = "SELECT COUNT(*) FROM pragma_table_info('refresh') WHERE name IN ('lease_owner', 'lease_expires')";
+
+    DBRefresh refresh = GenerateTestRefresh();
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+    }
+
+    // a version 3 catalog has its refresh rows but no lease columns
+    sqlite3 *database_conn = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, RollbackRefreshLeasesStatement, 0, 0, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, ("CREATE INDEX refresh_date_idx ON refresh(refresh_date); PRAGMA user_version = 3;"
+        "INSERT INTO refresh(UUID, refresh_date) VALUES ('" + refresh.uuid + "', " + std::to_string(refresh.refresh_date) + ")").c_str(), 0, 0, nullptr) == SQLITE_OK );
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, CountLeaseColumnsStatement, -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == 0 );
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+        REQUIRE( db.ReadRefresh(refresh.uuid).refresh_date == refresh.refresh_date );
+
+        // existing rows come through the migration unleased
+        std::vector<DBRefresh> claimed;
+        REQUIRE( db.ClaimRefreshes("worker-a", 600, 1, claimed) == 0 );
+        REQUIRE( claimed.size() == 1 );
+        REQUIRE( claimed[0].uuid == refresh.uuid );
+        REQUIRE( db.ClaimRefreshes("worker-b", 600, 1, claimed) == 0 );
+        REQUIRE( claimed.empty() );
+        REQUIRE( db.CompleteRefresh(refresh.uuid, "worker-a") == 0 );
+    }
+
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, CountLeaseColumnsStatement, -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == 2 );
+    sqlite3_finalize(stmt);
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == 4 );
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+TEST_CASE( "Test migrate unversioned database sqlite (pass)", "[single-file]" )
+{
+    static constexpr const char CountIndexesStatement[] = "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name IN ('staging_entry_url_idx', 'black_entry_url_idx', 'refresh_date_idx')";
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    DBRefresh refresh = GenerateTestRefresh();
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+
+    // a catalog from before versioning reports user_version 0 and has no indexes or lease columns
+    sqlite3 *database_conn = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn,
+        "CREATE TABLE staging_entry(UUID VARCHAR(36) PRIMARY KEY NOT NULL, title TEXT NOT NULL, author TEXT NOT NULL, nickname TEXT, source TEXT, url TEXT, last_url TEXT, series TEXT, series_length DEFAULT 1, version INTEGER, media_path TEXT NOT NULL, birth_date INTEGER, check_date INTEGER, update_date INTEGER, user_contributed INTEGER NOT NULL);"
+        "CREATE TABLE refresh(UUID VARCHAR(36) NOT NULL PRIMARY KEY, refresh_date INTERGER);"
+        "INSERT INTO staging_entry VALUES ('75ee5fad-2deb-4436-120c-3226ceeeaed6', 'staging-title', 'staging-author', 'staging-nickname', 'staging-source', 'staging-url', 'staging-last-url', 'staging-series', 15, 25, 'staging-media-path', 35, 45, 55, 4004);"
+        "INSERT INTO refresh(UUID, refresh_date) VALUES ('50470924-7e39-46cb-997c-aa8d882e1c59', 946598400);",
+        0, 0, nullptr) == SQLITE_OK );
+    sqlite3_close(database_conn);
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+        REQUIRE( db.ReadEntry(staging_entry.uuid, STAGING_ENTRY).url == staging_entry.url );
+        REQUIRE( db.DoesEntryUrlExist(staging_entry.url, STAGING_ENTRY).result == true );
+
+        std::vector<DBRefresh> claimed;
+        REQUIRE( db.ClaimRefreshes("worker-a", 600, 1, claimed) == 0 );
+        REQUIRE( claimed.size() == 1 );
+        REQUIRE( claimed[0].uuid == refresh.uuid );
+    }
+
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, CountIndexesStatement, -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == 3 );
+    sqlite3_finalize(stmt);
+
+    REQUIRE( sqlite3_prepare_v2(database_conn, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) > 0 );
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+}
+
+TEST_CASE( "Test reopen current database skips migrations sqlite (pass)", "[single-file]" )
+{
+    DBEntry staging_entry = GenerateTestStagingEntry();
+
+    int schema_version = 0;
+    sqlite3 *database_conn = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+        REQUIRE( db.CreateEntry(staging_entry, STAGING_ENTRY) == 0 );
+    }
+
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_prepare_v2(database_conn, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    schema_version = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+
+    {
+        SQLiteDB db(DefaultTestDBPath);
+        REQUIRE( db.IsReady() == true );
+        REQUIRE( db.ReadEntry(staging_entry.uuid, STAGING_ENTRY).uuid == staging_entry.uuid );
+        REQUIRE( db.DeleteEntry(staging_entry.uuid, STAGING_ENTRY) == 0 );
+    }
+
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_prepare_v2(database_conn, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK );
+    REQUIRE( sqlite3_step(stmt) == SQLITE_ROW );
+    REQUIRE( sqlite3_column_int(stmt, 0) == schema_version );
+    sqlite3_finalize(stmt);
+    sqlite3_close(database_conn);
+}
+
 TEST_CASE( "Test CRUD for entries sqlite (pass)", "[single-file]" )
 {
     DBEntry staging_entry = GenerateTestStagingEntry();
@@ -77,6 +306,245 @@ TEST_CASE( "Test CRUD for entries sqlite (pass)", "[single-file]" )
     REQUIRE( db.DoesErrorEntryExist(error_entry.uuid, error_entry.progress_num).result == false );
 }
 
+TEST_CASE( "Test failed write rolls back sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+    SQLiteDB other_db(DefaultTestDBPath);
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    DBRefresh refresh = GenerateTestRefresh();
+
+    REQUIRE( db.CreateEntry(staging_entry, STAGING_ENTRY) == 0 );
+    REQUIRE( db.CreateEntry(staging_entry, STAGING_ENTRY) == -1 );
+
+    // a transaction left open by the failed insert would hold the write lock
+    REQUIRE( other_db.CreateRefresh(refresh) == 0 );
+    REQUIRE( db.DoesRefreshExist(refresh.uuid).result == true );
+
+    REQUIRE( db.DeleteRefresh(refresh.uuid) == 0 );
+    REQUIRE( db.DeleteEntry(staging_entry.uuid, STAGING_ENTRY) == 0 );
+}
+
+TEST_CASE( "Test batch create and update entries sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    DBEntry staging_entry_0 = GenerateTestStagingEntry();
+    DBEntry staging_entry_1 = GenerateTestStagingEntry();
+    DBEntry empty_entry;
+    staging_entry_1.uuid = "2f4b5a8e-1cd1-4b1a-9d6e-7a0b3c2d1e0f";
+    staging_entry_1.url = "staging-url-1";
+
+    std::vector<DBEntry> entries = { staging_entry_0, staging_entry_1, empty_entry, staging_entry_0 };
+    std::vector<int> create_results = db.CreateEntries(entries, STAGING_ENTRY);
+    REQUIRE( create_results == std::vector<int>({ 0, 0, -1, -1 }) );
+    REQUIRE( db.DoesEntryUUIDExist(staging_entry_0.uuid, STAGING_ENTRY).result == true );
+    REQUIRE( db.DoesEntryUUIDExist(staging_entry_1.uuid, STAGING_ENTRY).result == true );
+
+    staging_entry_0.author = "renamed-author";
+    staging_entry_1.author = "renamed-author";
+    std::vector<int> update_results = db.UpdateEntries({ staging_entry_0, staging_entry_1 }, STAGING_ENTRY);
+    REQUIRE( update_results == std::vector<int>({ 0, 0 }) );
+    REQUIRE( db.ReadEntry(staging_entry_0.uuid, STAGING_ENTRY).author == staging_entry_0.author );
+    REQUIRE( db.ReadEntry(staging_entry_1.uuid, STAGING_ENTRY).author == staging_entry_1.author );
+
+    REQUIRE( db.CreateEntries({}, STAGING_ENTRY).empty() );
+
+    REQUIRE( db.DeleteEntry(staging_entry_0.uuid, STAGING_ENTRY) == 0 );
+    REQUIRE( db.DeleteEntry(staging_entry_1.uuid, STAGING_ENTRY) == 0 );
+}
+
+TEST_CASE( "Test for each entry sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    std::vector<DBEntry> entries;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        DBEntry entry = GenerateTestBlackEntry();
+        entry.uuid += "-" + std::to_string(i);
+        entry.url += "-" + std::to_string(i);
+        entries.emplace_back(entry);
+    }
+    REQUIRE( db.CreateEntries(entries, BLACK_ENTRY) == std::vector<int>(entries.size(), 0) );
+
+    size_t visited = 0;
+    REQUIRE( db.ForEachEntry(BLACK_ENTRY, [&visited](const DBEntry &entry)
+    {
+        if (entry.title == "black-title")
+            ++visited;
+        return true;
+    }) == 0 );
+    REQUIRE( visited == entries.size() );
+
+    visited = 0;
+    REQUIRE( db.ForEachEntry(BLACK_ENTRY, [&visited](const DBEntry &)
+    {
+        return ++visited < 2;
+    }) == 0 );
+    REQUIRE( visited == 2 );
+
+    REQUIRE( db.ListEntries(BLACK_ENTRY).size() == entries.size() );
+
+    for (const auto &entry : entries)
+    {
+        REQUIRE( db.DeleteEntry(entry.uuid, BLACK_ENTRY) == 0 );
+    }
+}
+
+TEST_CASE( "Test keyset pagination sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    std::vector<DBEntry> entries;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        DBEntry entry = GenerateTestStagingEntry();
+        entry.uuid = std::to_string(i) + entry.uuid.substr(1);
+        entry.url += "-" + std::to_string(i);
+        entries.emplace_back(entry);
+    }
+    REQUIRE( db.CreateEntries(entries, STAGING_ENTRY) == std::vector<int>(entries.size(), 0) );
+
+    std::vector<DBEntry> entry_page;
+    std::vector<std::string> paged_uuids;
+    std::string after_uuid;
+    do
+    {
+        REQUIRE( db.ListEntriesPage(STAGING_ENTRY, after_uuid, 2, entry_page) == 0 );
+        REQUIRE( entry_page.size() <= 2 );
+        for (const auto &entry : entry_page)
+        {
+            paged_uuids.emplace_back(entry.uuid);
+        }
+        if (!entry_page.empty())
+            after_uuid = entry_page.back().uuid;
+    } while (!entry_page.empty());
+
+    REQUIRE( paged_uuids.size() == entries.size() );
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        REQUIRE( paged_uuids[i] == entries[i].uuid );
+    }
+
+    DBMd5Sum md5 = GenerateTestMd5Sum();
+    std::vector<DBMd5Sum> md5s;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        md5.index_num = i;
+        md5s.emplace_back(md5);
+    }
+    REQUIRE( db.UpsertMd5Sums(md5.uuid, md5s) == 0 );
+
+    std::vector<DBMd5Sum> checksum_page;
+    REQUIRE( db.ListChecksumsPage("", 0, 2, checksum_page) == 0 );
+    REQUIRE( checksum_page.size() == 2 );
+    REQUIRE( checksum_page[1].index_num == 1 );
+    REQUIRE( db.ListChecksumsPage(checksum_page[1].uuid, checksum_page[1].index_num, 2, checksum_page) == 0 );
+    REQUIRE( checksum_page.size() == 1 );
+    REQUIRE( checksum_page[0].index_num == 2 );
+
+    DBErrorEntry error_entry = GenerateTestErrorEntry();
+    REQUIRE( db.CreateErrorEntry(error_entry) == 0 );
+    std::vector<DBErrorEntry> error_page;
+    REQUIRE( db.ListErrorEntriesPage("", 10, error_page) == 0 );
+    REQUIRE( error_page.size() == 1 );
+    REQUIRE( db.ListErrorEntriesPage(error_page[0].uuid, 10, error_page) == 0 );
+    REQUIRE( error_page.empty() );
+
+    REQUIRE( db.DeleteErrorEntry(error_entry.uuid, error_entry.progress_num) == 0 );
+    for (const auto &checksum : md5s)
+    {
+        REQUIRE( db.DeleteMd5Sum(checksum.uuid, checksum.index_num) == 0 );
+    }
+    for (const auto &entry : entries)
+    {
+        REQUIRE( db.DeleteEntry(entry.uuid, STAGING_ENTRY) == 0 );
+    }
+}
+
+TEST_CASE( "Test column projection for entries sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    DBEntry black_entry = GenerateTestBlackEntry();
+    REQUIRE( db.CreateEntry(black_entry, BLACK_ENTRY) == 0 );
+
+    const entry_column_mask_t columns = EntryColumnMask(DBEntryColumnID::title) | EntryColumnMask(DBEntryColumnID::update_date);
+
+    DBEntry projected = db.ReadEntry(black_entry.uuid, BLACK_ENTRY, columns);
+    REQUIRE( projected.uuid == black_entry.uuid );
+    REQUIRE( projected.title == black_entry.title );
+    REQUIRE( projected.update_date == black_entry.update_date );
+    REQUIRE( projected.media_path.empty() );
+    REQUIRE( projected.url.empty() );
+    REQUIRE( projected.check_date == 0 );
+
+    REQUIRE( db.ReadEntry("missing-uuid", BLACK_ENTRY, columns).uuid.empty() );
+
+    // the cached statement is reused on the second pass
+    for (size_t i = 0; i < 2; ++i)
+    {
+        auto entries = db.ListEntries(BLACK_ENTRY, columns);
+        REQUIRE( entries.size() == 1 );
+        REQUIRE( entries[0].uuid == black_entry.uuid );
+        REQUIRE( entries[0].title == black_entry.title );
+        REQUIRE( entries[0].author.empty() );
+    }
+
+    DBEntry full = db.ReadEntry(black_entry.uuid, BLACK_ENTRY, AllEntryColumns);
+    REQUIRE( full.media_path == black_entry.media_path );
+    REQUIRE( full.user_contributed == black_entry.user_contributed );
+
+    REQUIRE( db.DeleteEntry(black_entry.uuid, BLACK_ENTRY) == 0 );
+}
+
+TEST_CASE( "Test for each entry view sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    std::vector<DBEntry> entries;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        DBEntry entry = GenerateTestStagingEntry();
+        entry.uuid += "-" + std::to_string(i);
+        entry.url += (i % 2) ? "-odd" : "-even";
+        entries.emplace_back(entry);
+    }
+    REQUIRE( db.CreateEntries(entries, STAGING_ENTRY) == std::vector<int>(entries.size(), 0) );
+
+    size_t odd_count = 0;
+    std::vector<DBEntry> kept;
+    REQUIRE( db.ForEachEntryView(STAGING_ENTRY, EntryColumnMask(DBEntryColumnID::url), [&odd_count, &kept](const DBEntryView &view)
+    {
+        if (view.url.size() >= 4 && view.url.substr(view.url.size() - 4) == "-odd")
+        {
+            ++odd_count;
+            kept.emplace_back(view.Materialize());
+        }
+        REQUIRE( view.title.empty() );
+        return true;
+    }) == 0 );
+    REQUIRE( odd_count == 2 );
+    REQUIRE( kept.size() == 2 );
+    REQUIRE( kept[0].url == "staging-url-odd" );
+    REQUIRE( kept[0].title.empty() );
+
+    DBEntry full_entry;
+    REQUIRE( db.ForEachEntryView(STAGING_ENTRY, AllEntryColumns, [&full_entry](const DBEntryView &view)
+    {
+        view.MaterializeInto(full_entry);
+        return false;
+    }) == 0 );
+    REQUIRE( full_entry.media_path == entries[0].media_path );
+    REQUIRE( full_entry.user_contributed == entries[0].user_contributed );
+
+    for (const auto &entry : entries)
+    {
+        REQUIRE( db.DeleteEntry(entry.uuid, STAGING_ENTRY) == 0 );
+    }
+}
+
 TEST_CASE( "Test CRUD for md5 checksum table sqlite (pass)", "[single-file]" )
 {
     SQLiteDB db(DefaultTestDBPath);
@@ -104,6 +572,148 @@ TEST_CASE( "Test CRUD for md5 checksum table sqlite (pass)", "[single-file]" )
     REQUIRE ( db.DoesMd5SumExist(md5.uuid, md5.index_num).result == false );
 }
 
+TEST_CASE( "Test upsert md5 checksums sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    DBMd5Sum md5_0 = GenerateTestMd5Sum();
+    DBMd5Sum md5_1 = GenerateTestMd5Sum();
+    md5_1.index_num = md5_0.index_num + 1;
+
+    REQUIRE( db.UpsertMd5Sums(md5_0.uuid, { md5_0, md5_1 }) == 0 );
+    REQUIRE( db.ReadMd5Sum(md5_0.uuid, md5_0.index_num).md5_sum == md5_0.md5_sum );
+    REQUIRE( db.ReadMd5Sum(md5_1.uuid, md5_1.index_num).md5_sum == md5_1.md5_sum );
+
+    DBMd5Sum md5_2 = GenerateTestMd5Sum();
+    md5_2.index_num = md5_0.index_num + 2;
+    md5_1.md5_sum = "17e8f0b4718aa78060a067fcee68513c";
+    md5_1.version_num = md5_0.version_num + 1;
+
+    REQUIRE( db.UpsertMd5Sums(md5_0.uuid, { md5_1, md5_2 }) == 0 );
+    DBMd5Sum md5_read = db.ReadMd5Sum(md5_1.uuid, md5_1.index_num);
+    REQUIRE( md5_read.md5_sum == md5_1.md5_sum );
+    REQUIRE( md5_read.version_num == md5_1.version_num );
+    REQUIRE( db.DoesMd5SumExist(md5_2.uuid, md5_2.index_num).result == true );
+
+    REQUIRE( db.DeleteMd5Sum(md5_0.uuid, md5_0.index_num) == 0 );
+    REQUIRE( db.DeleteMd5Sum(md5_1.uuid, md5_1.index_num) == 0 );
+    REQUIRE( db.DeleteMd5Sum(md5_2.uuid, md5_2.index_num) == 0 );
+}
+
+TEST_CASE( "Test upsert md5 checksums rolls back on failed row sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    DBMd5Sum md5_0 = GenerateTestMd5Sum();
+    DBMd5Sum md5_1 = GenerateTestMd5Sum();
+    md5_1.index_num = md5_0.index_num + 1;
+
+    REQUIRE( db.UpsertMd5Sums(md5_0.uuid, { md5_0, md5_1 }) == 0 );
+
+    // fail the third row of the batch
+    DBMd5Sum md5_2 = GenerateTestMd5Sum();
+    md5_2.index_num = md5_0.index_num + 2;
+    sqlite3 *database_conn = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, ("CREATE TRIGGER fail_md5_sum BEFORE INSERT ON md5_sum WHEN NEW.index_num = " +
+        std::to_string(md5_2.index_num) + " BEGIN SELECT RAISE(ABORT, 'fail md5 sum'); END").c_str(), 0, 0, 0) == SQLITE_OK );
+
+    DBMd5Sum md5_0_changed = md5_0;
+    md5_0_changed.md5_sum = "17e8f0b4718aa78060a067fcee68513c";
+    DBMd5Sum md5_3 = GenerateTestMd5Sum();
+    md5_3.index_num = md5_0.index_num + 3;
+
+    REQUIRE( db.UpsertMd5Sums(md5_0.uuid, { md5_0_changed, md5_1, md5_2, md5_3 }) == -1 );
+    REQUIRE( db.ReadMd5Sum(md5_0.uuid, md5_0.index_num).md5_sum == md5_0.md5_sum );
+    REQUIRE( db.DoesMd5SumExist(md5_2.uuid, md5_2.index_num).result == false );
+    REQUIRE( db.DoesMd5SumExist(md5_3.uuid, md5_3.index_num).result == false );
+
+    REQUIRE( sqlite3_exec(database_conn, "DROP TRIGGER fail_md5_sum", 0, 0, 0) == SQLITE_OK );
+    REQUIRE( sqlite3_close(database_conn) == SQLITE_OK );
+
+    // the write connection is usable again after the rollback
+    REQUIRE( db.UpsertMd5Sums(md5_0.uuid, { md5_0_changed, md5_2 }) == 0 );
+    REQUIRE( db.ReadMd5Sum(md5_0.uuid, md5_0.index_num).md5_sum == md5_0_changed.md5_sum );
+
+    REQUIRE( db.DeleteMd5Sum(md5_0.uuid, md5_0.index_num) == 0 );
+    REQUIRE( db.DeleteMd5Sum(md5_1.uuid, md5_1.index_num) == 0 );
+    REQUIRE( db.DeleteMd5Sum(md5_2.uuid, md5_2.index_num) == 0 );
+}
+
+TEST_CASE( "Test get md5 checksums for UUID sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    DBMd5Sum md5 = GenerateTestMd5Sum();
+    std::vector<DBMd5Sum> md5s;
+    for (size_t index_num : { 12, 3, 7 })
+    {
+        md5.index_num = index_num;
+        md5s.emplace_back(md5);
+    }
+    DBMd5Sum other_md5 = GenerateTestMd5Sum();
+    other_md5.uuid = "75ee5fad-2deb-4436-120c-3226ceeeaed6";
+
+    REQUIRE( db.UpsertMd5Sums(md5.uuid, md5s) == 0 );
+    REQUIRE( db.CreateMd5Sum(other_md5) == 0 );
+
+    std::vector<DBMd5Sum> read_md5s(5);
+    REQUIRE( db.GetMd5SumsForUUID(md5.uuid, read_md5s) == 0 );
+    REQUIRE( read_md5s.size() == 3 );
+    REQUIRE( read_md5s[0].index_num == 3 );
+    REQUIRE( read_md5s[1].index_num == 7 );
+    REQUIRE( read_md5s[2].index_num == 12 );
+    REQUIRE( read_md5s[2].md5_sum == md5.md5_sum );
+
+    REQUIRE( db.GetMd5SumsForUUID("missing-uuid", read_md5s) == 0 );
+    REQUIRE( read_md5s.empty() );
+
+    for (const auto &delete_md5 : md5s)
+    {
+        REQUIRE( db.DeleteMd5Sum(delete_md5.uuid, delete_md5.index_num) == 0 );
+    }
+    REQUIRE( db.DeleteMd5Sum(other_md5.uuid, other_md5.index_num) == 0 );
+}
+
+TEST_CASE( "Test diff md5 checksums sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    DBMd5Sum md5 = GenerateTestMd5Sum();
+    std::vector<DBMd5Sum> md5s;
+    for (size_t index_num : { 0, 1, 2, 3 })
+    {
+        md5.index_num = index_num;
+        md5.md5_sum = "md5-" + std::to_string(index_num);
+        md5s.emplace_back(md5);
+    }
+    REQUIRE( db.UpsertMd5Sums(md5.uuid, md5s) == 0 );
+
+    std::vector<std::pair<size_t, std::string>> fresh = { { 0, "md5-0" }, { 1, "md5-1-changed" }, { 3, "md5-3" }, { 4, "md5-4" } };
+
+    DBMd5SumDiff diff = db.DiffMd5Sums(md5.uuid, fresh);
+    REQUIRE( diff.error == 0 );
+    REQUIRE( diff.new_indices == std::vector<size_t>({ 4 }) );
+    REQUIRE( diff.changed_indices == std::vector<size_t>({ 1 }) );
+    REQUIRE( diff.vanished_indices == std::vector<size_t>({ 2 }) );
+
+    DBMd5SumDiff missing_diff = db.DiffMd5Sums("missing-uuid", fresh);
+    REQUIRE( missing_diff.new_indices.size() == fresh.size() );
+    REQUIRE( missing_diff.changed_indices.empty() );
+    REQUIRE( missing_diff.vanished_indices.empty() );
+
+    // index numbers past 32 bits come back whole
+    const size_t large_index_num = static_cast<size_t>(std::numeric_limits<uint32_t>::max()) + 2;
+    DBMd5SumDiff large_diff = db.DiffMd5Sums(md5.uuid, { { large_index_num, "md5-large" } });
+    REQUIRE( large_diff.error == 0 );
+    REQUIRE( large_diff.new_indices == std::vector<size_t>({ large_index_num }) );
+
+    for (const auto &delete_md5 : md5s)
+    {
+        REQUIRE( db.DeleteMd5Sum(delete_md5.uuid, delete_md5.index_num) == 0 );
+    }
+}
+
 TEST_CASE( "Test basic func for refresh table sqlite (pass)", "[single-file]" )
 {
     SQLiteDB db(DefaultTestDBPath);
@@ -125,12 +735,223 @@ TEST_CASE( "Test basic func for refresh table sqlite (pass)", "[single-file]" )
     REQUIRE ( next_refresh.uuid == refresh.uuid );
     REQUIRE ( next_refresh.refresh_date == refresh.refresh_date );
 
+    // a row without a refresh date sorts first but is never the next refresh
+    sqlite3 *database_conn = nullptr;
+    REQUIRE( sqlite3_open(DefaultTestDBPath, &database_conn) == SQLITE_OK );
+    REQUIRE( sqlite3_exec(database_conn, "INSERT INTO refresh(UUID, refresh_date) VALUES ('null-date-uuid', NULL)", 0, 0, nullptr) == SQLITE_OK );
+    sqlite3_close(database_conn);
+
+    REQUIRE ( db.GetRefreshFromMinDate().uuid == refresh.uuid );
+
+    REQUIRE ( db.DeleteRefresh("null-date-uuid") == 0 );
     REQUIRE ( db.DeleteRefresh(refresh.uuid) == 0 );
 
     REQUIRE ( db.DoesRefreshExist(refresh.uuid).result == false );
     REQUIRE ( db.DoesMinRefreshExist().result == false );
 }
 
+TEST_CASE( "Test get due refreshes sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    std::vector<DBRefresh> refreshes;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        DBRefresh refresh = GenerateTestRefresh();
+        refresh.uuid += "-" + std::to_string(i);
+        refresh.refresh_date -= i * 100;
+        refreshes.emplace_back(refresh);
+        REQUIRE( db.CreateRefresh(refresh) == 0 );
+    }
+
+    std::vector<DBRefresh> due;
+    REQUIRE( db.GetDueRefreshes(refreshes[1].refresh_date, 3, due) == 0 );
+    REQUIRE( due.size() == 3 );
+    REQUIRE( due[0].uuid == refreshes[4].uuid );
+    REQUIRE( due[1].uuid == refreshes[3].uuid );
+    REQUIRE( due[2].uuid == refreshes[2].uuid );
+
+    REQUIRE( db.GetDueRefreshes(refreshes[1].refresh_date, 10, due) == 0 );
+    REQUIRE( due.size() == 4 );
+    REQUIRE( due[3].uuid == refreshes[1].uuid );
+
+    REQUIRE( db.GetDueRefreshes(refreshes[4].refresh_date - 1, 10, due) == 0 );
+    REQUIRE( due.empty() );
+
+    REQUIRE( db.GetRefreshFromMinDate().uuid == refreshes[4].uuid );
+
+    for (const auto &refresh : refreshes)
+    {
+        REQUIRE( db.DeleteRefresh(refresh.uuid) == 0 );
+    }
+}
+
+TEST_CASE( "Test claim refreshes with leases sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    std::vector<DBRefresh> refreshes;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        DBRefresh refresh = GenerateTestRefresh();
+        refresh.uuid += "-" + std::to_string(i);
+        refresh.refresh_date += i;
+        refreshes.emplace_back(refresh);
+        REQUIRE( db.CreateRefresh(refresh) == 0 );
+    }
+
+    std::vector<DBRefresh> claimed_a;
+    std::vector<DBRefresh> claimed_b;
+    REQUIRE( db.ClaimRefreshes("worker-a", 600, 3, claimed_a) == 0 );
+    REQUIRE( claimed_a.size() == 3 );
+    REQUIRE( claimed_a[0].uuid == refreshes[0].uuid );
+    REQUIRE( claimed_a[2].uuid == refreshes[2].uuid );
+
+    REQUIRE( db.ClaimRefreshes("worker-b", 600, 3, claimed_b) == 0 );
+    REQUIRE( claimed_b.size() == 1 );
+    REQUIRE( claimed_b[0].uuid == refreshes[3].uuid );
+
+    REQUIRE( db.CompleteRefresh(refreshes[0].uuid, "worker-b") == -1 );
+    REQUIRE( db.CompleteRefresh(refreshes[0].uuid, "worker-a") == 0 );
+    REQUIRE( db.DoesRefreshExist(refreshes[0].uuid).result == false );
+
+    REQUIRE( db.ReleaseRefresh(refreshes[1].uuid, "worker-a") == 0 );
+    REQUIRE( db.ClaimRefreshes("worker-b", 600, 3, claimed_b) == 0 );
+    REQUIRE( claimed_b.size() == 1 );
+    REQUIRE( claimed_b[0].uuid == refreshes[1].uuid );
+
+    // leased refreshes are not handed out by the unleased reads either
+    std::vector<DBRefresh> due;
+    REQUIRE( db.GetRefreshFromMinDate().uuid.empty() );
+    REQUIRE( db.GetDueRefreshes(refreshes[3].refresh_date, 10, due) == 0 );
+    REQUIRE( due.empty() );
+
+    REQUIRE( db.ReleaseRefresh(refreshes[1].uuid, "worker-b") == 0 );
+    REQUIRE( db.GetRefreshFromMinDate().uuid == refreshes[1].uuid );
+    REQUIRE( db.GetDueRefreshes(refreshes[3].refresh_date, 10, due) == 0 );
+    REQUIRE( due.size() == 1 );
+    REQUIRE( due[0].uuid == refreshes[1].uuid );
+
+    // a lease that expires on creation would not keep other workers out
+    REQUIRE( db.ClaimRefreshes("worker-a", 0, 1, claimed_a) == -1 );
+    REQUIRE( claimed_a.empty() );
+    REQUIRE( db.ClaimRefreshes("worker-a", -5, 1, claimed_a) == -1 );
+    REQUIRE( claimed_a.empty() );
+    REQUIRE( db.ClaimRefreshes("worker-b", 600, 1, claimed_b) == 0 );
+    REQUIRE( claimed_b.size() == 1 );
+    REQUIRE( claimed_b[0].uuid == refreshes[1].uuid );
+
+    for (size_t i = 1; i < refreshes.size(); ++i)
+    {
+        REQUIRE( db.DeleteRefresh(refreshes[i].uuid) == 0 );
+    }
+}
+
+TEST_CASE( "Test refresh times past 2038 sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath);
+
+    // 2065, past the 32 bit time_t limit
+    DBRefresh late_refresh = GenerateTestRefresh();
+    late_refresh.refresh_date = 3000000000;
+    REQUIRE( db.CreateRefresh(late_refresh) == 0 );
+
+    std::vector<DBRefresh> due;
+    REQUIRE( db.GetDueRefreshes(late_refresh.refresh_date - 1, 10, due) == 0 );
+    REQUIRE( due.empty() );
+    REQUIRE( db.GetDueRefreshes(late_refresh.refresh_date, 10, due) == 0 );
+    REQUIRE( due.size() == 1 );
+    REQUIRE( db.DeleteRefresh(late_refresh.uuid) == 0 );
+
+    // leases ending past 2038, or past the end of time_t, stay held
+    DBRefresh refresh = GenerateTestRefresh();
+    REQUIRE( db.CreateRefresh(refresh) == 0 );
+
+    std::vector<DBRefresh> claimed_a;
+    std::vector<DBRefresh> claimed_b;
+    REQUIRE( db.ClaimRefreshes("worker-a", 100LL * 365 * 24 * 60 * 60, 1, claimed_a) == 0 );
+    REQUIRE( claimed_a.size() == 1 );
+    REQUIRE( db.ClaimRefreshes("worker-b", 600, 1, claimed_b) == 0 );
+    REQUIRE( claimed_b.empty() );
+
+    REQUIRE( db.ReleaseRefresh(refresh.uuid, "worker-a") == 0 );
+    REQUIRE( db.ClaimRefreshes("worker-a", std::numeric_limits<time_t>::max(), 1, claimed_a) == 0 );
+    REQUIRE( claimed_a.size() == 1 );
+    REQUIRE( db.ClaimRefreshes("worker-b", 600, 1, claimed_b) == 0 );
+    REQUIRE( claimed_b.empty() );
+
+    REQUIRE( db.CompleteRefresh(refresh.uuid, "worker-a") == 0 );
+}
+
+TEST_CASE( "Test concurrent reads with read connection pool sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath, 4);
+    REQUIRE( db.IsReady() == true );
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    REQUIRE( db.CreateEntry(staging_entry, STAGING_ENTRY) == 0 );
+
+    std::atomic<size_t> failures(0);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        readers.emplace_back([&db, &staging_entry, &failures]()
+        {
+            for (size_t j = 0; j < 50; ++j)
+            {
+                if (db.ReadEntry(staging_entry.uuid, STAGING_ENTRY).uuid != staging_entry.uuid)
+                    ++failures;
+                if (db.DoesEntryUrlExist(staging_entry.url, STAGING_ENTRY).result != true)
+                    ++failures;
+            }
+        });
+    }
+
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    REQUIRE( failures == 0 );
+    REQUIRE( db.DeleteEntry(staging_entry.uuid, STAGING_ENTRY) == 0 );
+}
+
+TEST_CASE( "Test column descriptor sql generation sqlite (pass)", "[single-file]" )
+{
+    REQUIRE( InsertSQLiteRowSQL(RefreshColumns, "refresh") == "INSERT INTO refresh(UUID, refresh_date) VALUES (?1, ?2)" );
+    REQUIRE( SelectSQLiteRowSQL(ErrorEntryColumns, "error_entry", "WHERE UUID = :UUID") == "SELECT UUID, progress_num FROM error_entry WHERE UUID = :UUID" );
+    REQUIRE( UpdateSQLiteRowSQL(Md5SumColumns, "md5_sum", 2) == "UPDATE md5_sum SET md5_sum = ?3, version_num = ?4 WHERE UUID = ?1 AND index_num = ?2" );
+
+    const entry_column_mask_t columns = EntryColumnMask(DBEntryColumnID::uuid) | EntryColumnMask(DBEntryColumnID::url);
+    REQUIRE( SelectSQLiteRowSQL(EntryColumns, "black_entry", "", columns) == "SELECT UUID, url FROM black_entry" );
+}
+
+TEST_CASE( "Test slow query log sqlite (pass)", "[single-file]" )
+{
+    // the lowest threshold, checks the profile callback runs alongside normal reads and writes on
+    // every connection
+    SQLiteDB db(DefaultTestDBPath, 1, 1);
+    REQUIRE( db.IsReady() == true );
+
+    DBEntry black_entry = GenerateTestBlackEntry();
+    REQUIRE( db.CreateEntry(black_entry, BLACK_ENTRY) == 0 );
+    REQUIRE( db.ReadEntry(black_entry.uuid, BLACK_ENTRY).uuid == black_entry.uuid );
+    REQUIRE( db.ReadEntry(black_entry.uuid, BLACK_ENTRY, EntryColumnMask(DBEntryColumnID::url)).url == black_entry.url );
+    REQUIRE( db.ListEntries(BLACK_ENTRY).size() == 1 );
+    REQUIRE( db.DeleteEntry(black_entry.uuid, BLACK_ENTRY) == 0 );
+}
+
+TEST_CASE( "Test reads without read connection pool sqlite (pass)", "[single-file]" )
+{
+    SQLiteDB db(DefaultTestDBPath, 0);
+    REQUIRE( db.IsReady() == true );
+
+    DBEntry black_entry = GenerateTestBlackEntry();
+    REQUIRE( db.CreateEntry(black_entry, BLACK_ENTRY) == 0 );
+    REQUIRE( db.ReadEntry(black_entry.uuid, BLACK_ENTRY).uuid == black_entry.uuid );
+    REQUIRE( db.DeleteEntry(black_entry.uuid, BLACK_ENTRY) == 0 );
+}
+
 } // namespace db
 } // namespace core
 } // namespace black_library
@@ -0,0 +1,126 @@
+/**
+ * stats_test.cc
+ */
+
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <DBStats.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+TEST_CASE( "Test latency histogram percentiles (pass)", "[single-file]" )
+{
+    DBLatencyHistogram histogram;
+
+    REQUIRE( histogram.GetStats().count == 0 );
+    REQUIRE( histogram.GetStats().p99_us == 0 );
+
+    // 90 fast samples at 1us and 10 slow ones at 1ms
+    for (size_t i = 0; i < 90; ++i)
+    {
+        histogram.Record(1000);
+    }
+    for (size_t i = 0; i < 10; ++i)
+    {
+        histogram.Record(1000000);
+    }
+
+    DBLatencyStats stats = histogram.GetStats();
+    REQUIRE( stats.count == 100 );
+    REQUIRE( stats.total_ns == 90 * 1000 + 10 * 1000000 );
+    REQUIRE( stats.max_ns == 1000000 );
+    REQUIRE( stats.p50_us >= 1.0 );
+    REQUIRE( stats.p50_us <= 1.25 );
+    REQUIRE( stats.p90_us <= 1.25 );
+    REQUIRE( stats.p99_us == 1000.0 );
+}
+
+TEST_CASE( "Test stats counts calls and errors per operation (pass)", "[single-file]" )
+{
+    DBStats stats;
+
+    stats.RecordOperation(READ_ENTRY_OPERATION, 2000, false);
+    stats.RecordOperation(READ_ENTRY_OPERATION, 4000, false);
+    stats.RecordOperation(CREATE_ENTRY_OPERATION, 8000, true);
+    stats.RecordSharedLockWait(0);
+    stats.RecordExclusiveLockWait(500);
+
+    DBStatsSnapshot snapshot = stats.GetStats();
+    REQUIRE( snapshot.operations.size() == _NUM_DB_OPERATIONS );
+    REQUIRE( snapshot.operations[READ_ENTRY_OPERATION].name == "read_entry" );
+    REQUIRE( snapshot.operations[READ_ENTRY_OPERATION].calls == 2 );
+    REQUIRE( snapshot.operations[READ_ENTRY_OPERATION].errors == 0 );
+    REQUIRE( snapshot.operations[CREATE_ENTRY_OPERATION].errors == 1 );
+    REQUIRE( snapshot.shared_lock_wait.count == 1 );
+    REQUIRE( snapshot.exclusive_lock_wait.max_ns == 500 );
+
+    njson j = snapshot.ToJson();
+    REQUIRE( j["operations"]["read_entry"]["calls"] == 2 );
+    REQUIRE( j["operations"]["create_entry"]["errors"] == 1 );
+    REQUIRE( j["lock_wait"]["exclusive"]["count"] == 1 );
+}
+
+TEST_CASE( "Test operation timer counts failed results (pass)", "[single-file]" )
+{
+    DBStats stats;
+
+    DBEntry entry;
+    DBRefresh refresh;
+    DBMd5SumDiff diff;
+
+    DBOperationTimer(stats, READ_ENTRY_OPERATION).Result(entry);
+    entry.uuid = "55ee59ad-2feb-4196-960b-3226c65c80d5";
+    DBOperationTimer(stats, READ_ENTRY_OPERATION).Result(entry);
+
+    DBOperationTimer(stats, READ_REFRESH_OPERATION).Result(refresh);
+
+    DBOperationTimer(stats, DIFF_MD5_SUMS_OPERATION).Result(diff);
+    diff.error = -1;
+    DBOperationTimer(stats, DIFF_MD5_SUMS_OPERATION).Result(diff);
+
+    DBStatsSnapshot snapshot = stats.GetStats();
+    REQUIRE( snapshot.operations[READ_ENTRY_OPERATION].calls == 2 );
+    REQUIRE( snapshot.operations[READ_ENTRY_OPERATION].errors == 1 );
+    REQUIRE( snapshot.operations[READ_REFRESH_OPERATION].errors == 1 );
+    REQUIRE( snapshot.operations[DIFF_MD5_SUMS_OPERATION].calls == 2 );
+    REQUIRE( snapshot.operations[DIFF_MD5_SUMS_OPERATION].errors == 1 );
+}
+
+TEST_CASE( "Test stats concurrent recording (pass)", "[single-file]" )
+{
+    DBStats stats;
+    std::vector<std::thread> writers;
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        writers.emplace_back([&stats, i]()
+        {
+            for (size_t j = 0; j < 10000; ++j)
+            {
+                stats.RecordOperation(DOES_ENTRY_URL_EXIST_OPERATION, i * 1000 + j, j % 100 == 0);
+            }
+        });
+    }
+
+    for (auto &writer : writers)
+    {
+        writer.join();
+    }
+
+    DBOperationStats operation = stats.GetStats().operations[DOES_ENTRY_URL_EXIST_OPERATION];
+    REQUIRE( operation.calls == 40000 );
+    REQUIRE( operation.errors == 400 );
+    REQUIRE( operation.latency.count == 40000 );
+    REQUIRE( operation.latency.max_ns == 3000 + 9999 );
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -0,0 +1,99 @@
+/**
+ * url_index_test.cc
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <DBUrlIndex.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+TEST_CASE( "Test url index add, remove and contains (pass)", "[single-file]" )
+{
+    DBUrlIndex url_index;
+    const std::string url = "https://www.example.com/works/0";
+
+    REQUIRE( url_index.Contains(url) == false );
+    REQUIRE( url_index.MayContain(url) == false );
+
+    url_index.Add(url);
+    REQUIRE( url_index.Contains(url) == true );
+    REQUIRE( url_index.MayContain(url) == true );
+    REQUIRE( url_index.Size() == 1 );
+
+    url_index.Remove(url);
+    REQUIRE( url_index.Contains(url) == false );
+    REQUIRE( url_index.Size() == 0 );
+
+    DBUrlIndexStats stats = url_index.GetStats();
+    REQUIRE( stats.lookups == 3 );
+    REQUIRE( stats.hits == 1 );
+    REQUIRE( stats.bloom_negatives + stats.bloom_false_positives == 2 );
+}
+
+TEST_CASE( "Test url index counts duplicate urls (pass)", "[single-file]" )
+{
+    DBUrlIndex url_index;
+    const std::string url = "https://www.example.com/works/0";
+
+    url_index.Add(url);
+    url_index.Add(url);
+    REQUIRE( url_index.Size() == 1 );
+
+    // a second entry still holds the url
+    url_index.Remove(url);
+    REQUIRE( url_index.Contains(url) == true );
+
+    url_index.Remove(url);
+    REQUIRE( url_index.Contains(url) == false );
+
+    url_index.Remove(url);
+    REQUIRE( url_index.Size() == 0 );
+}
+
+TEST_CASE( "Test url index grows and keeps false positives low (pass)", "[single-file]" )
+{
+    DBUrlIndex url_index;
+    const size_t num_urls = 20000;
+
+    for (size_t i = 0; i < num_urls; ++i)
+    {
+        url_index.Add("https://www.example.com/works/" + std::to_string(i));
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < num_urls; ++i)
+    {
+        if (url_index.Contains("https://www.example.com/works/" + std::to_string(i)))
+            ++found;
+    }
+    REQUIRE( found == num_urls );
+
+    size_t unseen_found = 0;
+    for (size_t i = 0; i < num_urls; ++i)
+    {
+        if (url_index.Contains("https://www.example.com/unseen/" + std::to_string(i)))
+            ++unseen_found;
+    }
+    REQUIRE( unseen_found == 0 );
+
+    DBUrlIndexStats stats = url_index.GetStats();
+    REQUIRE( stats.urls == num_urls );
+    REQUIRE( stats.bloom_bits >= num_urls * 8 );
+    REQUIRE( stats.hits == num_urls );
+    REQUIRE( stats.bloom_negatives + stats.bloom_false_positives == num_urls );
+    REQUIRE( stats.bloom_false_positives < num_urls / 20 );
+    REQUIRE( stats.memory_bytes > stats.bloom_bits / 8 );
+
+    url_index.Clear();
+    REQUIRE( url_index.Size() == 0 );
+    REQUIRE( url_index.Contains("https://www.example.com/works/0") == false );
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library
@@ -0,0 +1,185 @@
+/**
+ * workload_test.cc
+ */
+
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <FileOperations.h>
+#include <LogOperations.h>
+
+#include <BlackLibraryDB.h>
+#include <DBWorkload.h>
+
+#include <DBTestUtils.h>
+
+namespace black_library {
+
+namespace core {
+
+namespace db {
+
+namespace BlackLibraryCommon = black_library::core::common;
+
+static constexpr const char DefaultTestWorkloadPath[] = "/tmp/catalog.workload";
+
+static constexpr const size_t TestWorkloadRecords = 10;
+
+static njson GenerateWorkloadTestConfig(db_workload_format_t format)
+{
+    njson config = GenerateDBTestConfig();
+    config["config"]["db_workload_path"] = DefaultTestWorkloadPath;
+    config["config"]["db_workload_binary"] = format == DB_WORKLOAD_BINARY_FORMAT;
+    return config;
+}
+
+// records TestWorkloadRecords calls made on a BlackLibraryDB, the trace is complete once it is destroyed
+static void RecordTestWorkload(db_workload_format_t format)
+{
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+
+    BlackLibraryDB db(GenerateWorkloadTestConfig(format));
+    REQUIRE( db.IsReady() == true );
+
+    DBEntry staging_entry = GenerateTestStagingEntry();
+    DBMd5Sum md5 = GenerateTestMd5Sum();
+    DBRefresh refresh = GenerateTestRefresh();
+
+    REQUIRE( db.CreateStagingEntry(staging_entry) == 0 );
+    REQUIRE( db.ReadStagingEntry(staging_entry.uuid, EntryColumnMask(DBEntryColumnID::title)).title == staging_entry.title );
+    REQUIRE( db.DoesStagingEntryUrlExist(staging_entry.url) == true );
+    staging_entry.title = "staging-title-updated";
+    REQUIRE( db.UpdateStagingEntry(staging_entry) == 0 );
+    REQUIRE( db.CreateMd5Sum(md5) == 0 );
+    REQUIRE( db.DiffMd5Sums(md5.uuid, { { md5.index_num, "changed" }, { md5.index_num + 1, "new" } }).changed_indices.size() == 1 );
+    REQUIRE( db.CreateRefresh(refresh) == 0 );
+    REQUIRE( db.ClaimRefreshes("worker-0", 60, 10).size() == 1 );
+    REQUIRE( db.CompleteRefresh(refresh.uuid, "worker-0") == 0 );
+    REQUIRE( db.DeleteStagingEntry(staging_entry.uuid) == 0 );
+}
+
+static void CheckTestWorkload()
+{
+    std::vector<DBWorkloadRecord> records;
+    REQUIRE( ReadDBWorkload(DefaultTestWorkloadPath, records) == 0 );
+
+    // the url index build and the url lookups made before the update and delete are not recorded
+    REQUIRE( records.size() == TestWorkloadRecords );
+
+    const std::vector<db_operation_id_t> operations = { CREATE_ENTRY_OPERATION, READ_ENTRY_OPERATION, DOES_ENTRY_URL_EXIST_OPERATION,
+        UPDATE_ENTRY_OPERATION, CREATE_MD5_SUM_OPERATION, DIFF_MD5_SUMS_OPERATION, CREATE_REFRESH_OPERATION, CLAIM_REFRESHES_OPERATION,
+        COMPLETE_REFRESH_OPERATION, DELETE_ENTRY_OPERATION };
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        REQUIRE( records[i].operation == operations[i] );
+        REQUIRE( records[i].thread == 0 );
+        if (i > 0)
+            REQUIRE( records[i].offset_ns >= records[i - 1].offset_ns );
+    }
+
+    REQUIRE( records[0].args == njson::array({ WorkloadRowToJson(GenerateTestStagingEntry()), STAGING_ENTRY }) );
+    REQUIRE( records[1].args.size() == 3 );
+    REQUIRE( records[7].args == njson::array({ "worker-0", 60, 10 }) );
+
+    // replayed against a fresh catalog every call behaves as it did when recorded
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+    BlackLibraryDB db(GenerateDBTestConfig());
+    REQUIRE( db.IsReady() == true );
+
+    for (const auto &record : records)
+    {
+        REQUIRE( ReplayDBWorkloadRecord(db, record) == 0 );
+    }
+
+    REQUIRE( db.DoesStagingEntryUUIDExist(GenerateTestStagingEntry().uuid) == false );
+    REQUIRE( db.DoesStagingEntryUrlExist(GenerateTestStagingEntry().url) == false );
+    REQUIRE( db.DoesMd5SumExist(GenerateTestMd5Sum().uuid, GenerateTestMd5Sum().index_num) == true );
+    REQUIRE( db.DoesRefreshExist(GenerateTestRefresh().uuid) == false );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+    BlackLibraryCommon::RemovePath(DefaultTestWorkloadPath);
+}
+
+TEST_CASE( "Test init workload logger (pass)", "[single-file]")
+{
+    BlackLibraryCommon::InitRotatingLogger("db", "/tmp/", false);
+}
+
+TEST_CASE( "Test workload record and replay binary (pass)", "[single-file]" )
+{
+    RecordTestWorkload(DB_WORKLOAD_BINARY_FORMAT);
+    CheckTestWorkload();
+}
+
+TEST_CASE( "Test workload record and replay json (pass)", "[single-file]" )
+{
+    RecordTestWorkload(DB_WORKLOAD_JSON_FORMAT);
+    CheckTestWorkload();
+}
+
+TEST_CASE( "Test workload record concurrent callers in offset order (pass)", "[single-file]" )
+{
+    static constexpr const size_t TestWorkloadThreads = 4;
+    static constexpr const size_t TestWorkloadCallsPerThread = 200;
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+
+    {
+        BlackLibraryDB db(GenerateWorkloadTestConfig(DB_WORKLOAD_BINARY_FORMAT));
+        REQUIRE( db.IsReady() == true );
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < TestWorkloadThreads; ++i)
+        {
+            threads.emplace_back([&db]() {
+                for (size_t j = 0; j < TestWorkloadCallsPerThread; ++j)
+                {
+                    db.DoesStagingEntryUrlExist("url-" + std::to_string(j));
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::vector<DBWorkloadRecord> records;
+    REQUIRE( ReadDBWorkload(DefaultTestWorkloadPath, records) == 0 );
+    REQUIRE( records.size() == TestWorkloadThreads * TestWorkloadCallsPerThread );
+
+    std::unordered_set<uint32_t> recorded_threads;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        recorded_threads.emplace(records[i].thread);
+        if (i > 0)
+            REQUIRE( records[i].offset_ns >= records[i - 1].offset_ns );
+    }
+    REQUIRE( recorded_threads.size() == TestWorkloadThreads );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+    BlackLibraryCommon::RemovePath(DefaultTestWorkloadPath);
+}
+
+TEST_CASE( "Test workload read truncated (fail)", "[single-file]" )
+{
+    RecordTestWorkload(DB_WORKLOAD_BINARY_FORMAT);
+
+    const uintmax_t size = std::filesystem::file_size(DefaultTestWorkloadPath);
+    std::filesystem::resize_file(DefaultTestWorkloadPath, size - 3);
+
+    std::vector<DBWorkloadRecord> records;
+    REQUIRE( ReadDBWorkload(DefaultTestWorkloadPath, records) == -1 );
+
+    BlackLibraryCommon::RemovePath(DefaultTestDBPath);
+    BlackLibraryCommon::RemovePath(DefaultTestWorkloadPath);
+}
+
+} // namespace db
+} // namespace core
+} // namespace black_library